@@ -0,0 +1,68 @@
+//
+// Measures how long loading a config file with N peers takes.
+// Usage: ConfigBench [<numPeers> [<numRuns>]]
+//
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <fmt/core.h>
+
+#include "ConfigParser.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace rgc;
+
+static constexpr char const *CONFIG_PATH = "/tmp/rgc_config_bench.cfg";
+static constexpr uint16_t FIRST_PORT = 5000;
+
+static void writeConfig(size_t numPeers)
+{
+    ofstream ofs(CONFIG_PATH);
+    ofs << "# peer Id, peer IP address, peer Udp port\n";
+    for (size_t i = 0; i < numPeers; i++)
+    {
+        // spread the peers over several hosts, the ports repeat on each of them
+        size_t host = i / 10000;
+        ofs << (i + 2) << ",10.0." << (host / 256) << "." << (host % 256) << "," << (FIRST_PORT + i % 10000) << "\n";
+    }
+    ofs << "heartbeat_interval_ms=100\n";
+}
+
+int main(int argc, char *argv[])
+{
+    size_t numPeers = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 10000;
+    size_t numRuns = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 20;
+    if ((numPeers == 0) || (numPeers > UINT16_MAX - 2) || (numRuns == 0))
+    {
+        fmt::print(stderr, "Usage: {} [<numPeers> [<numRuns>]], with <numPeers> in [1..{}]\n", argv[0], UINT16_MAX - 2);
+        return 1;
+    }
+
+    writeConfig(numPeers);
+
+    duration<double, std::milli> best = duration<double, std::milli>::max();
+    duration<double, std::milli> total = duration<double, std::milli>::zero();
+    for (size_t run = 0; run < numRuns; run++)
+    {
+        char const *args[] = { "ConfigBench", "-c", CONFIG_PATH };
+        optind = 1;
+        auto start = steady_clock::now();
+        optional<config_t> optConfig = getConfigFromOptions(3, const_cast<char **>(args));
+        duration<double, std::milli> elapsed = steady_clock::now() - start;
+
+        if (!optConfig.has_value() || (optConfig->peers.size() != numPeers))
+        {
+            fmt::print(stderr, "Loading {} failed.\n", CONFIG_PATH);
+            return 1;
+        }
+        best = std::min(best, elapsed);
+        total += elapsed;
+    }
+
+    fmt::print("{:>8} {:>10} {:>10}\n", "peers", "best_ms", "mean_ms");
+    fmt::print("{:>8} {:>10.3f} {:>10.3f}\n", numPeers, best.count(), total.count() / numRuns);
+    unlink(CONFIG_PATH);
+    return 0;
+}
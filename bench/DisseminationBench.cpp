@@ -0,0 +1,251 @@
+//
+// Counts the datagrams needed for broadcasts of one peer in an in-process group of N peers
+// for each dissemination and reliability mode. Usage: DisseminationBench [<lossPercent> [<numMessages>]]
+//
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <random>
+#include <cstring>
+#include <fmt/core.h>
+
+#include "ISocket.h"
+#include "IApp.h"
+#include "MiddleWare.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace rgc;
+
+static constexpr uint16_t FIRST_PORT = 5000;
+static constexpr duration<int64_t, std::milli> LOOP_TIME = milliseconds(100);
+
+typedef struct
+{
+    size_t data;
+    size_t ack;
+    size_t control;
+    size_t dropped;
+} counters_t;
+
+typedef struct
+{
+    char const *name;
+    Dissemination dissemination;
+    Reliability reliability;
+} benchMode_t;
+
+static const benchMode_t BENCH_MODES[] = {
+    { "flood", Dissemination::FLOOD, Reliability::ACK },
+    { "gossip", Dissemination::GOSSIP, Reliability::ACK },
+    { "nack", Dissemination::FLOOD, Reliability::NACK },
+};
+
+typedef struct
+{
+    struct sockaddr_in from;
+    payload_t payload;
+} datagram_t;
+
+class BenchRxSocket : public IRxSocket
+{
+public:
+    virtual TransmitStatus receive(rx_buffer_t &buf, struct sockaddr_in &remoteAddr) const
+    {
+        TransmitStatus ret = { 0, 0 };
+        if (!m_queue.empty())
+        {
+            datagram_t &dgram = m_queue.front();
+            copy(begin(dgram.payload), end(dgram.payload), begin(buf));
+            remoteAddr = dgram.from;
+            ret.transmitBytes = dgram.payload.size();
+            m_queue.pop_front();
+        }
+        return ret;
+    }
+
+    mutable deque<datagram_t> m_queue;
+};
+
+class BenchTxSocket : public ITxSocket
+{
+public:
+    BenchTxSocket(peer_t const &from, peer_t const &to, BenchRxSocket *pRemoteRxSocket, counters_t &counters, minstd_rand &rng, double loss) :
+        m_peerId(to.peerId), m_pRemoteRxSocket(pRemoteRxSocket), m_counters(counters), m_rng(rng), m_loss(loss)
+    {
+        m_fromSockAddr = toSockAddr(from);
+        m_remoteSockAddr = toSockAddr(to);
+    }
+
+    virtual TransmitStatus send(payload_t const &payload) const
+    {
+        peerId_t peerId = (payload[0] << 8) + payload[1];
+        if (peerId == CONTROL_PEER_ID)
+        {
+            m_counters.control++;
+        }
+        else if (payload.size() == sizeof(peerId_t) + sizeof(wireSeqNr_t) + sizeof(checksum_t))
+        {
+            m_counters.ack++;
+        }
+        else
+        {
+            m_counters.data++;
+        }
+
+        if (std::uniform_real_distribution<double>(0.0, 1.0)(m_rng) < m_loss)
+        {
+            m_counters.dropped++;
+        }
+        else
+        {
+            m_pRemoteRxSocket->m_queue.push_back({ m_fromSockAddr, payload });
+        }
+
+        return { payload.size(), 0 };
+    }
+
+    virtual struct ::sockaddr_in const &getRemoteSocketAddr() const
+    {
+        return m_remoteSockAddr;
+    }
+
+    virtual peerId_t getPeerId() const
+    {
+        return m_peerId;
+    }
+
+private:
+    static struct ::sockaddr_in toSockAddr(peer_t const &peer)
+    {
+        struct ::sockaddr_in ret;
+        memset(&ret, 0, sizeof(ret));
+        ret.sin_family = AF_INET;
+        ret.sin_addr.s_addr = peer.peerIpAddress;
+        ret.sin_port = htons(peer.peerUdpPort);
+        return ret;
+    }
+
+    peerId_t m_peerId;
+    BenchRxSocket *m_pRemoteRxSocket;
+    counters_t &m_counters;
+    minstd_rand &m_rng;
+    double m_loss;
+    struct ::sockaddr_in m_fromSockAddr;
+    struct ::sockaddr_in m_remoteSockAddr;
+};
+
+class BenchApp : public IApp
+{
+public:
+    virtual void deliverMessages(delivery_t const *deliveries, size_t numDeliveries) const
+    {
+        (void)deliveries;
+        m_numDelivered += numDeliveries;
+    }
+    virtual void run() {}
+    virtual void log(LOG_TYPE, std::string const &) const {}
+
+    mutable size_t m_numDelivered = 0;
+};
+
+// One peer of the benchmarked group, the sockets are wired up by the Group
+typedef struct
+{
+    BenchRxSocket rxSocket;
+    vector<unique_ptr<BenchTxSocket>> txSockets;
+    vector<ITxSocket *> txISockets;
+    BenchApp app;
+    unique_ptr<MiddleWare> middleWare;
+} benchPeer_t;
+
+static counters_t runBroadcast(size_t numPeers, size_t numMessages, mwConfig_t const &mwConfig, double loss, size_t &numDelivered, seconds &elapsed)
+{
+    counters_t counters = { 0, 0, 0, 0 };
+    minstd_rand rng(42);
+    vector<peer_t> peers;
+    for (size_t i = 0; i < numPeers; i++)
+    {
+        peers.push_back({ static_cast<peerId_t>(i + 1), static_cast<uint16_t>(FIRST_PORT + i), inet_addr("127.0.0.1") });
+    }
+
+    vector<unique_ptr<benchPeer_t>> group;
+    for (size_t i = 0; i < numPeers; i++)
+    {
+        group.push_back(make_unique<benchPeer_t>());
+    }
+
+    for (size_t i = 0; i < numPeers; i++)
+    {
+        benchPeer_t &peer = *group[i];
+        for (size_t j = 0; j < numPeers; j++)
+        {
+            peer.txSockets.push_back(make_unique<BenchTxSocket>(peers[i], peers[j], &group[j]->rxSocket, counters, rng, loss));
+            peer.txISockets.push_back(peer.txSockets.back().get());
+        }
+        peer.middleWare = make_unique<MiddleWare>(&peer.app, peers[i].peerId, &peer.rxSocket, peer.txISockets, std::nullopt, mwConfig);
+    }
+
+    system_clock::time_point start;
+    system_clock::time_point now = start;
+    system_clock::time_point const end = start + seconds(numPeers + 600);
+    for (size_t i = 0; i < numMessages; i++)
+    {
+        group[0]->middleWare->sendMessage("benchmark", now);
+    }
+
+    for (;;)
+    {
+        for (auto &peer : group)
+        {
+            peer->middleWare->rxTxLoop(now);
+        }
+        now += LOOP_TIME;
+
+        numDelivered = 0;
+        size_t numPending = 0;
+        for (auto const &peer : group)
+        {
+            numDelivered += peer->app.m_numDelivered;
+            numPending += peer->middleWare->getNumPendingTxMessages();
+        }
+
+        if (((numDelivered == numPeers * numMessages) && (numPending == 0)) || (now >= end))
+        {
+            break;
+        }
+    }
+
+    elapsed = duration_cast<seconds>(now - start);
+    return counters;
+}
+
+int main(int argc, char *argv[])
+{
+    double loss = (argc > 1) ? atof(argv[1]) / 100.0 : 0.0;
+    size_t numMessages = (argc > 2) ? std::max(atoi(argv[2]), 1) : 1;
+
+    fmt::print("{:>6} {:>8} {:>10} {:>10} {:>10} {:>10} {:>10} {:>12} {:>12}\n", 
+        "peers", "mode", "data", "ack", "control", "dropped", "delivered", "dgrams/msg", "sim. time[s]");
+
+    for (size_t numPeers : { 8, 64, 256 })
+    {
+        for (benchMode_t const &mode : BENCH_MODES)
+        {
+            mwConfig_t mwConfig;
+            mwConfig.dissemination = mode.dissemination;
+            mwConfig.reliability = mode.reliability;
+            size_t numDelivered = 0;
+            seconds elapsed;
+            counters_t counters = runBroadcast(numPeers, numMessages, mwConfig, loss, numDelivered, elapsed);
+            // datagrams of all kinds per message delivered to one peer
+            double perDelivery = (numDelivered > 0) ? 
+                static_cast<double>(counters.data + counters.ack + counters.control) / static_cast<double>(numDelivered) : 0.0;
+            fmt::print("{:>6} {:>8} {:>10} {:>10} {:>10} {:>10} {:>10} {:>12.2f} {:>12}\n", 
+                numPeers, mode.name, counters.data, counters.ack, counters.control, counters.dropped, numDelivered, 
+                perDelivery, elapsed.count());
+        }
+    }
+
+    return 0;
+}
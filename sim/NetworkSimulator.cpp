@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <cstring>
+
+#include <arpa/inet.h>
+
+#include "NetworkSimulator.h"
+
+using namespace std;
+using namespace std::chrono;
+
+static constexpr uint16_t FIRST_PORT = 5000;
+// A peer is woken up at least this much later, even if the middleware reports an earlier timeout
+static constexpr microseconds MIN_WAKEUP_DELAY = microseconds(1000);
+
+namespace rgc
+{
+
+static struct ::sockaddr_in toSockAddr(size_t peerIdx)
+{
+    struct ::sockaddr_in ret;
+    memset(&ret, 0, sizeof(ret));
+    ret.sin_family = AF_INET;
+    ret.sin_addr.s_addr = inet_addr("127.0.0.1");
+    ret.sin_port = htons(static_cast<uint16_t>(FIRST_PORT + peerIdx));
+    return ret;
+}
+
+static uint64_t toKey(MessageId const &msgId)
+{
+    return (static_cast<uint64_t>(msgId.getPeerId()) << 32) + msgId.getSeqNr();
+}
+
+class SimRxSocket final : public IRxSocket
+{
+public:
+    virtual TransmitStatus receive(rx_buffer_t &buf, struct sockaddr_in &remoteAddr) const
+    {
+        TransmitStatus ret = { 0, 0 };
+        if (!m_queue.empty())
+        {
+            auto &front = m_queue.front();
+            size_t size = std::min(front.second.size(), buf.size());
+            copy(begin(front.second), begin(front.second) + size, begin(buf));
+            remoteAddr = toSockAddr(front.first);
+            ret.transmitBytes = size;
+            m_queue.pop_front();
+        }
+        return ret;
+    }
+
+    mutable deque<pair<size_t, payload_t>> m_queue; // sending peer index, datagram
+};
+
+class SimTxSocket final : public ITxSocket
+{
+public:
+    SimTxSocket(NetworkSimulator &sim, size_t fromPeerIdx, size_t toPeerIdx) :
+        m_sim(sim),
+        m_fromPeerIdx(fromPeerIdx),
+        m_toPeerIdx(toPeerIdx),
+        m_remoteSockAddr(toSockAddr(toPeerIdx))
+    {}
+
+    virtual TransmitStatus send(payload_t const &payload) const
+    {
+        m_sim.transmit(m_fromPeerIdx, m_toPeerIdx, payload);
+        return { payload.size(), 0 };
+    }
+
+    virtual struct ::sockaddr_in const &getRemoteSocketAddr() const
+    {
+        return m_remoteSockAddr;
+    }
+
+    virtual peerId_t getPeerId() const
+    {
+        return static_cast<peerId_t>(m_toPeerIdx + 1);
+    }
+
+private:
+    NetworkSimulator &m_sim;
+    size_t m_fromPeerIdx;
+    size_t m_toPeerIdx;
+    struct ::sockaddr_in m_remoteSockAddr;
+};
+
+class SimPeer final : public IApp
+{
+public:
+    SimPeer(NetworkSimulator &sim, size_t peerIdx, size_t numPeers, mwConfig_t const &mwConfig) :
+        m_sim(sim),
+        m_numDelivered(0),
+        m_nextWakeup(system_clock::time_point::max())
+    {
+        for (size_t i = 0; i < numPeers; i++)
+        {
+            m_txSockets.push_back(make_unique<SimTxSocket>(sim, peerIdx, i));
+            m_txISockets.push_back(m_txSockets.back().get());
+        }
+        m_pMiddleWare = make_unique<MiddleWare>(this, static_cast<peerId_t>(peerIdx + 1), &m_rxSocket, m_txISockets, std::nullopt, mwConfig);
+    }
+
+    virtual void deliverMessages(delivery_t const *deliveries, size_t numDeliveries) const
+    {
+        for (size_t i = 0; i < numDeliveries; i++)
+        {
+            m_sim.onDelivered(deliveries[i].msgId);
+        }
+        m_numDelivered += numDeliveries;
+    }
+
+    virtual void run() {}
+    virtual void log(LOG_TYPE, std::string const &) const {}
+
+    NetworkSimulator &m_sim;
+    SimRxSocket m_rxSocket;
+    vector<unique_ptr<SimTxSocket>> m_txSockets;
+    vector<ITxSocket *> m_txISockets;
+    unique_ptr<MiddleWare> m_pMiddleWare;
+    mutable size_t m_numDelivered;
+    system_clock::time_point m_nextWakeup; // earliest scheduled wakeup, later wakeup events are stale
+};
+
+NetworkSimulator::NetworkSimulator(simConfig_t const &config) :
+    m_config(config),
+    m_clock(),
+    m_rng(config.seed),
+    m_nextEventSeq(0),
+    m_numInFlight(0),
+    m_stats{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}
+{
+    for (size_t i = 0; i < config.numPeers; i++)
+    {
+        m_peers.push_back(make_unique<SimPeer>(*this, i, config.numPeers, config.mwConfig));
+        m_peers.back()->m_pMiddleWare->seedRandom(config.seed + static_cast<uint32_t>(i));
+        // a peer sending to itself does not go over the network
+        m_linkModels[{ i, i }] = linkModel_t { microseconds(0), microseconds(0), 0.0, 0.0, 0.0, microseconds(0) };
+    }
+
+    // the failure detector and gossip run on their own timers
+    for (size_t i = 0; i < config.numPeers; i++)
+    {
+        scheduleWakeup(i, m_clock.now());
+    }
+}
+
+NetworkSimulator::~NetworkSimulator()
+{
+}
+
+void NetworkSimulator::setLinkModel(size_t fromPeerIdx, size_t toPeerIdx, linkModel_t const &linkModel)
+{
+    m_linkModels[{ fromPeerIdx, toPeerIdx }] = linkModel;
+}
+
+linkModel_t const &NetworkSimulator::getLinkModel(size_t fromPeerIdx, size_t toPeerIdx) const
+{
+    auto it = m_linkModels.find({ fromPeerIdx, toPeerIdx });
+    return (it == end(m_linkModels)) ? m_config.linkModel : it->second;
+}
+
+SendStatus NetworkSimulator::send(size_t peerIdx, string const &message)
+{
+    SendStatus ret = m_peers[peerIdx]->m_pMiddleWare->sendMessage(message, m_clock.now());
+    if (ret == SendStatus::OK)
+    {
+        m_stats.numSent++;
+        scheduleWakeup(peerIdx, m_clock.now());
+    }
+    return ret;
+}
+
+size_t NetworkSimulator::getNumDelivered(size_t peerIdx) const
+{
+    return m_peers[peerIdx]->m_numDelivered;
+}
+
+void NetworkSimulator::transmit(size_t fromPeerIdx, size_t toPeerIdx, payload_t const &payload)
+{
+    peerId_t peerId = (payload[0] << 8) + payload[1];
+    if (peerId == CONTROL_PEER_ID)
+    {
+        m_stats.numControl++;
+    }
+    else if (payload.size() == sizeof(peerId_t) + sizeof(wireSeqNr_t) + sizeof(checksum_t))
+    {
+        m_stats.numAck++;
+    }
+    else
+    {
+        m_stats.numData++;
+    }
+    m_stats.numBytes += payload.size();
+
+    linkModel_t const &link = getLinkModel(fromPeerIdx, toPeerIdx);
+    uniform_real_distribution<double> chance(0.0, 1.0);
+
+    if (chance(m_rng) < link.loss)
+    {
+        m_stats.numDropped++;
+        return;
+    }
+
+    size_t numCopies = 1;
+    if (chance(m_rng) < link.duplication)
+    {
+        m_stats.numDuplicated++;
+        numCopies++;
+    }
+
+    for (size_t i = 0; i < numCopies; i++)
+    {
+        microseconds delay = link.latency;
+        if (link.jitter.count() > 0)
+        {
+            delay += microseconds(uniform_int_distribution<int64_t>(0, link.jitter.count())(m_rng));
+        }
+        if (chance(m_rng) < link.reordering)
+        {
+            m_stats.numReordered++;
+            delay += link.reorderDelay;
+        }
+        scheduleArrival(m_clock.now() + delay, fromPeerIdx, toPeerIdx, payload);
+    }
+}
+
+void NetworkSimulator::onDelivered(MessageId const &msgId)
+{
+    m_stats.numDeliveries++;
+    if (++m_numDeliveriesOfMsg[toKey(msgId)] == m_config.numPeers)
+    {
+        m_stats.numFullyDelivered++;
+    }
+}
+
+void NetworkSimulator::scheduleArrival(system_clock::time_point time, size_t fromPeerIdx, size_t toPeerIdx, payload_t const &payload)
+{
+    m_events.push({ time, m_nextEventSeq++, ARRIVAL, toPeerIdx, fromPeerIdx, payload });
+    m_numInFlight++;
+}
+
+void NetworkSimulator::scheduleWakeup(size_t peerIdx, system_clock::time_point time)
+{
+    SimPeer &peer = *m_peers[peerIdx];
+    if (time < peer.m_nextWakeup)
+    {
+        peer.m_nextWakeup = time;
+        m_events.push({ time, m_nextEventSeq++, WAKEUP, peerIdx, peerIdx, {} });
+    }
+}
+
+void NetworkSimulator::processEvent(event_t &event)
+{
+    SimPeer &peer = *m_peers[event.peerIdx];
+    m_clock.set(event.time);
+    m_stats.numEvents++;
+
+    if (event.type == ARRIVAL)
+    {
+        // all datagrams arriving at the same time are received in one iteration of the peer
+        peer.m_rxSocket.m_queue.emplace_back(event.fromPeerIdx, std::move(event.payload));
+        m_numInFlight--;
+        scheduleWakeup(event.peerIdx, event.time);
+    }
+    else if (event.time == peer.m_nextWakeup)
+    {
+        peer.m_nextWakeup = system_clock::time_point::max();
+        peer.m_pMiddleWare->rxTxLoop(event.time);
+
+        system_clock::time_point next = peer.m_pMiddleWare->getNextTimeout();
+        if (next != system_clock::time_point::max())
+        {
+            scheduleWakeup(event.peerIdx, std::max(next, event.time + MIN_WAKEUP_DELAY));
+        }
+    }
+}
+
+void NetworkSimulator::runUntil(system_clock::time_point end)
+{
+    while (!m_events.empty() && (m_events.top().time <= end))
+    {
+        event_t event = std::move(const_cast<event_t &>(m_events.top()));
+        m_events.pop();
+        processEvent(event);
+    }
+    m_clock.set(std::max(m_clock.now(), end));
+}
+
+bool NetworkSimulator::isIdle() const
+{
+    return std::all_of(begin(m_peers), end(m_peers), [](auto const &peer) {
+        return (peer->m_pMiddleWare->getNumPendingTxMessages() == 0) && peer->m_rxSocket.m_queue.empty();
+    });
+}
+
+bool NetworkSimulator::runUntilIdle(system_clock::time_point limit)
+{
+    while (!m_events.empty() && (m_events.top().time <= limit))
+    {
+        event_t event = std::move(const_cast<event_t &>(m_events.top()));
+        m_events.pop();
+        processEvent(event);
+
+        // datagrams still on their way may start new messages
+        if ((m_numInFlight == 0) && isIdle())
+        {
+            return true;
+        }
+    }
+    return (m_numInFlight == 0) && isIdle();
+}
+
+} // namespace rgc
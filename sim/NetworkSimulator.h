@@ -0,0 +1,135 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "IApp.h"
+#include "IClock.h"
+#include "ISocket.h"
+#include "MiddleWare.h"
+
+namespace rgc {
+
+// Properties of the simulated link between two peers
+typedef struct
+{
+    std::chrono::microseconds latency; // one way
+    std::chrono::microseconds jitter;  // uniformly distributed extra latency in [0..jitter]
+    double loss;                       // probabilities in [0..1]
+    double duplication;
+    double reordering;                 // datagram is held back by reorderDelay, so that later ones overtake it
+    std::chrono::microseconds reorderDelay;
+} linkModel_t;
+
+typedef struct
+{
+    size_t numPeers;
+    mwConfig_t mwConfig;
+    linkModel_t linkModel; // for all links, unless set per link
+    uint32_t seed;
+} simConfig_t;
+
+typedef struct
+{
+    size_t numSent;           // messages submitted
+    size_t numDeliveries;     // deliveries on all peers
+    size_t numFullyDelivered; // messages delivered by all peers
+    size_t numData;           // datagrams sent, including dropped ones
+    size_t numAck;
+    size_t numControl;
+    size_t numBytes;
+    size_t numDropped;
+    size_t numDuplicated;
+    size_t numReordered;
+    size_t numEvents;
+} simStats_t;
+
+class SimPeer;
+
+// Discrete event simulation of a group of MiddleWare instances in one process. Datagrams and timeouts are events on a
+// simulated clock, so that the peers only run when something happens, and simulated time passes as fast as
+// the events can be processed. Runs with the same configuration and seed are reproducible.
+class NetworkSimulator final
+{
+public:
+    explicit NetworkSimulator(simConfig_t const &config);
+    ~NetworkSimulator();
+
+    void setLinkModel(size_t fromPeerIdx, size_t toPeerIdx, linkModel_t const &linkModel);
+
+    // Peer with the given index sends a message at the current simulated time
+    SendStatus send(size_t peerIdx, std::string const &message);
+
+    // Processes all events up to the given point in time
+    void runUntil(std::chrono::system_clock::time_point end);
+    // Processes events until no peer has pending messages, or the limit is reached; true if idle
+    bool runUntilIdle(std::chrono::system_clock::time_point limit);
+
+    std::chrono::system_clock::time_point now() const
+    {
+        return m_clock.now();
+    }
+
+    simStats_t const &getStats() const
+    {
+        return m_stats;
+    }
+
+    size_t getNumDelivered(size_t peerIdx) const;
+
+    // interface for the simulated sockets and apps
+    void transmit(size_t fromPeerIdx, size_t toPeerIdx, payload_t const &payload);
+    void onDelivered(MessageId const &msgId);
+
+private:
+    typedef enum
+    {
+        ARRIVAL,
+        WAKEUP
+    } eventType_t;
+
+    typedef struct
+    {
+        std::chrono::system_clock::time_point time;
+        uint64_t seq; // events of the same time are processed in the order they were scheduled
+        eventType_t type;
+        size_t peerIdx;
+        size_t fromPeerIdx;
+        payload_t payload;
+    } event_t;
+
+    struct EventLater
+    {
+        bool operator()(event_t const &a, event_t const &b) const
+        {
+            return (a.time == b.time) ? (a.seq > b.seq) : (a.time > b.time);
+        }
+    };
+
+    linkModel_t const &getLinkModel(size_t fromPeerIdx, size_t toPeerIdx) const;
+    void scheduleArrival(std::chrono::system_clock::time_point time, size_t fromPeerIdx, size_t toPeerIdx, payload_t const &payload);
+    void scheduleWakeup(size_t peerIdx, std::chrono::system_clock::time_point time);
+    void processEvent(event_t &event);
+    // no peer has pending messages or unprocessed datagrams
+    bool isIdle() const;
+
+    simConfig_t m_config;
+    ManualClock m_clock;
+    std::minstd_rand m_rng;
+    std::vector<std::unique_ptr<SimPeer>> m_peers;
+    std::map<std::pair<size_t, size_t>, linkModel_t> m_linkModels;
+    std::priority_queue<event_t, std::vector<event_t>, EventLater> m_events;
+    uint64_t m_nextEventSeq;
+    size_t m_numInFlight; // datagrams scheduled for arrival
+    std::unordered_map<uint64_t, size_t> m_numDeliveriesOfMsg;
+    simStats_t m_stats;
+};
+
+} // namespace rgc
@@ -0,0 +1,163 @@
+//
+// Runs a group of peers in the network simulator and prints the counters of the run.
+// Usage: see printSimUsage()
+//
+#include <iostream>
+#include <optional>
+#include <string>
+#include <unistd.h>
+#include <fmt/core.h>
+
+#include "NetworkSimulator.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace rgc;
+
+typedef struct
+{
+    simConfig_t sim;
+    size_t numMessages;
+    milliseconds interval;
+    seconds limit;
+} simRunConfig_t;
+
+static void printSimUsage(char const *argv0)
+{
+    cerr << "Usage: " << argv0 << " [-n <numPeers>] [-m <numMessages>] [-i <intervalMs>] [-d flood|gossip] [-w <window>] [-H <heartbeatMs>]\n"
+         << "          [-L <latencyMs>] [-J <jitterMs>] [-l <lossPercent>] [-D <dupPercent>] [-R <reorderPercent>] [-s <seed>] [-T <limitSec>]\n"
+         << "   <numPeers>       number of simulated peers, default is 8.\n"
+         << "   <numMessages>    number of messages, sent round robin by the peers, default is 100.\n"
+         << "   <intervalMs>     simulated time between two messages, default is 10.\n"
+         << "   <window>         max. messages in flight per origin peer, default is 8.\n"
+         << "   <heartbeatMs>    heartbeat interval of the failure detector, default is 0: disabled.\n"
+         << "   <latencyMs>      one way latency of all links, default is 1.\n"
+         << "   <jitterMs>       max. additional random latency, default is 0.\n"
+         << "   <lossPercent>, <dupPercent>, <reorderPercent>  share of datagrams lost, duplicated, reordered, default is 0.\n"
+         << "   <seed>           seed of the random decisions, default is 1.\n"
+         << "   <limitSec>       simulated time after which the run is aborted, default is 3600.\n";
+}
+
+static optional<simRunConfig_t> parseOptions(int argc, char *argv[])
+{
+    simRunConfig_t ret;
+    ret.sim.numPeers = 8;
+    ret.sim.mwConfig.maxInFlightPerOrigin = 8;
+    ret.sim.linkModel = { milliseconds(1), microseconds(0), 0.0, 0.0, 0.0, milliseconds(5) };
+    ret.sim.seed = 1;
+    ret.numMessages = 100;
+    ret.interval = milliseconds(10);
+    ret.limit = seconds(3600);
+
+    int c;
+    while ((c = getopt(argc, argv, "n:m:i:d:w:H:L:J:l:D:R:s:T:")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            ret.sim.numPeers = strtoul(optarg, nullptr, 10);
+            break;
+        case 'm':
+            ret.numMessages = strtoul(optarg, nullptr, 10);
+            break;
+        case 'i':
+            ret.interval = milliseconds(strtoul(optarg, nullptr, 10));
+            break;
+        case 'd':
+            if (string(optarg) == "gossip")
+            {
+                ret.sim.mwConfig.dissemination = Dissemination::GOSSIP;
+            }
+            else if (string(optarg) != "flood")
+            {
+                return std::nullopt;
+            }
+            break;
+        case 'w':
+            ret.sim.mwConfig.maxInFlightPerOrigin = strtoul(optarg, nullptr, 10);
+            break;
+        case 'H':
+            ret.sim.mwConfig.heartbeatInterval = milliseconds(strtoul(optarg, nullptr, 10));
+            break;
+        case 'L':
+            ret.sim.linkModel.latency = milliseconds(strtoul(optarg, nullptr, 10));
+            break;
+        case 'J':
+            ret.sim.linkModel.jitter = milliseconds(strtoul(optarg, nullptr, 10));
+            break;
+        case 'l':
+            ret.sim.linkModel.loss = strtod(optarg, nullptr) / 100.0;
+            break;
+        case 'D':
+            ret.sim.linkModel.duplication = strtod(optarg, nullptr) / 100.0;
+            break;
+        case 'R':
+            ret.sim.linkModel.reordering = strtod(optarg, nullptr) / 100.0;
+            break;
+        case 's':
+            ret.sim.seed = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+            break;
+        case 'T':
+            ret.limit = seconds(strtoul(optarg, nullptr, 10));
+            break;
+        default:
+            return std::nullopt;
+        }
+    }
+
+    if ((ret.sim.numPeers == 0) || (ret.sim.numPeers >= CONTROL_PEER_ID) || (ret.interval.count() == 0))
+    {
+        return std::nullopt;
+    }
+
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    auto optConfig = parseOptions(argc, argv);
+    if (!optConfig.has_value())
+    {
+        printSimUsage(argv[0]);
+        return 1;
+    }
+
+    simRunConfig_t const &config = *optConfig;
+    NetworkSimulator sim(config.sim);
+    auto start = sim.now();
+    auto limit = start + config.limit;
+    auto wallStart = steady_clock::now();
+
+    for (size_t i = 0; (i < config.numMessages) && (sim.now() < limit); i++)
+    {
+        size_t peerIdx = i % config.sim.numPeers;
+        string message = fmt::format("message {} of peer {}", i, peerIdx + 1);
+        // an exhausted in-flight budget delays the message, as a blocking sender would
+        while ((sim.send(peerIdx, message) != SendStatus::OK) && (sim.now() < limit))
+        {
+            sim.runUntil(sim.now() + config.interval);
+        }
+        sim.runUntil(sim.now() + config.interval);
+    }
+
+    bool idle = sim.runUntilIdle(limit);
+    double wallSeconds = duration<double>(steady_clock::now() - wallStart).count();
+    simStats_t const &stats = sim.getStats();
+
+    cout << fmt::format("sim_seconds {:.3f}\n", duration<double>(sim.now() - start).count())
+         << fmt::format("wall_seconds {:.3f}\n", wallSeconds)
+         << fmt::format("idle {}\n", idle ? 1 : 0)
+         << fmt::format("events {}\n", stats.numEvents)
+         << fmt::format("sent {}\n", stats.numSent)
+         << fmt::format("deliveries {}\n", stats.numDeliveries)
+         << fmt::format("fully_delivered {}\n", stats.numFullyDelivered)
+         << fmt::format("data_datagrams {}\n", stats.numData)
+         << fmt::format("ack_datagrams {}\n", stats.numAck)
+         << fmt::format("control_datagrams {}\n", stats.numControl)
+         << fmt::format("bytes {}\n", stats.numBytes)
+         << fmt::format("dropped {}\n", stats.numDropped)
+         << fmt::format("duplicated {}\n", stats.numDuplicated)
+         << fmt::format("reordered {}\n", stats.numReordered);
+
+    return (idle && (stats.numFullyDelivered == stats.numSent)) ? 0 : 2;
+}
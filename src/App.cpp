@@ -1,9 +1,13 @@
+#include <algorithm>
 #include <vector>
 #include <sstream>
 #include <filesystem>
+#include <cstring>
+#include <fstream>
 #include <stdexcept>
 
 #include <stdio.h>
+#include <poll.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -11,19 +15,34 @@
 #include <fmt/core.h>
 
 #include "App.h"
+#include "LowLatency.h"
 #include "MiddleWare.h"
+#include "Tracer.h"
 
 using namespace std;
+using namespace std::chrono;
 using namespace std::filesystem;
 
 static constexpr char SEPARATOR_COMMAND = ' ';
+static constexpr milliseconds MAX_POLL_WAIT = milliseconds(100);
+// Messages taken from the submission ring per loop, so that received datagrams are still processed timely
+static constexpr size_t MAX_RING_BATCH = 1024;
+// Busy polling: the named pipe and the command socket need system calls, they are checked in this interval only
+static constexpr milliseconds CONTROL_CHECK_INTERVAL = milliseconds(10);
 
 namespace rgc
 {
 
-App::App(peerId_t ownPeerId, IRxSocket *pRxSocket, vector<ITxSocket *> &txSockets, std::string const &logFile, string const &pipe_path, optional<bitflip_t> bitFlipInfo) :
-    m_middleWare(this, ownPeerId, pRxSocket, txSockets, bitFlipInfo),
-    m_logger(Logger::makeLogger(logFile)),
+App::App(config_t const &config, string const &pipe_path, string const &socket_path, string const &ring_name) :
+    m_logger(Logger::makeLogger(config.logFile)),
+    m_endpoint(config,
+        [this](delivery_t const *deliveries, size_t numDeliveries) { deliverMessages(deliveries, numDeliveries); },
+        [this](LOG_TYPE type, std::string const &msg) { log(type, msg); }),
+    m_commandSocket(socket_path),
+    m_submissionRing(ring_name),
+    m_configFile(config.configFile),
+    m_lowLatency(config.lowLatency),
+    m_checksumType(config.mwConfig.checksumType),
     m_pipe_path(pipe_path),
     m_stop(false)
 {
@@ -41,6 +60,30 @@ App::App(peerId_t ownPeerId, IRxSocket *pRxSocket, vector<ITxSocket *> &txSocket
     {
         throw std::runtime_error(fmt::format("Could not open named pipe {}", pipe_path));
     }
+
+    applyLowLatencySettings();
+    Tracer::enable(config.isTracing);
+}
+
+void App::applyLowLatencySettings()
+{
+    if (m_lowLatency.cpu >= 0)
+    {
+        int error = pinToCpu(m_lowLatency.cpu);
+        if (error != 0)
+        {
+            log(IApp::LOG_TYPE::WARN, fmt::format("Could not pin peer to CPU {}: {}.", m_lowLatency.cpu, strerror(error)));
+        }
+    }
+
+    if (m_lowLatency.prefaultBytes > 0)
+    {
+        int error = lockMemory(m_lowLatency.prefaultBytes);
+        if (error != 0)
+        {
+            log(IApp::LOG_TYPE::WARN, fmt::format("Could not lock memory: {}, check ulimit -l.", strerror(error)));
+        }
+    }
 }
 
 App::~App()
@@ -49,20 +92,32 @@ App::~App()
     unlink(m_pipe_path.c_str());
 }
 
-void App::deliverMessage(MessageId msgId, payload_t const &payload) const
+void App::deliverMessages(delivery_t const *deliveries, size_t numDeliveries) const
 {
-    (void)msgId; // leave this in to avoid unused parameter error
-    log(LOG_TYPE::MSG,
-        fmt::format("Delivered message {} to application layer.", MiddleWare::toString(payload)));
+    for (size_t i = 0; i < numDeliveries; i++)
+    {
+        log(LOG_TYPE::MSG,
+            fmt::format("Delivered message {} to application layer.", MiddleWare::toString(deliveries[i], m_checksumType)));
+    }
 }
 
 void App::run()
 {
+    if (m_lowLatency.isBusyPoll)
+    {
+        runBusyPoll();
+        return;
+    }
+
+    vector<struct pollfd> pollFds;
+
     for (;;)
     {
-        auto now = std::chrono::system_clock::now();
+        auto now = m_endpoint.getClock().now();
 
-        m_middleWare.rxTxLoop(now);
+        m_endpoint.poll(now);
+        processPendingSocketCommands();
+        processSubmissionRing();
         processPendingUserCommands();
 
         // stop our peer
@@ -71,12 +126,200 @@ void App::run()
             break;
         }
 
-        usleep(100000); // Sleep for 100 milliseconds
+        // Wait for the sockets, but for at most 100 milliseconds, so that the named pipe is checked as before
+        pollFds.clear();
+        for (int fd : m_endpoint.getDescriptors())
+        {
+            pollFds.push_back({ fd, POLLIN, 0 });
+        }
+        for (int fd : m_commandSocket.getDescriptors())
+        {
+            pollFds.push_back({ fd, POLLIN, 0 });
+        }
+        pollFds.push_back({ m_submissionRing.getEventDescriptor(), POLLIN, 0 });
+
+        auto wait = std::clamp(duration_cast<milliseconds>(m_endpoint.getNextTimeout() - now), milliseconds(0), MAX_POLL_WAIT);
+        ::poll(pollFds.data(), pollFds.size(), static_cast<int>(wait.count()));
+    }
+}
+
+void App::runBusyPoll()
+{
+    Backoff backoff;
+    auto nextControlCheck = m_endpoint.getClock().now();
+
+    while (!m_stop)
+    {
+        auto now = m_endpoint.getClock().now();
+        size_t numReceived = m_endpoint.poll(now);
+        size_t numSubmitted = processSubmissionRing();
+
+        if (now >= nextControlCheck)
+        {
+            m_submissionRing.clearEvent();
+            processPendingSocketCommands();
+            processPendingUserCommands();
+            nextControlCheck = now + CONTROL_CHECK_INTERVAL;
+        }
+
+        if ((numReceived > 0) || (numSubmitted > 0))
+        {
+            backoff.reset();
+        }
+        else
+        {
+            backoff.idle();
+        }
+    }
+}
+
+void App::sendMessage(uint8_t const *data, size_t size)
+{
+    SendStatus status = m_endpoint.send(data, size, m_endpoint.getClock().now());
+    if (status == SendStatus::WOULD_BLOCK)
+    {
+        log(IApp::LOG_TYPE::WARN, fmt::format("Message {} not sent: In-flight budget exhausted.", string(reinterpret_cast<char const *>(data), size)));
+    }
+    else if (status == SendStatus::TOO_LARGE)
+    {
+        log(IApp::LOG_TYPE::ERR, fmt::format("Message of {} Bytes not sent: Its datagram exceeds {} Bytes.", size, BUFFER_SIZE));
+    }
+}
+
+void App::logStats() const
+{
+    mwUsage_t usage = m_endpoint.getUsage();
+    log(IApp::LOG_TYPE::MSG, fmt::format("In-flight messages: {}, payload bytes: {}, state bytes: {}, max. messages of one origin: {}, blocked sends: {}, deferred relays: {}, tx datagrams: {}, dropped datagrams: {}, kernel rx drops: {}, kernel tx drops: {}, FEC recovered: {}, expired: {}, unconfirmed evictions: {}",
+        usage.numMessages, usage.payloadBytes, usage.stateBytes, usage.maxInFlightOfOrigin, usage.numBlockedSends, usage.numDeferredRelays, usage.numTxDatagrams, usage.numDroppedDatagrams,
+        usage.numRxQueueDrops, usage.numTxSocketDrops, usage.numFecRecovered, usage.numExpired, usage.numUnconfirmedEvictions));
+    if (usage.numRxTimestamps > 0)
+    {
+        log(IApp::LOG_TYPE::MSG, fmt::format("Rx delay after kernel timestamp: mean {} us, max {} us",
+            usage.rxDelayNsSum / usage.numRxTimestamps / 1000, usage.rxDelayNsMax / 1000));
+    }
+    if (usage.numPacedDatagrams > 0)
+    {
+        log(IApp::LOG_TYPE::MSG, fmt::format("Pacing delay of {} deferred datagrams: mean {} us, max {} us",
+            usage.numPacedDatagrams, usage.pacingDelayNsSum / usage.numPacedDatagrams / 1000, usage.pacingDelayNsMax / 1000));
+    }
+}
+
+void App::processPendingSocketCommands()
+{
+    size_t numMalformed = m_commandSocket.receive([this](command_t const &command) { processSocketCommand(command); });
+    if (numMalformed > 0)
+    {
+        log(IApp::LOG_TYPE::ERR, fmt::format("Dropped {} malformed records from the command socket.", numMalformed));
+    }
+}
+
+size_t App::processSubmissionRing()
+{
+    // Nobody waits for the eventfd while busy polling, save the system call
+    if (!m_lowLatency.isBusyPoll)
+    {
+        m_submissionRing.clearEvent();
+    }
+
+    // Messages are framed directly from their ring slots. If the in-flight budget is exhausted, they stay in the ring,
+    // which pushes back on the producer.
+    bool isBlocked = false;
+    size_t ret = m_submissionRing.consume([&](uint8_t const *data, size_t size) {
+        SendStatus status = m_endpoint.send(data, size, m_endpoint.getClock().now());
+        if (status == SendStatus::TOO_LARGE)
+        {
+            log(IApp::LOG_TYPE::ERR, fmt::format("Message of {} Bytes from the submission ring dropped: Its datagram exceeds {} Bytes.", size, BUFFER_SIZE));
+        }
+        isBlocked = (status == SendStatus::WOULD_BLOCK);
+        return !isBlocked;
+    }, MAX_RING_BATCH);
+
+    if (isBlocked)
+    {
+        log(IApp::LOG_TYPE::DEBUG, "Submission ring stalled: In-flight budget exhausted.");
+    }
+
+    return ret;
+}
+
+void App::reloadPeers()
+{
+    optional<vector<peer_t>> optPeers = readPeersFromConfigFile(m_configFile);
+    if (!optPeers.has_value())
+    {
+        log(IApp::LOG_TYPE::ERR, fmt::format("Could not reload {}, keeping the current peers.", m_configFile));
+        return;
+    }
+
+    size_t numChanged = m_endpoint.updatePeers(*optPeers);
+    log(IApp::LOG_TYPE::MSG, fmt::format("Reloaded {}: {} peers joined or left.", m_configFile, numChanged));
+}
+
+void App::processSocketCommand(command_t const &command)
+{
+    switch (command.type)
+    {
+        case CommandType::SEND:
+            sendMessage(command.data, command.size);
+            break;
+        case CommandType::INJECT:
+            if (command.size == 6)
+            {
+                bitflip_t bitFlipInfo;
+                bitFlipInfo.peerId = (command.data[0] << 8) + command.data[1];
+                bitFlipInfo.seqNrId = (command.data[2] << 8) + command.data[3];
+                bitFlipInfo.bitOffset = (command.data[4] << 8) + command.data[5];
+                m_endpoint.getMiddleWare().addBitFlipInfo(bitFlipInfo);
+            }
+            else
+            {
+                log(IApp::LOG_TYPE::ERR, fmt::format("Inject command requires 6 Bytes of content, got {}.", command.size));
+            }
+            break;
+        case CommandType::STATS:
+        {
+            mwUsage_t usage = m_endpoint.getUsage();
+            uint64_t counters[] = { usage.numMessages, usage.payloadBytes, usage.stateBytes, usage.maxInFlightOfOrigin, usage.numBlockedSends, usage.numDeferredRelays, usage.numTxDatagrams, usage.numDroppedDatagrams, usage.numRxQueueDrops, usage.numTxSocketDrops, usage.numFecRecovered, usage.numExpired,
+                usage.numPacedDatagrams, usage.pacingDelayNsSum, usage.pacingDelayNsMax, usage.numUnconfirmedEvictions };
+            static_assert(sizeof(counters) / sizeof(counters[0]) == NUM_STATS_COUNTERS, "STATS reply changed, update NUM_STATS_COUNTERS");
+            vector<uint8_t> content;
+            for (uint64_t counter : counters)
+            {
+                for (int shift = 56; shift >= 0; shift -= 8)
+                {
+                    content.push_back((counter >> shift) & 0xff);
+                }
+            }
+            if (!m_commandSocket.reply(command.clientDesc, CommandType::STATS, content.data(), content.size()))
+            {
+                log(IApp::LOG_TYPE::WARN, "Could not send stats reply to command socket client.");
+            }
+            break;
+        }
+        case CommandType::STOP:
+            m_stop = true;
+            break;
+        case CommandType::RELOAD:
+            reloadPeers();
+            break;
+        case CommandType::RING:
+        {
+            string const &name = m_submissionRing.getName();
+            if (!m_commandSocket.reply(command.clientDesc, CommandType::RING, reinterpret_cast<uint8_t const *>(name.data()), name.size(), m_submissionRing.getEventDescriptor()))
+            {
+                log(IApp::LOG_TYPE::WARN, "Could not pass submission ring to command socket client.");
+            }
+            break;
+        }
+        default:
+            log(IApp::LOG_TYPE::ERR, fmt::format("Unknown command type {} on command socket.", static_cast<unsigned>(command.type)));
+            break;
     }
 }
 
 void App::log(LOG_TYPE type, std::string const &msg) const
 {
+    TraceScope trace("log");
     auto now = std::chrono::system_clock::now();
 
     switch(type)
@@ -102,6 +345,7 @@ void App::log(LOG_TYPE type, std::string const &msg) const
 
 void App::processPendingUserCommands()
 {
+    TraceScope trace("processPendingUserCommands");
     for (;;)
     {
         string command = getNextUserCommand();
@@ -115,10 +359,10 @@ void App::processPendingUserCommands()
         stringstream ss(command);
         string command_type;
         getline(ss, command_type, SEPARATOR_COMMAND);
-        string command_arg1;
-        getline(ss, command_arg1, SEPARATOR_COMMAND);
-        string command_arg2;
-        getline(ss, command_arg2, SEPARATOR_COMMAND);
+        // the message of a send command is the remainder of the line, including blanks
+        string command_rest;
+        getline(ss, command_rest);
+        string command_arg1 = command_rest.substr(0, command_rest.find(SEPARATOR_COMMAND));
 
         if (command_type == "stop")
         {
@@ -126,9 +370,9 @@ void App::processPendingUserCommands()
         }
         else if (command_type == "send")
         {
-            if (!command_arg1.empty())
+            if (!command_rest.empty())
             {
-                m_middleWare.sendMessage(command_arg1, std::chrono::system_clock::now());
+                sendMessage(reinterpret_cast<uint8_t const *>(command_rest.data()), command_rest.size());
             }
             else
             {
@@ -136,6 +380,18 @@ void App::processPendingUserCommands()
             }
 
         }
+        else if (command_type == "stats")
+        {
+            logStats();
+        }
+        else if (command_type == "reload")
+        {
+            reloadPeers();
+        }
+        else if (command_type == "trace")
+        {
+            processTraceCommand(command_arg1);
+        }
         else if (command_type == "inject")
         {
             bool parseOK = false;
@@ -145,7 +401,7 @@ void App::processPendingUserCommands()
                 if (optBitFlipInfo.has_value())
                 {
                     parseOK = true;
-                    m_middleWare.addBitFlipInfo(*optBitFlipInfo);
+                    m_endpoint.getMiddleWare().addBitFlipInfo(*optBitFlipInfo);
                 }
             }
 
@@ -161,6 +417,32 @@ void App::processPendingUserCommands()
     }
 }
 
+void App::processTraceCommand(string const &arg)
+{
+    if (arg == "on" || arg == "off")
+    {
+        Tracer::enable(arg == "on");
+    }
+    else if (!arg.empty())
+    {
+        ofstream out(arg, ios::out | ios::trunc);
+        size_t numEvents = Tracer::writeChromeTrace(out);
+        out.close();
+        if (out.fail())
+        {
+            log(IApp::LOG_TYPE::ERR, fmt::format("Could not write trace file {}.", arg));
+        }
+        else
+        {
+            log(IApp::LOG_TYPE::MSG, fmt::format("Wrote {} trace events to {}.", numEvents, arg));
+        }
+    }
+    else
+    {
+        log(IApp::LOG_TYPE::ERR, "Command: trace requires on, off, or the path of the trace file as argument");
+    }
+}
+
 string App::getNextUserCommand()
 {
     string ret = "";
@@ -7,9 +7,11 @@
 #include "IApp.h"
 #include "ISocket.h"
 
+#include "CommandSocket.h"
 #include "ConfigParser.h"
-#include "MiddleWare.h"
+#include "Endpoint.h"
 #include "Logger.h"
+#include "SubmissionRing.h"
 
 namespace rgc
 {
@@ -17,9 +19,9 @@ namespace rgc
 class App : public IApp
 {
 public:
-    App(peerId_t ownPeerId, IRxSocket *pRxSocket, std::vector<ITxSocket *> &txSockets, std::string const &logFile, std::string const &pipe_path, std::optional<bitflip_t> bitFlipInfo);
+    App(config_t const &config, std::string const &pipe_path, std::string const &socket_path, std::string const &ring_name);
     virtual ~App();
-    virtual void deliverMessage(MessageId msgId, payload_t const &payload) const;
+    virtual void deliverMessages(delivery_t const *deliveries, size_t numDeliveries) const;
     virtual void run();
     virtual void log(LOG_TYPE, std::string const &msg) const;
 
@@ -27,9 +29,25 @@ private:
 
     void processPendingUserCommands();
     std::string getNextUserCommand();
+    // "on" and "off" start and stop recording, anything else is the file the recorded events are written to
+    void processTraceCommand(std::string const &arg);
+    void processPendingSocketCommands();
+    void processSocketCommand(command_t const &command);
+    // Returns the number of messages taken from the ring
+    size_t processSubmissionRing();
+    void runBusyPoll();
+    void applyLowLatencySettings();
+    void sendMessage(uint8_t const *data, size_t size);
+    void logStats() const;
+    void reloadPeers();
 
-    MiddleWare m_middleWare;
     Logger m_logger;
+    Endpoint m_endpoint;
+    CommandSocket m_commandSocket;
+    SubmissionRing m_submissionRing;
+    std::string m_configFile;
+    lowLatency_t m_lowLatency;
+    ChecksumType m_checksumType;
     std::string m_pipe_path;
     int m_pipe;
     std::vector<char> userCmdBuf;
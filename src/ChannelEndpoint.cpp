@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <poll.h>
+#include <fmt/core.h>
+
+#include "ChannelEndpoint.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Upper bound for one wait in run(), so that stop() is noticed timely
+static constexpr milliseconds MAX_POLL_WAIT = milliseconds(100);
+
+namespace rgc
+{
+
+TransmitStatus ChannelEndpoint::ChannelRxSocket::receive(rx_buffer_t &buf, struct sockaddr_in &remoteAddr) const
+{
+    TransmitStatus ret = { 0, 0 };
+    lock_guard<mutex> lock(m_mutex);
+    if (!m_datagrams.empty())
+    {
+        datagram_t const &datagram = m_datagrams.front();
+        memcpy(buf.data(), datagram.buf.data(), datagram.size);
+        remoteAddr = datagram.remoteAddr;
+        ret.transmitBytes = datagram.size;
+        ret.timestamp = datagram.timestamp;
+        m_datagrams.pop_front();
+    }
+    return ret;
+}
+
+void ChannelEndpoint::ChannelRxSocket::push(datagram_t const &datagram)
+{
+    lock_guard<mutex> lock(m_mutex);
+    // A channel whose worker falls behind must not take up all memory, its peers retransmit
+    if (m_datagrams.size() >= m_maxDatagrams)
+    {
+        m_numDrops++;
+        return;
+    }
+    m_datagrams.push_back(datagram);
+}
+
+size_t ChannelEndpoint::ChannelRxSocket::getNumDrops() const
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_numDrops;
+}
+
+ChannelEndpoint::Channel::Channel(ChannelEndpoint const &endpoint, channelConfig_t const &config, int socketDesc,
+    in_addr_t localIp, uint16_t udpPort, bool isTimestamped) :
+    m_channelId(config.channelId),
+    m_workerIdx(0),
+    m_endpoint(endpoint),
+    m_onDelivery(config.onDelivery),
+    m_rxSocket(config.maxQueuedDatagrams)
+{
+    if (config.mwConfig.multicastGroup != 0)
+    {
+        throw invalid_argument(fmt::format("Channel {}: Multicast is not supported on channels.", config.channelId));
+    }
+
+#if defined (PEER_SENDS_TO_ITSELF)
+    peer_t self { config.ownId, udpPort, localIp };
+    m_ownedTxSockets.push_back(make_unique<UdpChannelTxSocket>(self, socketDesc, m_channelId, isTimestamped));
+    m_txSockets.push_back(m_ownedTxSockets.back().get());
+#else
+    (void)localIp;
+    (void)udpPort;
+#endif
+    for (auto const &peer : config.peers)
+    {
+        m_ownedTxSockets.push_back(make_unique<UdpChannelTxSocket>(peer, socketDesc, m_channelId, isTimestamped));
+        m_txSockets.push_back(m_ownedTxSockets.back().get());
+    }
+
+    m_pMiddleWare = make_unique<MiddleWare>(this, config.ownId, &m_rxSocket, m_txSockets, std::nullopt, config.mwConfig);
+}
+
+void ChannelEndpoint::Channel::deliverMessages(delivery_t const *deliveries, size_t numDeliveries) const
+{
+    if (m_onDelivery)
+    {
+        m_onDelivery(deliveries, numDeliveries);
+    }
+}
+
+void ChannelEndpoint::Channel::log(LOG_TYPE type, string const &msg) const
+{
+    m_endpoint.log(type, fmt::format("Channel {}: {}", m_channelId, msg));
+}
+
+ChannelEndpoint::ChannelEndpoint(in_addr_t localIp, uint16_t udpPort, vector<channelConfig_t> const &channels,
+    size_t numWorkers, logCallback_t onLog, IClock const &clock) :
+    m_onLog(std::move(onLog)),
+    m_clock(clock),
+    m_isTimestamped(dynamic_cast<SystemClock const *>(&clock) != nullptr),
+    m_pRxSocket(make_unique<UdpRxSocket>(localIp, udpPort)),
+    m_channelById{},
+    m_numUnknownChannel(0),
+    m_numRxQueueDrops(0),
+    m_lastRxQueueDrops(0),
+    m_stop(false)
+{
+    if (m_pRxSocket->enableDropCounts() != 0)
+    {
+        log(IApp::LOG_TYPE::WARN, "Could not enable kernel drop counts.");
+    }
+
+    if (m_isTimestamped && (m_pRxSocket->enableTimestamps() != 0))
+    {
+        log(IApp::LOG_TYPE::WARN, "Could not enable kernel receive timestamps.");
+        m_isTimestamped = false;
+    }
+
+    for (auto const &config : channels)
+    {
+        if (m_channelById[config.channelId] != nullptr)
+        {
+            throw invalid_argument(fmt::format("Channel {} is configured twice.", config.channelId));
+        }
+        m_channels.push_back(make_unique<Channel>(*this, config, m_pRxSocket->getSocketDescriptor(), localIp, udpPort, m_isTimestamped));
+        m_channelById[config.channelId] = m_channels.back().get();
+    }
+
+    numWorkers = std::min(numWorkers, m_channels.size());
+    for (size_t i = 0; i < numWorkers; i++)
+    {
+        m_workers.push_back(make_unique<worker_t>());
+        m_workers.back()->hasDatagrams = false;
+    }
+    for (size_t i = 0; i < m_channels.size() && !m_workers.empty(); i++)
+    {
+        m_channels[i]->m_workerIdx = i % m_workers.size();
+        m_workers[m_channels[i]->m_workerIdx]->channels.push_back(m_channels[i].get());
+    }
+    m_isWorkerDue.resize(m_workers.size(), false);
+}
+
+ChannelEndpoint::~ChannelEndpoint()
+{
+    stop();
+}
+
+ChannelEndpoint::Channel &ChannelEndpoint::getChannel(channelId_t channelId) const
+{
+    Channel *pChannel = m_channelById[channelId];
+    if (pChannel == nullptr)
+    {
+        throw invalid_argument(fmt::format("Channel {} is not configured.", channelId));
+    }
+    return *pChannel;
+}
+
+SendStatus ChannelEndpoint::send(channelId_t channelId, uint8_t const *data, size_t size, system_clock::time_point const &now,
+    Priority priority, milliseconds ttl)
+{
+    Channel &channel = getChannel(channelId);
+    lock_guard<recursive_mutex> lock(channel.m_mutex);
+    return channel.m_pMiddleWare->sendMessage(data, size, now, priority, ttl);
+}
+
+mwUsage_t ChannelEndpoint::getUsage(channelId_t channelId) const
+{
+    Channel &channel = getChannel(channelId);
+    lock_guard<recursive_mutex> lock(channel.m_mutex);
+    return channel.m_pMiddleWare->getUsage();
+}
+
+size_t ChannelEndpoint::getNumChannelQueueDrops(channelId_t channelId) const
+{
+    return getChannel(channelId).m_rxSocket.getNumDrops();
+}
+
+system_clock::time_point ChannelEndpoint::getNextTimeout() const
+{
+    system_clock::time_point ret = system_clock::time_point::max();
+    for (auto const &pChannel : m_channels)
+    {
+        lock_guard<recursive_mutex> lock(pChannel->m_mutex);
+        ret = std::min(ret, pChannel->m_pMiddleWare->getNextTimeout());
+    }
+    return ret;
+}
+
+size_t ChannelEndpoint::demultiplex()
+{
+    size_t ret = 0;
+    datagram_t datagram;
+    channelId_t channelId;
+
+    for (;;)
+    {
+        TransmitStatus status = m_pRxSocket->receive(channelId, datagram.buf, datagram.remoteAddr);
+        if (status.status != 0)
+        {
+            log(IApp::LOG_TYPE::ERR, fmt::format("Error reading from Rx Socket, error code: {}", status.status));
+            break;
+        }
+        if (status.transmitBytes == 0)
+        {
+            break;
+        }
+        ret++;
+
+        // The kernel's count belongs to the shared socket, not to a channel
+        if (status.rxQueueDrops > m_lastRxQueueDrops)
+        {
+            m_numRxQueueDrops += status.rxQueueDrops - m_lastRxQueueDrops;
+            m_lastRxQueueDrops = status.rxQueueDrops;
+        }
+
+        Channel *pChannel = m_channelById[channelId];
+        if ((pChannel == nullptr) || (status.transmitBytes <= sizeof(channelId)))
+        {
+            m_numUnknownChannel++;
+            continue;
+        }
+
+        datagram.size = status.transmitBytes - sizeof(channelId);
+        datagram.timestamp = status.timestamp;
+        pChannel->m_rxSocket.push(datagram);
+        if (!m_workers.empty())
+        {
+            m_isWorkerDue[pChannel->m_workerIdx] = true;
+        }
+    }
+
+    return ret;
+}
+
+void ChannelEndpoint::runChannel(Channel &channel, system_clock::time_point const &now)
+{
+    lock_guard<recursive_mutex> lock(channel.m_mutex);
+    (void)channel.m_pMiddleWare->rxTxLoop(now);
+}
+
+size_t ChannelEndpoint::poll(system_clock::time_point const &now)
+{
+    size_t ret = demultiplex();
+    for (auto const &pChannel : m_channels)
+    {
+        runChannel(*pChannel, now);
+    }
+    return ret;
+}
+
+void ChannelEndpoint::runWorker(worker_t &worker)
+{
+    while (!m_stop)
+    {
+        system_clock::time_point nextTimeout = system_clock::time_point::max();
+        for (Channel *pChannel : worker.channels)
+        {
+            lock_guard<recursive_mutex> lock(pChannel->m_mutex);
+            nextTimeout = std::min(nextTimeout, pChannel->m_pMiddleWare->getNextTimeout());
+        }
+
+        {
+            unique_lock<mutex> lock(worker.mutex);
+            auto wait = std::clamp(duration_cast<milliseconds>(nextTimeout - m_clock.now()), milliseconds(0), MAX_POLL_WAIT);
+            worker.wakeUp.wait_for(lock, wait, [&]() { return worker.hasDatagrams || m_stop; });
+            worker.hasDatagrams = false;
+        }
+
+        auto now = m_clock.now();
+        for (Channel *pChannel : worker.channels)
+        {
+            runChannel(*pChannel, now);
+        }
+    }
+}
+
+void ChannelEndpoint::run()
+{
+    for (auto &pWorker : m_workers)
+    {
+        pWorker->thread = thread([this, &worker = *pWorker]() { runWorker(worker); });
+    }
+
+    struct pollfd pollFd = { m_pRxSocket->getSocketDescriptor(), POLLIN, 0 };
+    while (!m_stop)
+    {
+        auto wait = MAX_POLL_WAIT;
+        if (m_workers.empty())
+        {
+            wait = std::clamp(duration_cast<milliseconds>(getNextTimeout() - m_clock.now()), milliseconds(0), MAX_POLL_WAIT);
+        }
+        ::poll(&pollFd, 1, static_cast<int>(wait.count()));
+
+        if (m_workers.empty())
+        {
+            poll(m_clock.now());
+        }
+        else if (demultiplex() > 0)
+        {
+            // only the workers of channels which received something
+            for (size_t i = 0; i < m_workers.size(); i++)
+            {
+                if (m_isWorkerDue[i])
+                {
+                    m_isWorkerDue[i] = false;
+                    {
+                        lock_guard<mutex> lock(m_workers[i]->mutex);
+                        m_workers[i]->hasDatagrams = true;
+                    }
+                    m_workers[i]->wakeUp.notify_one();
+                }
+            }
+        }
+    }
+
+    for (auto &pWorker : m_workers)
+    {
+        if (pWorker->thread.joinable())
+        {
+            pWorker->thread.join();
+        }
+    }
+}
+
+void ChannelEndpoint::stop()
+{
+    m_stop = true;
+    for (auto &pWorker : m_workers)
+    {
+        lock_guard<mutex> lock(pWorker->mutex);
+        pWorker->wakeUp.notify_one();
+    }
+}
+
+void ChannelEndpoint::log(IApp::LOG_TYPE type, string const &msg) const
+{
+    if (m_onLog)
+    {
+        m_onLog(type, msg);
+    }
+}
+
+} // namespace rgc
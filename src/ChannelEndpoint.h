@@ -0,0 +1,172 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Endpoint.h"
+
+namespace rgc {
+
+typedef uint8_t channelId_t;
+
+// One group of a ChannelEndpoint. Peer-Ids, sequence numbers and windows are per channel.
+typedef struct
+{
+    channelId_t channelId;
+    peerId_t ownId;
+    std::vector<peer_t> peers; // addresses are those of the remote ChannelEndpoints
+    mwConfig_t mwConfig;       // multicast is not supported on channels
+    deliveryCallback_t onDelivery;
+    size_t maxQueuedDatagrams = 1024; // received datagrams waiting for the channel to run, further ones are dropped
+} channelConfig_t;
+
+// Several independent groups on one Udp socket: Each datagram starts with a channel byte, followed by the frame of
+// the channel's middleware. Either the owner calls poll(), which runs all channels in the calling thread, or run(),
+// which receives in the calling thread and runs the channels on a pool of worker threads, channel i on worker
+// i % numWorkers. send() and getUsage() may be called from any thread, the log callback is called from all workers.
+class ChannelEndpoint final
+{
+public:
+    // Throws if the socket can't be bound or a channel is configured twice
+    ChannelEndpoint(in_addr_t localIp, uint16_t udpPort, std::vector<channelConfig_t> const &channels, size_t numWorkers,
+        logCallback_t onLog = logCallback_t(), IClock const &clock = SystemClock::instance());
+    ~ChannelEndpoint();
+
+    ChannelEndpoint(ChannelEndpoint const &) = delete;
+    ChannelEndpoint &operator=(ChannelEndpoint const &) = delete;
+
+    // Throw std::invalid_argument for a channel which is not configured
+    SendStatus send(channelId_t channelId, uint8_t const *data, size_t size, std::chrono::system_clock::time_point const &now,
+        Priority priority = Priority::NORMAL, std::chrono::milliseconds ttl = std::chrono::milliseconds(0));
+    SendStatus send(channelId_t channelId, std::string const &message, std::chrono::system_clock::time_point const &now,
+        Priority priority = Priority::NORMAL, std::chrono::milliseconds ttl = std::chrono::milliseconds(0))
+    {
+        return send(channelId, reinterpret_cast<uint8_t const *>(message.data()), message.size(), now, priority, ttl);
+    }
+    mwUsage_t getUsage(channelId_t channelId) const;
+
+    // Receives whatever is pending and runs all channels. Returns the number of received datagrams.
+    size_t poll(std::chrono::system_clock::time_point const &now);
+
+    int getDescriptor() const
+    {
+        return m_pRxSocket->getSocketDescriptor();
+    }
+
+    std::chrono::system_clock::time_point getNextTimeout() const;
+
+    size_t getNumWorkers() const
+    {
+        return m_workers.size();
+    }
+
+    // Datagrams discarded since the start, because their channel is not configured or they carry no frame
+    size_t getNumUnknownChannelDatagrams() const
+    {
+        return m_numUnknownChannel;
+    }
+
+    // Datagrams the kernel dropped for a full receive buffer since the start, for all channels together
+    size_t getNumRxQueueDrops() const
+    {
+        return m_numRxQueueDrops;
+    }
+
+    // Datagrams dropped for a full queue of the channel since the start. Throws std::invalid_argument for a channel
+    // which is not configured.
+    size_t getNumChannelQueueDrops(channelId_t channelId) const;
+
+    // Blocks until stop() is called
+    void run();
+
+    void stop();
+
+private:
+    typedef struct
+    {
+        rx_buffer_t buf;
+        size_t size;
+        struct sockaddr_in remoteAddr;
+        std::chrono::system_clock::time_point timestamp;
+    } datagram_t;
+
+    // Datagrams of one channel, handed over from the receiving thread to the worker of the channel
+    class ChannelRxSocket final : public IRxSocket
+    {
+    public:
+        explicit ChannelRxSocket(size_t maxDatagrams) : m_maxDatagrams(maxDatagrams), m_numDrops(0) {}
+
+        virtual TransmitStatus receive(rx_buffer_t &buf, struct sockaddr_in &remoteAddr) const;
+        // Drops the datagram if the queue is full
+        void push(datagram_t const &datagram);
+        size_t getNumDrops() const;
+
+    private:
+        size_t m_maxDatagrams;
+        mutable std::mutex m_mutex;
+        mutable std::deque<datagram_t> m_datagrams;
+        size_t m_numDrops;
+    };
+
+    class Channel final : public IApp
+    {
+    public:
+        Channel(ChannelEndpoint const &endpoint, channelConfig_t const &config, int socketDesc, in_addr_t localIp,
+            uint16_t udpPort, bool isTimestamped);
+
+        virtual void deliverMessages(delivery_t const *deliveries, size_t numDeliveries) const;
+        virtual void log(LOG_TYPE type, std::string const &msg) const;
+        // The channels are run by their ChannelEndpoint
+        virtual void run() {}
+
+        channelId_t m_channelId;
+        size_t m_workerIdx;
+        ChannelEndpoint const &m_endpoint;
+        deliveryCallback_t m_onDelivery;
+        ChannelRxSocket m_rxSocket;
+        std::vector<std::unique_ptr<ITxSocket>> m_ownedTxSockets;
+        std::vector<ITxSocket *> m_txSockets;
+        std::unique_ptr<MiddleWare> m_pMiddleWare;
+        // held while the middleware runs; recursive, so that a delivery callback may send on its own channel
+        mutable std::recursive_mutex m_mutex;
+    };
+
+    typedef struct
+    {
+        std::vector<Channel *> channels;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        bool hasDatagrams;
+        std::thread thread;
+    } worker_t;
+
+    Channel &getChannel(channelId_t channelId) const;
+    // Moves the pending datagrams to the queues of their channels, returns their number
+    size_t demultiplex();
+    void runChannel(Channel &channel, std::chrono::system_clock::time_point const &now);
+    void runWorker(worker_t &worker);
+    void log(IApp::LOG_TYPE type, std::string const &msg) const;
+
+    logCallback_t m_onLog;
+    IClock const &m_clock;
+    bool m_isTimestamped;
+    std::unique_ptr<UdpRxSocket> m_pRxSocket;
+    std::vector<std::unique_ptr<Channel>> m_channels;
+    std::array<Channel *, 256> m_channelById;
+    std::vector<std::unique_ptr<worker_t>> m_workers;
+    std::vector<bool> m_isWorkerDue; // received something for the worker in the current demultiplex()
+    size_t m_numUnknownChannel;
+    size_t m_numRxQueueDrops;
+    uint32_t m_lastRxQueueDrops;
+    std::atomic<bool> m_stop;
+};
+
+} // namespace rgc
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fmt/core.h>
+
+#include "CommandSocket.h"
+
+using namespace std;
+using namespace rgc;
+
+// Largest record we accept, a client may batch frames up to that size
+static constexpr size_t MAX_RECORD_SIZE = 256 * 1024;
+static constexpr int LISTEN_BACKLOG = 16;
+// Records taken from one client per receive(), so that a busy client can't starve the others
+static constexpr size_t MAX_RECORDS_PER_CLIENT = 64;
+
+CommandSocket::CommandSocket(string const &path) :
+    m_path(path),
+    m_recordBuf(MAX_RECORD_SIZE)
+{
+    struct ::sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (path.length() >= sizeof(addr.sun_path))
+    {
+        throw std::runtime_error(fmt::format("Command socket path too long: {}.", path));
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    m_listenDesc = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenDesc < 0)
+    {
+        throw std::runtime_error("Could not create command socket.");
+    }
+
+    // a stale socket file of a previous run would make bind() fail
+    unlink(path.c_str());
+
+    if ((::bind(m_listenDesc, reinterpret_cast<struct sockaddr const *>(&addr), sizeof(addr)) < 0) ||
+        (listen(m_listenDesc, LISTEN_BACKLOG) < 0))
+    {
+        close(m_listenDesc);
+        throw std::runtime_error(fmt::format("Could not listen on command socket {}.", path));
+    }
+}
+
+CommandSocket::~CommandSocket()
+{
+    for (int clientDesc : m_clientDescs)
+    {
+        close(clientDesc);
+    }
+    close(m_listenDesc);
+    unlink(m_path.c_str());
+}
+
+vector<int> CommandSocket::getDescriptors() const
+{
+    vector<int> ret { m_listenDesc };
+    ret.insert(end(ret), begin(m_clientDescs), end(m_clientDescs));
+    return ret;
+}
+
+void CommandSocket::acceptClients()
+{
+    for (;;)
+    {
+        int clientDesc = accept4(m_listenDesc, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientDesc < 0)
+        {
+            break;
+        }
+        m_clientDescs.push_back(clientDesc);
+    }
+}
+
+size_t CommandSocket::receive(commandHandler_t const &handler)
+{
+    size_t numMalformed = 0;
+
+    acceptClients();
+
+    for (auto it = begin(m_clientDescs); it != end(m_clientDescs);)
+    {
+        bool isClosed = false;
+
+        for (size_t i = 0; i < MAX_RECORDS_PER_CLIENT; i++)
+        {
+            ssize_t rxBytes = recv(*it, m_recordBuf.data(), m_recordBuf.size(), MSG_TRUNC);
+            if (rxBytes < 0)
+            {
+                isClosed = ((errno != EAGAIN) && (errno != EWOULDBLOCK));
+                break;
+            }
+            if (rxBytes == 0)
+            {
+                isClosed = true;
+                break;
+            }
+
+            // MSG_TRUNC reports the full record length, a longer one was cut off
+            if ((static_cast<size_t>(rxBytes) > m_recordBuf.size()) ||
+                !processRecord(m_recordBuf.data(), static_cast<size_t>(rxBytes), *it, handler))
+            {
+                numMalformed++;
+            }
+        }
+
+        if (isClosed)
+        {
+            close(*it);
+            it = m_clientDescs.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    return numMalformed;
+}
+
+bool CommandSocket::processRecord(uint8_t const *record, size_t size, int clientDesc, commandHandler_t const &handler) const
+{
+    // Check the framing of the complete record first, so that it is either processed completely, or not at all
+    size_t offset = 0;
+    while (offset < size)
+    {
+        if (size - offset < COMMAND_HEADER_SIZE)
+        {
+            return false;
+        }
+
+        size_t contentSize = (record[offset + 1] << 8) + record[offset + 2];
+        offset += COMMAND_HEADER_SIZE + contentSize;
+    }
+
+    if (offset != size)
+    {
+        return false;
+    }
+
+    for (offset = 0; offset < size;)
+    {
+        size_t contentSize = (record[offset + 1] << 8) + record[offset + 2];
+        command_t command { static_cast<CommandType>(record[offset]), &record[offset + COMMAND_HEADER_SIZE], contentSize, clientDesc };
+        handler(command);
+        offset += COMMAND_HEADER_SIZE + contentSize;
+    }
+
+    return true;
+}
+
+bool CommandSocket::reply(int clientDesc, CommandType type, uint8_t const *data, size_t size, int passedDesc) const
+{
+    if (size > 0xffff)
+    {
+        return false;
+    }
+
+    vector<uint8_t> frame;
+    frame.reserve(COMMAND_HEADER_SIZE + size);
+    frame.push_back(static_cast<uint8_t>(type));
+    frame.push_back(size >> 8);
+    frame.push_back(size & 0xff);
+    frame.insert(end(frame), data, data + size);
+
+    struct iovec iov { frame.data(), frame.size() };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    // ancillary data for passing a descriptor
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    if (passedDesc >= 0)
+    {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        struct cmsghdr *pCmsg = CMSG_FIRSTHDR(&msg);
+        pCmsg->cmsg_level = SOL_SOCKET;
+        pCmsg->cmsg_type = SCM_RIGHTS;
+        pCmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(pCmsg), &passedDesc, sizeof(int));
+    }
+
+    return (sendmsg(clientDesc, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(frame.size()));
+}
+
+string CommandSocket::receiveReply(int sockDesc, CommandType type, int &passedDesc)
+{
+    passedDesc = -1;
+
+    vector<uint8_t> frame(COMMAND_HEADER_SIZE + 0xffff);
+    struct iovec iov { frame.data(), frame.size() };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t rxBytes = recvmsg(sockDesc, &msg, MSG_CMSG_CLOEXEC);
+    if (rxBytes < 0)
+    {
+        return "";
+    }
+
+    struct cmsghdr *pCmsg = CMSG_FIRSTHDR(&msg);
+    if ((pCmsg != nullptr) && (pCmsg->cmsg_level == SOL_SOCKET) && (pCmsg->cmsg_type == SCM_RIGHTS))
+    {
+        memcpy(&passedDesc, CMSG_DATA(pCmsg), sizeof(int));
+    }
+
+    size_t size = static_cast<size_t>(rxBytes);
+    if ((size < COMMAND_HEADER_SIZE) || (frame[0] != static_cast<uint8_t>(type)) ||
+        (size != COMMAND_HEADER_SIZE + (frame[1] << 8) + frame[2]))
+    {
+        if (passedDesc >= 0)
+        {
+            close(passedDesc);
+            passedDesc = -1;
+        }
+        return "";
+    }
+
+    return string(reinterpret_cast<char const *>(&frame[COMMAND_HEADER_SIZE]), size - COMMAND_HEADER_SIZE);
+}
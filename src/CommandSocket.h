@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace rgc {
+
+// Command frame: 1 Byte CommandType, 2 Bytes length of content (Network Byte Order), content.
+// A client may put any number of frames into one SOCK_SEQPACKET record.
+enum class CommandType : uint8_t
+{
+    SEND = 1,   // content: message payload
+    INJECT = 2, // content: 2 Bytes Peer-Id, 2 Bytes Seq#, 2 Bytes bit offset
+    STATS = 3,  // no content; the reply carries NUM_STATS_COUNTERS 8 Byte counters, see App
+    STOP = 4,   // no content
+    RING = 5,   // no content; the reply carries the name of the submission ring and passes its eventfd
+    RELOAD = 6, // no content; reads the peers of the config file again
+};
+
+static constexpr size_t COMMAND_HEADER_SIZE = 3;
+static constexpr size_t NUM_STATS_COUNTERS = 16;
+
+typedef struct
+{
+    CommandType type;
+    uint8_t const *data; // valid only during the command handler
+    size_t size;
+    int clientDesc; // for replying to the client which sent the command
+} command_t;
+
+typedef std::function<void(command_t const &command)> commandHandler_t;
+
+// Listening SOCK_SEQPACKET Unix domain socket, which serves any number of clients at once
+class CommandSocket final
+{
+public:
+    explicit CommandSocket(std::string const &path);
+    ~CommandSocket();
+
+    // Accepts pending clients and passes all commands they sent to the handler, without blocking.
+    // Returns the number of malformed records, which were dropped.
+    size_t receive(commandHandler_t const &handler);
+
+    // Sends a single frame back to a client, optionally passing a descriptor to it
+    bool reply(int clientDesc, CommandType type, uint8_t const *data, size_t size, int passedDesc = -1) const;
+
+    // Client side: Blocks for a reply frame of the given type and returns its content. A passed descriptor
+    // is stored in passedDesc, which is -1 otherwise.
+    static std::string receiveReply(int sockDesc, CommandType type, int &passedDesc);
+
+    // Descriptors which become readable when receive() has something to do
+    std::vector<int> getDescriptors() const;
+
+private:
+    void acceptClients();
+    bool processRecord(uint8_t const *record, size_t size, int clientDesc, commandHandler_t const &handler) const;
+
+    std::string m_path;
+    int m_listenDesc;
+    std::vector<int> m_clientDescs;
+    std::vector<uint8_t> m_recordBuf;
+};
+
+} // namespace rgc
@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <chrono>
 
 #include <arpa/inet.h>
 
@@ -10,7 +11,9 @@ namespace rgc
 {
 
 typedef uint16_t peerId_t;
-typedef uint16_t seqNr_t;
+typedef uint32_t seqNr_t;     // extended sequence number: epoch in the upper, wire sequence number in the lower 16 bits
+typedef uint16_t wireSeqNr_t; // sequence number as it is transmitted in the frame header
+typedef uint16_t epoch_t;     // upper 16 bits of an extended sequence number, never transmitted
 typedef uint16_t checksum_t;
 
 typedef struct
@@ -23,7 +26,7 @@ typedef struct
 typedef struct
 {
     peerId_t peerId;
-    seqNr_t seqNrId;
+    wireSeqNr_t seqNrId;
     uint16_t bitOffset; // offset of bit to flip
 } bitflip_t;
 
@@ -48,4 +51,125 @@ private:
 
 typedef std::vector<uint8_t> payload_t; 
 
+// View of a delivered message without header and checksum. The data belongs to the middleware
+// and is only valid during the delivery callback.
+typedef struct
+{
+    MessageId msgId;
+    uint8_t const *data;
+    size_t size;
+} delivery_t;
+
+// How messages are passed on by the peers receiving them
+enum class Dissemination : uint8_t
+{
+    FLOOD,  // every peer relays a new message to all peers
+    GOSSIP  // every peer relays a new message to a random subset of the peers, anti-entropy digests repair the rest
+};
+
+// How a peer treats new messages of other peers while its in-flight budget is exhausted
+enum class RelayPolicy : uint8_t
+{
+    ADMIT, // accept and relay the message anyway, only our own messages are blocked
+    DEFER  // neither acknowledge nor accept the message, the remote peer retransmits it later
+};
+
+// Checksum trailer of all frames
+enum class ChecksumType : uint8_t
+{
+    RFC1071, // 2 Bytes ones' complement sum
+    CRC32C   // 4 Bytes CRC32C, detects reordered words and multi-bit errors the sum misses
+};
+
+// How lost messages are recovered
+enum class Reliability : uint8_t
+{
+    ACK, // every peer acknowledges every message, delivery waits for the ACKs of all peers
+    NACK // the origin sends a message once, receivers request missing ones; delivery in origin order without agreement
+};
+
+// Lane of a message: Under load, the messages of a higher lane are transmitted and retransmitted first
+enum class Priority : uint8_t
+{
+    URGENT = 0,
+    NORMAL = 1,
+    BULK = 2
+};
+
+// Settings of the middleware. Except for the in-flight budget, all peers of a group must use the same ones
+typedef struct
+{
+    Dissemination dissemination = Dissemination::FLOOD;
+    uint16_t gossipFanOut = 3; // number of peers a message is relayed to, not counting the peer itself
+    std::chrono::milliseconds antiEntropyInterval = std::chrono::milliseconds(500);
+    uint16_t gossipRetention = 256; // number of received messages kept for answering digests
+    in_addr_t multicastGroup = 0; // IP V4 multicast group in network byte order, 0 if multicast is not used
+    uint16_t multicastPort = 0;
+    uint8_t multicastTtl = 1;
+    // in-flight budget, 0 means unlimited
+    size_t maxInFlightPerOrigin = 0; // number of messages of the same origin peer
+    size_t maxPayloadBytes = 0;      // sum of the payloads of all messages
+    size_t maxStateBytes = 0;        // estimated memory used by the states of all messages, including their payloads
+    RelayPolicy relayPolicy = RelayPolicy::ADMIT;
+    // failure detector, a heartbeat interval of 0 disables it
+    std::chrono::milliseconds heartbeatInterval = std::chrono::milliseconds(0);
+    std::chrono::milliseconds suspectTimeout = std::chrono::milliseconds(1000); // silence after which a peer is suspected
+    uint8_t txLossPercent = 0; // fault injection: share of outgoing datagrams which are dropped instead of sent
+    ChecksumType checksumType = ChecksumType::RFC1071;
+    // messages of at least this size are deflated; 0 disables compression, and the flags byte of data frames with it
+    size_t compressionThresholdBytes = 0;
+    // kernel buffers of the Udp socket, 0 keeps the system default
+    size_t socketRcvBufBytes = 0;
+    size_t socketSndBufBytes = 0;
+    Reliability reliability = Reliability::ACK;
+    // NACK mode: interval of the status messages confirming received messages and of repeated NACKs
+    std::chrono::milliseconds statusInterval = std::chrono::milliseconds(100);
+    // forward error correction: number of own messages per XOR parity frame, 0 disables it
+    uint8_t fecBlockSize = 0;
+    // data frames carry the priority and time to live of their message, so that relays honor them as well
+    bool priorityLanes = false;
+    // egress pacing: token bucket rates for all datagrams and for those to each peer, 0 is unlimited
+    size_t paceBytesPerSec = 0;
+    size_t pacePacketsPerSec = 0;
+    size_t pacePeerBytesPerSec = 0;
+    size_t pacePeerPacketsPerSec = 0;
+    std::chrono::milliseconds paceBurst = std::chrono::milliseconds(10); // tokens a bucket holds at most
+} mwConfig_t;
+
+// Current usage of the in-flight budget
+typedef struct
+{
+    size_t numMessages;
+    size_t payloadBytes;
+    size_t stateBytes;
+    size_t maxInFlightOfOrigin; // largest number of messages of one origin peer
+    size_t numBlockedSends;     // messages of our own rejected since the start
+    size_t numDeferredRelays;   // messages of other peers not accepted due to the relay policy since the start
+    size_t numTxDatagrams;      // datagrams of all kinds sent since the start, including dropped ones
+    size_t numDroppedDatagrams; // datagrams dropped by the tx loss fault injection since the start
+    size_t numRxQueueDrops;     // datagrams the kernel dropped for a full socket receive buffer since the start
+    size_t numTxSocketDrops;    // datagrams the kernel refused for a full send buffer (ENOBUFS, EAGAIN) since the start
+    // time from the kernel receive timestamp of a datagram until the middleware processes it
+    size_t numRxTimestamps;     // datagrams received with a kernel timestamp since the start
+    size_t rxDelayNsSum;
+    size_t rxDelayNsMax;
+    size_t numFecRecovered;     // lost messages rebuilt from a parity frame since the start
+    size_t numExpired;          // messages dropped since the start because their time to live elapsed
+    size_t numUnconfirmedEvictions; // retained messages evicted before the digests of all live peers covered them, since the start
+    // time a transmission waited for the pacing token buckets after it was due
+    size_t numPacedDatagrams;   // transmissions deferred by pacing since the start
+    size_t pacingDelayNsSum;
+    size_t pacingDelayNsMax;
+} mwUsage_t;
+
+// Round trip time to a peer, from sending a message until the kernel received its ACK. Smoothed as in RFC 6298,
+// retransmitted messages are not sampled.
+typedef struct
+{
+    std::chrono::nanoseconds srtt;
+    std::chrono::nanoseconds rttVar;
+    size_t numSamples;
+} rttStats_t;
+
+
 }
\ No newline at end of file
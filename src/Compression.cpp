@@ -0,0 +1,39 @@
+#include <zlib.h>
+
+#include "Compression.h"
+
+namespace rgc
+{
+
+payload_t deflateData(uint8_t const *data, size_t size)
+{
+    payload_t ret(compressBound(size));
+    uLongf deflatedSize = ret.size();
+    if ((compress2(ret.data(), &deflatedSize, data, size, Z_BEST_SPEED) != Z_OK) || (deflatedSize >= size))
+    {
+        return {};
+    }
+
+    ret.resize(deflatedSize);
+    return ret;
+}
+
+std::optional<payload_t> inflateData(uint8_t const *data, size_t size, size_t inflatedSize)
+{
+    if (inflatedSize > MAX_INFLATED_BYTES)
+    {
+        return std::nullopt;
+    }
+
+    payload_t ret(inflatedSize);
+    uLongf actualSize = ret.size();
+    uLong srcSize = size;
+    if ((uncompress2(ret.data(), &actualSize, data, &srcSize) != Z_OK) || (actualSize != inflatedSize) || (srcSize != size))
+    {
+        return std::nullopt;
+    }
+
+    return ret;
+}
+
+} // namespace rgc
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "CommonTypes.h"
+
+namespace rgc {
+
+// Messages are inflated to at most this size, like the records of the command socket
+static constexpr size_t MAX_INFLATED_BYTES = 256 * 1024;
+
+// zlib deflate at the fastest level; empty if the result would not be smaller than the data
+payload_t deflateData(uint8_t const *data, size_t size);
+// Nothing if the data is corrupt or does not inflate to exactly inflatedSize bytes
+std::optional<payload_t> inflateData(uint8_t const *data, size_t size, size_t inflatedSize);
+
+} // namespace rgc
@@ -1,8 +1,11 @@
 #include <filesystem>
 #include <algorithm>
+#include <charconv>
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <string_view>
+#include <unordered_set>
 #include <unistd.h>
 
 #include "ConfigParser.h"
@@ -22,6 +25,7 @@ static constexpr char const * DEFAULT_CONFIG_FILE = "./peer.cfg";
 static constexpr char SEPARATOR_CONFIG_FILE = ',';
 static constexpr char SEPARATOR_BIT_FLIP = ':';
 static constexpr char COMMENT_TOKEN_CONFIG_FILE = '#';
+static constexpr char SEPARATOR_OPTION = '=';
 
 template<typename T>
 static T safeStrToI(char const *str, T defaultValue)
@@ -33,45 +37,230 @@ static T safeStrToI(char const *str, T defaultValue)
     return (ss.eof()) ? val : defaultValue;
 }
 
-static optional<peer_t> parseLine(string const &line)
+static bool isValidPeerId(peerId_t peerId)
 {
-    optional<peer_t> ret;
-    string field;
-    peer_t tmp = { INVALID_PEER_ID, INVALID_PORT_NUM, 0 };
+    return (peerId != INVALID_PEER_ID);
+}
 
-    if ((line.size() > 0) && (line[0] != COMMENT_TOKEN_CONFIG_FILE))
-    {
-        stringstream ss(line);
-        getline(ss, field, SEPARATOR_CONFIG_FILE);
-        tmp.peerId = safeStrToI(field.c_str(), INVALID_PEER_ID);
-        getline(ss, field, SEPARATOR_CONFIG_FILE);
+static bool isValidUdpPort(uint16_t udpPort)
+{
+    return ((udpPort > 1024) && (udpPort != INVALID_PORT_NUM));
+}
+
+// Parses lines of the format <option>=<value>
+static bool parseOptionLine(string const &key, string const &value, mwConfig_t &mwConfig, string const &location)
+{
+    bool ret = true;
 
+    if (key == "dissemination")
+    {
+        if (value == "flood")
+        {
+            mwConfig.dissemination = Dissemination::FLOOD;
+        }
+        else if (value == "gossip")
+        {
+            mwConfig.dissemination = Dissemination::GOSSIP;
+        }
+        else
+        {
+            ret = false;
+        }
+    }
+    else if (key == "gossip_fanout")
+    {
+        mwConfig.gossipFanOut = safeStrToI(value.c_str(), static_cast<uint16_t>(0));
+        ret = (mwConfig.gossipFanOut > 0);
+    }
+    else if (key == "anti_entropy_interval_ms")
+    {
+        uint32_t ms = safeStrToI(value.c_str(), static_cast<uint32_t>(0));
+        mwConfig.antiEntropyInterval = std::chrono::milliseconds(ms);
+        ret = (ms > 0);
+    }
+    else if (key == "gossip_retention")
+    {
+        mwConfig.gossipRetention = safeStrToI(value.c_str(), static_cast<uint16_t>(0));
+        ret = (mwConfig.gossipRetention > 0);
+    }
+    else if (key == "multicast_group")
+    {
         in_addr tmpAddr;
-        if (inet_aton(field.c_str(), &tmpAddr) < 0)
+        ret = ((inet_aton(value.c_str(), &tmpAddr) != 0) && IN_MULTICAST(ntohl(tmpAddr.s_addr)));
+        mwConfig.multicastGroup = ret ? tmpAddr.s_addr : 0;
+    }
+    else if (key == "multicast_port")
+    {
+        uint16_t port = safeStrToI(value.c_str(), INVALID_PORT_NUM);
+        ret = isValidUdpPort(port);
+        mwConfig.multicastPort = ret ? port : 0;
+    }
+    else if (key == "multicast_ttl")
+    {
+        uint16_t ttl = safeStrToI(value.c_str(), static_cast<uint16_t>(UINT16_MAX));
+        ret = (ttl <= UINT8_MAX);
+        mwConfig.multicastTtl = ret ? static_cast<uint8_t>(ttl) : 1;
+    }
+    else if (key == "max_in_flight_per_origin")
+    {
+        mwConfig.maxInFlightPerOrigin = safeStrToI(value.c_str(), SIZE_MAX);
+        ret = (mwConfig.maxInFlightPerOrigin != SIZE_MAX);
+    }
+    else if (key == "max_payload_bytes")
+    {
+        mwConfig.maxPayloadBytes = safeStrToI(value.c_str(), SIZE_MAX);
+        ret = (mwConfig.maxPayloadBytes != SIZE_MAX);
+    }
+    else if (key == "max_state_bytes")
+    {
+        mwConfig.maxStateBytes = safeStrToI(value.c_str(), SIZE_MAX);
+        ret = (mwConfig.maxStateBytes != SIZE_MAX);
+    }
+    else if (key == "relay_policy")
+    {
+        if (value == "admit")
         {
-            cerr << "Detected invalid IP V4 address: " << field << ".\n";
-            return ret;
+            mwConfig.relayPolicy = RelayPolicy::ADMIT;
+        }
+        else if (value == "defer")
+        {
+            mwConfig.relayPolicy = RelayPolicy::DEFER;
+        }
+        else
+        {
+            ret = false;
+        }
+    }
+    else if (key == "checksum")
+    {
+        if (value == "rfc1071")
+        {
+            mwConfig.checksumType = ChecksumType::RFC1071;
+        }
+        else if (value == "crc32c")
+        {
+            mwConfig.checksumType = ChecksumType::CRC32C;
+        }
+        else
+        {
+            ret = false;
         }
-        tmp.peerIpAddress = tmpAddr.s_addr;
+    }
+    else if (key == "compression_threshold_bytes")
+    {
+        mwConfig.compressionThresholdBytes = safeStrToI(value.c_str(), SIZE_MAX);
+        ret = (mwConfig.compressionThresholdBytes != SIZE_MAX);
+    }
+    else if (key == "heartbeat_interval_ms")
+    {
+        uint32_t ms = safeStrToI(value.c_str(), UINT32_MAX);
+        mwConfig.heartbeatInterval = std::chrono::milliseconds(ms);
+        ret = (ms != UINT32_MAX);
+    }
+    else if (key == "suspect_timeout_ms")
+    {
+        uint32_t ms = safeStrToI(value.c_str(), static_cast<uint32_t>(0));
+        mwConfig.suspectTimeout = std::chrono::milliseconds(ms);
+        ret = (ms > 0);
+    }
+    else if (key == "tx_loss_percent")
+    {
+        uint16_t percent = safeStrToI(value.c_str(), static_cast<uint16_t>(UINT16_MAX));
+        ret = (percent <= 100);
+        mwConfig.txLossPercent = ret ? static_cast<uint8_t>(percent) : 0;
+    }
+    else if (key == "reliability")
+    {
+        if (value == "ack")
+        {
+            mwConfig.reliability = Reliability::ACK;
+        }
+        else if (value == "nack")
+        {
+            mwConfig.reliability = Reliability::NACK;
+        }
+        else
+        {
+            ret = false;
+        }
+    }
+    else if (key == "status_interval_ms")
+    {
+        uint32_t ms = safeStrToI(value.c_str(), static_cast<uint32_t>(0));
+        mwConfig.statusInterval = std::chrono::milliseconds(ms);
+        ret = (ms > 0);
+    }
+    else if (key == "fec_block_size")
+    {
+        uint16_t blockSize = safeStrToI(value.c_str(), static_cast<uint16_t>(UINT16_MAX));
+        ret = ((blockSize == 0) || ((blockSize >= 2) && (blockSize <= UINT8_MAX)));
+        mwConfig.fecBlockSize = ret ? static_cast<uint8_t>(blockSize) : 0;
+    }
+    else if (key == "priority_lanes")
+    {
+        if (value == "on")
+        {
+            mwConfig.priorityLanes = true;
+        }
+        else if (value == "off")
+        {
+            mwConfig.priorityLanes = false;
+        }
+        else
+        {
+            ret = false;
+        }
+    }
+    else if (key == "pace_bytes_per_sec")
+    {
+        mwConfig.paceBytesPerSec = safeStrToI(value.c_str(), SIZE_MAX);
+        ret = (mwConfig.paceBytesPerSec != SIZE_MAX);
+    }
+    else if (key == "pace_packets_per_sec")
+    {
+        mwConfig.pacePacketsPerSec = safeStrToI(value.c_str(), SIZE_MAX);
+        ret = (mwConfig.pacePacketsPerSec != SIZE_MAX);
+    }
+    else if (key == "pace_peer_bytes_per_sec")
+    {
+        mwConfig.pacePeerBytesPerSec = safeStrToI(value.c_str(), SIZE_MAX);
+        ret = (mwConfig.pacePeerBytesPerSec != SIZE_MAX);
+    }
+    else if (key == "pace_peer_packets_per_sec")
+    {
+        mwConfig.pacePeerPacketsPerSec = safeStrToI(value.c_str(), SIZE_MAX);
+        ret = (mwConfig.pacePeerPacketsPerSec != SIZE_MAX);
+    }
+    else if (key == "pace_burst_ms")
+    {
+        uint32_t ms = safeStrToI(value.c_str(), static_cast<uint32_t>(0));
+        mwConfig.paceBurst = std::chrono::milliseconds(ms);
+        ret = (ms > 0);
+    }
+    else if (key == "socket_rcvbuf_bytes")
+    {
+        mwConfig.socketRcvBufBytes = safeStrToI(value.c_str(), SIZE_MAX);
+        ret = (mwConfig.socketRcvBufBytes != SIZE_MAX);
+    }
+    else if (key == "socket_sndbuf_bytes")
+    {
+        mwConfig.socketSndBufBytes = safeStrToI(value.c_str(), SIZE_MAX);
+        ret = (mwConfig.socketSndBufBytes != SIZE_MAX);
+    }
+    else
+    {
+        cerr << location << "Unknown option: " << key << ".\n";
+        return false;
+    }
 
-        getline(ss, field, SEPARATOR_CONFIG_FILE);
-        tmp.peerUdpPort = safeStrToI(field.c_str(), INVALID_PORT_NUM);
-        ret = tmp;
+    if (!ret)
+    {
+        cerr << location << "Invalid value for option " << key << ": " << value << ".\n";
     }
 
     return ret;
 }
 
-static bool isValidPeerId(peerId_t peerId)
-{
-    return (peerId != INVALID_PEER_ID);
-}
-
-static bool isValidUdpPort(uint16_t udpPort)
-{
-    return ((udpPort > 1024) && (udpPort != INVALID_PORT_NUM));
-}
-
 optional<bitflip_t> rgc::getBitFlipInfo(string const &bitFlip)
 {
     optional<bitflip_t> ret = std::nullopt;
@@ -93,7 +282,7 @@ optional<bitflip_t> rgc::getBitFlipInfo(string const &bitFlip)
         // extra ugly code for MACs :-)
         bitflip_t tmp;
         tmp.peerId = static_cast<peerId_t>(intPeerId);
-        tmp.seqNrId = static_cast<seqNr_t>(intMsgIdx);
+        tmp.seqNrId = static_cast<wireSeqNr_t>(intMsgIdx);
         tmp.bitOffset = static_cast<uint16_t>(intBitOffset);
         ret = make_optional<bitflip_t>(tmp);
     }
@@ -101,73 +290,156 @@ optional<bitflip_t> rgc::getBitFlipInfo(string const &bitFlip)
     return ret;
 }
 
-static bool isValid(peer_t const &peer, vector<peer_t> const &otherPeers)
+static string_view trim(string_view sv)
 {
-    bool ret = (isValidPeerId(peer.peerId) && isValidUdpPort(peer.peerUdpPort));
+    size_t first = sv.find_first_not_of(" \t\r");
+    if (first == string_view::npos)
+    {
+        return string_view();
+    }
+    return sv.substr(first, sv.find_last_not_of(" \t\r") - first + 1);
+}
 
-    if (ret)
+template<typename T>
+static bool parseNumber(string_view field, T &val)
+{
+    auto result = from_chars(field.data(), field.data() + field.size(), val);
+    return (result.ec == std::errc()) && (result.ptr == field.data() + field.size());
+}
+
+// Parses lines of the format <peerId>,<ipaddr>,<udpPort> without copying the line
+static optional<peer_t> parsePeerLine(string_view line, string const &location)
+{
+    size_t sep1 = line.find(SEPARATOR_CONFIG_FILE);
+    size_t sep2 = (sep1 == string_view::npos) ? sep1 : line.find(SEPARATOR_CONFIG_FILE, sep1 + 1);
+    if ((sep2 == string_view::npos) || (line.find(SEPARATOR_CONFIG_FILE, sep2 + 1) != string_view::npos))
     {
-        auto it = find_if(begin(otherPeers), end(otherPeers), 
-            [peer](auto const &other) 
-            { 
-                return other.peerId == peer.peerId;
-            }
-        );
+        cerr << location << "Expected <peerId>,<ipaddr>,<udpPort>: " << line << ".\n";
+        return std::nullopt;
+    }
+
+    string_view fields[] = { trim(line.substr(0, sep1)), trim(line.substr(sep1 + 1, sep2 - sep1 - 1)), trim(line.substr(sep2 + 1)) };
+
+    peer_t ret = { INVALID_PEER_ID, INVALID_PORT_NUM, 0 };
+    if (!parseNumber(fields[0], ret.peerId) || !isValidPeerId(ret.peerId))
+    {
+        cerr << location << "Invalid Peer ID: " << fields[0] << ".\n";
+        return std::nullopt;
+    }
+
+    // inet_aton() needs a terminated string
+    char ipaddr[INET_ADDRSTRLEN] = {};
+    in_addr tmpAddr;
+    if ((fields[1].size() >= sizeof(ipaddr)) || (fields[1].copy(ipaddr, sizeof(ipaddr) - 1) == 0) || (inet_aton(ipaddr, &tmpAddr) == 0))
+    {
+        cerr << location << "Detected invalid IP V4 address: " << fields[1] << ".\n";
+        return std::nullopt;
+    }
+    ret.peerIpAddress = tmpAddr.s_addr;
 
-        if (it != end(otherPeers))
+    if (!parseNumber(fields[2], ret.peerUdpPort) || !isValidUdpPort(ret.peerUdpPort))
+    {
+        cerr << location << "Udp port number must be in the range [1025.." << (INVALID_PORT_NUM - 1) << "]: " << fields[2] << ".\n";
+        return std::nullopt;
+    }
+
+    return ret;
+}
+
+// Reads the whole file at once and parses it in a single pass. Duplicates are detected via hash sets, so that
+// loading stays linear in the number of peers. All errors are reported, then the file is rejected.
+static optional<vector<peer_t>> readConfigFile(string const &configFilePath, mwConfig_t &mwConfig)
+{
+    ifstream ifs(configFilePath, ios::binary);
+    string content(file_size(configFilePath), '\0');
+    if (!ifs.read(content.data(), content.size()))
+    {
+        cerr << "Failed to read " << configFilePath << ".\n";
+        return std::nullopt;
+    }
+
+    size_t numLines = std::count(begin(content), end(content), '\n') + 1;
+    vector<peer_t> peers;
+    unordered_set<peerId_t> peerIds;
+    unordered_set<uint64_t> peerAddrs; // IP address and Udp port
+    peers.reserve(numLines);
+    peerIds.reserve(numLines);
+    peerAddrs.reserve(numLines);
+
+    bool error = false;
+    string_view rest(content);
+    for (size_t lineNr = 1; !rest.empty(); lineNr++)
+    {
+        size_t eol = rest.find('\n');
+        string_view line = trim(rest.substr(0, eol));
+        rest = (eol == string_view::npos) ? string_view() : rest.substr(eol + 1);
+
+        if (line.empty() || (line[0] == COMMENT_TOKEN_CONFIG_FILE))
         {
-            cerr << "Found duplicate Peer ID: " << peer.peerId << ".\n";
-            ret = false;
+            continue;
+        }
+
+        string location = configFilePath + ":" + to_string(lineNr) + ": ";
+        size_t sepOption = line.find(SEPARATOR_OPTION);
+        if (sepOption != string_view::npos)
+        {
+            error |= !parseOptionLine(string(trim(line.substr(0, sepOption))), string(trim(line.substr(sepOption + 1))), mwConfig, location);
+            continue;
+        }
+
+        optional<peer_t> optPeer = parsePeerLine(line, location);
+        if (!optPeer.has_value())
+        {
+            error = true;
+            continue;
+        }
+
+        peer_t const &peer = *optPeer;
+        if (!peerIds.insert(peer.peerId).second)
+        {
+            cerr << location << "Found duplicate Peer ID: " << peer.peerId << ".\n";
+            error = true;
+        }
+        else if (!peerAddrs.insert((static_cast<uint64_t>(peer.peerIpAddress) << 16) | peer.peerUdpPort).second)
+        {
+            cerr << location << "Found duplicate Ip Address/Udp Port entry: " << peer.peerIpAddress << "/" << peer.peerUdpPort << ".\n";
+            error = true;
         }
         else
         {
-            auto it = find_if(begin(otherPeers), end(otherPeers), 
-                [peer](auto const &other) 
-                { 
-                    return ((other.peerIpAddress == peer.peerIpAddress) && 
-                            (other.peerUdpPort == peer.peerUdpPort));
-                }
-            );
-            if (it != end(otherPeers))
-            {
-                cerr << "Found duplicate Ip Address/Udp Port entry: " << peer.peerIpAddress << "/" << peer.peerUdpPort << ".\n";
-                ret = false;
-            }
+            peers.push_back(peer);
         }
     }
 
-    return ret;
+    if (error)
+    {
+        return std::nullopt;
+    }
+
+    return peers;
 }
 
-static vector<peer_t> readConfigFile(string const &configFilePath)
+std::optional<vector<peer_t>> rgc::readPeersFromConfigFile(string const &configFile)
 {
-    vector<peer_t> ret; 
-    string line;
-
-    ifstream ifs(configFilePath);
-
-    while (ifs.good() && !ifs.eof())
+    mwConfig_t mwConfig;
+    path cfgFilePath(configFile);
+    if (!exists(cfgFilePath) || !is_regular_file(cfgFilePath))
     {
-        getline(ifs, line);
-        optional<peer_t> optPeer = parseLine(line);
-        if (optPeer.has_value() && isValid(*optPeer, ret))
-        {
-            ret.push_back(*optPeer);
-        }
+        cerr << configFile << " must be a valid regular file\n";
+        return std::nullopt;
     }
-    
-    return ret;
+    return readConfigFile(configFile, mwConfig);
 }
 
 std::optional<config_t> rgc::getConfigFromOptions(int argc, char *argv[])
 {
     optional<config_t> ret;
-    config_t parsed_values{ DEFAULT_PEER_ID, DEFAULT_IP_ADDRESS, DEFAULT_IP, DEFAULT_PORT_NUM, "", {}, {}, {}, std::nullopt };
+    config_t parsed_values{ DEFAULT_PEER_ID, DEFAULT_IP_ADDRESS, DEFAULT_IP, DEFAULT_PORT_NUM, "", "", {}, {}, {}, {}, std::nullopt, IoBackend::SOCKET, { false, 0, -1, 0 }, "", false };
     bool error = false;   
     int8_t c; // in contrast to Intel, char seems to be unsigned on ARM, int8_t works on both architectures
     string configFile = DEFAULT_CONFIG_FILE;
 
-    while ((c = getopt (argc, argv, "i:a:p:c:l:e:")) != -1)
+    while ((c = getopt (argc, argv, "i:a:p:c:l:e:b:sk:C:M:w:t")) != -1)
     {
         switch (c)
         {
@@ -189,9 +461,60 @@ std::optional<config_t> rgc::getConfigFromOptions(int argc, char *argv[])
         case 'e':
             parsed_values.errorInjection = optarg;
         break;
+        case 'b':
+            if (string(optarg) == "uring")
+            {
+                parsed_values.ioBackend = IoBackend::URING;
+            }
+            else if (string(optarg) != "socket")
+            {
+                cerr << "I/O backend must be socket or uring\n";
+                error = true;
+            }
+        break;
+        case 's':
+            parsed_values.lowLatency.isBusyPoll = true;
+        break;
+        case 'k':
+            parsed_values.lowLatency.socketBusyPollUs = safeStrToI(optarg, UINT32_MAX);
+            if (parsed_values.lowLatency.socketBusyPollUs == UINT32_MAX)
+            {
+                cerr << "Socket busy poll time must be a number of microseconds\n";
+                error = true;
+            }
+        break;
+        case 'C':
+            parsed_values.lowLatency.cpu = safeStrToI(optarg, -1);
+            if (parsed_values.lowLatency.cpu < 0)
+            {
+                cerr << "CPU must be a non-negative number\n";
+                error = true;
+            }
+        break;
+        case 'w':
+            parsed_values.walPath = optarg;
+        break;
+        case 't':
+            parsed_values.isTracing = true;
+        break;
+        case 'M':
+        {
+            uint32_t prefaultMiB = safeStrToI(optarg, UINT32_MAX);
+            if (prefaultMiB == UINT32_MAX)
+            {
+                cerr << "Pre-faulted memory must be a number of MiB\n";
+                error = true;
+            }
+            else
+            {
+                // at least lock the memory
+                parsed_values.lowLatency.prefaultBytes = std::max(static_cast<size_t>(prefaultMiB) << 20, static_cast<size_t>(1));
+            }
+        }
+        break;
         case '?':
         {
-            if (optopt == 'i' || optopt == 'a' || optopt == 'p' || optopt == 'c' || optopt == 'l' || optopt == 'e')
+            if (optopt == 'i' || optopt == 'a' || optopt == 'p' || optopt == 'c' || optopt == 'l' || optopt == 'e' || optopt == 'b' || optopt == 'k' || optopt == 'C' || optopt == 'M')
             {
                 cerr << "Option -" << optopt << "requires an argument\n";
             }
@@ -252,6 +575,16 @@ std::optional<config_t> rgc::getConfigFromOptions(int argc, char *argv[])
             }
         }
 
+        if (parsed_values.walPath.length())
+        {
+            path walFolderPath = path(parsed_values.walPath).parent_path();
+            if (!walFolderPath.empty() && (!exists(walFolderPath) || !is_directory(walFolderPath)))
+            {
+                cerr << parsed_values.walPath << " must be in a folder which already exists.\n";
+                error = true;
+            }
+        }
+
 
         if (!parsed_values.errorInjection.empty())
         {
@@ -276,10 +609,29 @@ std::optional<config_t> rgc::getConfigFromOptions(int argc, char *argv[])
         }
         else
         {
-            parsed_values.peers = readConfigFile(configFile);
+            parsed_values.configFile = configFile;
+            auto optPeers = readConfigFile(configFile, parsed_values.mwConfig);
+            error = !optPeers.has_value();
+            if (!error)
+            {
+                parsed_values.peers = std::move(*optPeers);
+            }
         }
     }
 
+    if (!error && (parsed_values.mwConfig.heartbeatInterval.count() > 0) && 
+        (parsed_values.mwConfig.suspectTimeout <= parsed_values.mwConfig.heartbeatInterval))
+    {
+        cerr << "Option suspect_timeout_ms must exceed option heartbeat_interval_ms.\n";
+        error = true;
+    }
+
+    if (!error && (parsed_values.mwConfig.multicastGroup != 0) && (parsed_values.mwConfig.multicastPort == 0))
+    {
+        cerr << "Option multicast_group requires option multicast_port.\n";
+        error = true;
+    }
+
     if (!error)
     {
         ret = parsed_values;
@@ -290,12 +642,19 @@ std::optional<config_t> rgc::getConfigFromOptions(int argc, char *argv[])
 
 void rgc::printUsage(char *argv0)
 {
-    cerr << "Usage: " << argv0 << " [-i <peerId>] [-a <ipaddr>] [-p <udpPort>] [-c <configFile>] [-l <logFile>] [-e <errorInject>]\n";
+    cerr << "Usage: " << argv0 << " [-i <peerId>] [-a <ipaddr>] [-p <udpPort>] [-c <configFile>] [-l <logFile>] [-e <errorInject>] [-b <ioBackend>] [-s] [-k <busyPollUs>] [-C <cpu>] [-M <prefaultMiB>] [-w <walPath>] [-t]\n";
     cerr << "   <peerId>        unique peer id in the range [0.." << INVALID_PEER_ID - 1 << "], default is " << DEFAULT_PEER_ID <<".\n";
     cerr << "   <ipaddr>        local IPV4 address, default is " << DEFAULT_IP_ADDRESS <<".\n";
     cerr << "   <udpPort>       local udp port in the range [1025.." << INVALID_PORT_NUM - 1 << "], default is " << DEFAULT_PORT_NUM << ".\n";
     cerr << "   <configFile>    path to an already existing configuration file, default is " << DEFAULT_CONFIG_FILE << ".\n";
     cerr << "   <logFile>       path to log file. If none is provided stdout/stderr is used.\n";
     cerr << "   <errorInject>   string of format <peer id>:<msg seq#>:<bit offset> to inject a bit error on the given offset in the specified message of the given peer.\n";
+    cerr << "   <ioBackend>     socket or uring (io_uring, falls back to socket if unsupported), default is socket.\n";
+    cerr << "   -s              spin on the sockets instead of sleeping, for the lowest latency at the cost of a CPU.\n";
+    cerr << "   <busyPollUs>    SO_BUSY_POLL time of the rx socket in microseconds, default is 0 (off).\n";
+    cerr << "   <cpu>           pins the peer to this CPU, default is off.\n";
+    cerr << "   <prefaultMiB>   locks all memory of the peer and pre-faults this much heap for message states, default is off.\n";
+    cerr << "   <walPath>       path prefix of the write-ahead log, which a restarted peer resumes from, default is off.\n";
+    cerr << "   -t              records the phases of the event loop from the start, for the trace command.\n";
 }
 
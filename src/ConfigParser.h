@@ -9,6 +9,22 @@
 
 namespace rgc {
 
+// How the peer talks to its Udp socket
+enum class IoBackend : uint8_t
+{
+    SOCKET, // one recvfrom()/sendto() per datagram
+    URING   // io_uring, falls back to SOCKET if the kernel does not support it
+};
+
+// Settings trading CPU time and memory for latency, all off by default
+typedef struct
+{
+    bool isBusyPoll;           // spin on non-blocking receives instead of sleeping in poll()
+    uint32_t socketBusyPollUs; // SO_BUSY_POLL of the rx socket, 0 is off
+    int cpu;                   // CPU the peer is pinned to, -1 is off
+    size_t prefaultBytes;      // lock all memory and pre-fault this much heap for message states, 0 is off
+} lowLatency_t;
+
 typedef struct 
 {
     peerId_t Id;
@@ -16,14 +32,22 @@ typedef struct
     in_addr_t ipaddr; // own ip address as inet octet array
     uint16_t udpPort;
     std::string logFile;
+    std::string configFile;
     std::string errorInjection;
     std::vector<peer_t> peers;
+    mwConfig_t mwConfig;
     std::vector<std::string> freeParams;
     std::optional<bitflip_t> bitFlipInfo;
+    IoBackend ioBackend;
+    lowLatency_t lowLatency;
+    std::string walPath; // path prefix of the write-ahead log segments, empty if the peer keeps no log
+    bool isTracing;      // record the phases of the event loop from the start, see Tracer
 } config_t;
 
 extern std::optional<config_t> getConfigFromOptions(int argc, char *argv[]);
 extern void printUsage(char *argv0);
 extern std::optional<bitflip_t> getBitFlipInfo(std::string const &bitFlip);
+// Reads the peers of a config file again, the group wide settings in it are ignored
+extern std::optional<std::vector<peer_t>> readPeersFromConfigFile(std::string const &configFile);
 }
 
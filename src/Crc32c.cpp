@@ -0,0 +1,125 @@
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
+#include "Crc32c.h"
+
+namespace rgc
+{
+
+typedef uint32_t (*crc32cFunc_t)(uint8_t const *data, size_t size, uint32_t crc);
+
+static constexpr uint32_t CRC32C_POLY_REFLECTED = 0x82f63b78;
+
+static constexpr std::array<uint32_t, 256> makeCrc32cTable()
+{
+    std::array<uint32_t, 256> table = {};
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? ((crc >> 1) ^ CRC32C_POLY_REFLECTED) : (crc >> 1);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+static constexpr std::array<uint32_t, 256> CRC32C_TABLE = makeCrc32cTable();
+
+uint32_t crc32cTable(uint8_t const *data, size_t size, uint32_t crc)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = CRC32C_TABLE[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHardware(uint8_t const *data, size_t size, uint32_t crc)
+{
+    uint64_t crc64 = static_cast<uint32_t>(~crc);
+    for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), data += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+
+    uint32_t crc32 = static_cast<uint32_t>(crc64);
+    for (; size > 0; size--, data++)
+    {
+        crc32 = _mm_crc32_u8(crc32, *data);
+    }
+    return ~crc32;
+}
+
+static bool hasCrcInstructions()
+{
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#elif defined(__aarch64__)
+
+__attribute__((target("+crc")))
+static uint32_t crc32cHardware(uint8_t const *data, size_t size, uint32_t crc)
+{
+    crc = ~crc;
+    for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), data += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+
+    for (; size > 0; size--, data++)
+    {
+        crc = __crc32cb(crc, *data);
+    }
+    return ~crc;
+}
+
+static bool hasCrcInstructions()
+{
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+#else
+
+static uint32_t crc32cHardware(uint8_t const *data, size_t size, uint32_t crc)
+{
+    return crc32cTable(data, size, crc);
+}
+
+static bool hasCrcInstructions()
+{
+    return false;
+}
+
+#endif
+
+bool isCrc32cAccelerated()
+{
+    static bool const isAccelerated = hasCrcInstructions();
+    return isAccelerated;
+}
+
+uint32_t crc32c(uint8_t const *data, size_t size, uint32_t crc)
+{
+    static crc32cFunc_t const pCrc32c = isCrc32cAccelerated() ? crc32cHardware : crc32cTable;
+    return pCrc32c(data, size, crc);
+}
+
+} // namespace rgc
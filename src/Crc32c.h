@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace rgc {
+
+// CRC32C (Castagnoli polynomial, as in iSCSI and SCTP). Continues the CRC of preceding data if crc is the result of
+// that, so crc32c(b, crc32c(a)) equals the CRC of a and b. Uses the SSE4.2 or ARMv8 CRC instructions if the CPU
+// supports them, which is determined once.
+uint32_t crc32c(uint8_t const *data, size_t size, uint32_t crc = 0);
+// Table driven, the fallback on CPUs without CRC instructions
+uint32_t crc32cTable(uint8_t const *data, size_t size, uint32_t crc = 0);
+bool isCrc32cAccelerated();
+
+} // namespace rgc
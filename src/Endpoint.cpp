@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <poll.h>
+#include <fmt/core.h>
+
+#include "Endpoint.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Upper bound for one wait in run(), so that stop() is noticed timely
+static constexpr milliseconds MAX_POLL_WAIT = milliseconds(100);
+
+namespace rgc
+{
+
+Endpoint::Endpoint(config_t const &config, deliveryCallback_t onDelivery, logCallback_t onLog, IClock const &clock) :
+    m_onDelivery(std::move(onDelivery)),
+    m_onLog(std::move(onLog)),
+    m_clock(clock),
+    m_ownPeerId(config.Id),
+    m_isTimestamped(dynamic_cast<SystemClock const *>(&clock) != nullptr),
+    m_pRxSocket(make_unique<UdpRxSocket>(config.ipaddr, config.udpPort)),
+    m_stop(false)
+{
+    if (config.lowLatency.socketBusyPollUs > 0)
+    {
+        int error = m_pRxSocket->setBusyPoll(config.lowLatency.socketBusyPollUs);
+        if (error != 0)
+        {
+            log(LOG_TYPE::WARN, fmt::format("Could not enable socket busy polling: {}.", strerror(error)));
+        }
+    }
+
+    mwConfig_t const &mwConfig = config.mwConfig;
+    if ((mwConfig.socketRcvBufBytes > 0) || (mwConfig.socketSndBufBytes > 0))
+    {
+        int error = m_pRxSocket->setBufferSizes(mwConfig.socketRcvBufBytes, mwConfig.socketSndBufBytes);
+        if (error != 0)
+        {
+            log(LOG_TYPE::WARN, fmt::format("Could not set socket buffer sizes: {}.", strerror(error)));
+        }
+        log(LOG_TYPE::MSG, fmt::format("Socket buffers: {} bytes receive, {} bytes send.",
+            m_pRxSocket->getBufferBytes(SO_RCVBUF), m_pRxSocket->getBufferBytes(SO_SNDBUF)));
+    }
+
+    // datagrams dropped by the kernel are counted apart from those lost on the network
+    if (m_pRxSocket->enableDropCounts() != 0)
+    {
+        log(LOG_TYPE::WARN, "Could not enable kernel drop counts.");
+    }
+
+    if (m_isTimestamped && (m_pRxSocket->enableTimestamps() != 0))
+    {
+        log(LOG_TYPE::WARN, "Could not enable kernel receive timestamps.");
+        m_isTimestamped = false;
+    }
+
+    if (config.ioBackend == IoBackend::URING)
+    {
+        try
+        {
+            m_pUring = make_unique<UringContext>(m_pRxSocket->getSocketDescriptor());
+            m_pUringRxSocket = make_unique<UringRxSocket>(*m_pUring);
+            log(LOG_TYPE::MSG, "Using the io_uring backend.");
+        }
+        catch (std::runtime_error const &e)
+        {
+            log(LOG_TYPE::WARN, fmt::format("{} Using the socket backend instead.", e.what()));
+        }
+    }
+
+#if defined (PEER_SENDS_TO_ITSELF)
+    peer_t self { config.Id, config.udpPort, config.ipaddr };
+    m_ownedTxSockets.push_back(makeTxSocket(self));
+    m_txSockets.push_back(m_ownedTxSockets.back().get());
+#endif
+    // Tx Sockets for each remote peer for sending messages
+    for (auto const &peer : config.peers)
+    {
+        m_ownedTxSockets.push_back(makeTxSocket(peer));
+        m_txSockets.push_back(m_ownedTxSockets.back().get());
+    }
+
+    IRxSocket *pRxSocket = m_pUring ? static_cast<IRxSocket *>(m_pUringRxSocket.get()) : m_pRxSocket.get();
+    m_pMiddleWare = make_unique<MiddleWare>(this, config.Id, pRxSocket, m_txSockets, config.bitFlipInfo, config.mwConfig);
+
+    // Optional multicast group for the first transmission of each message
+    if (mwConfig.multicastGroup != 0)
+    {
+        peer_t group { CONTROL_PEER_ID, mwConfig.multicastPort, mwConfig.multicastGroup };
+        m_pMcastRxSocket = make_unique<UdpMcastRxSocket>(config.ipaddr, mwConfig.multicastGroup, mwConfig.multicastPort);
+        (void)m_pMcastRxSocket->enableDropCounts();
+        if (m_isTimestamped)
+        {
+            (void)m_pMcastRxSocket->enableTimestamps();
+        }
+        m_pMcastTxSocket = make_unique<UdpMcastTxSocket>(group, config.ipaddr, mwConfig.multicastTtl, m_pRxSocket->getSocketDescriptor());
+        m_pMiddleWare->setMulticastSockets(m_pMcastRxSocket.get(), m_pMcastTxSocket.get());
+    }
+
+    if (!config.walPath.empty())
+    {
+        m_pWal = make_unique<WriteAheadLog>(config.walPath);
+        walState_t state = m_pWal->takeRecoveredState();
+        size_t numResumed = m_pMiddleWare->restore(state, m_clock.now());
+        int error = m_pMiddleWare->setWriteAheadLog(m_pWal.get());
+        if (error != 0)
+        {
+            throw std::runtime_error(fmt::format("Could not write the write-ahead log {}: {}.", config.walPath, strerror(error)));
+        }
+        log(LOG_TYPE::MSG, fmt::format("Resumed {} in-flight messages and {} watermarks from the write-ahead log.",
+            numResumed, state.watermarks.size()));
+    }
+}
+
+unique_ptr<ITxSocket> Endpoint::makeTxSocket(peer_t const &peer)
+{
+    if (m_pUring)
+    {
+        return make_unique<UringTxSocket>(peer, *m_pUring);
+    }
+    return make_unique<UdpTxSocket>(peer, m_pRxSocket->getSocketDescriptor(), m_isTimestamped);
+}
+
+vector<int> Endpoint::getDescriptors() const
+{
+    // The io_uring descriptor becomes readable once received datagrams completed
+    vector<int> ret { m_pUring ? m_pUring->getDescriptor() : m_pRxSocket->getSocketDescriptor() };
+    if (m_pMcastRxSocket)
+    {
+        ret.push_back(m_pMcastRxSocket->getSocketDescriptor());
+    }
+    return ret;
+}
+
+size_t Endpoint::updatePeers(vector<peer_t> const &peers)
+{
+    size_t ret = 0;
+    vector<peerId_t> movedPeerIds;
+
+    // Departed peers, and peers whose address changed
+    for (auto it = begin(m_ownedTxSockets); it != end(m_ownedTxSockets);)
+    {
+        ITxSocket const &txSocket = **it;
+        struct ::sockaddr_in const &sockAddr = txSocket.getRemoteSocketAddr();
+        bool isKept = (txSocket.getPeerId() == m_ownPeerId) || std::any_of(begin(peers), end(peers), [&](auto const &peer) {
+            return (peer.peerId == txSocket.getPeerId()) && (peer.peerIpAddress == sockAddr.sin_addr.s_addr) &&
+                (htons(peer.peerUdpPort) == sockAddr.sin_port);
+        });
+
+        if (isKept)
+        {
+            ++it;
+        }
+        else
+        {
+            bool isMoved = std::any_of(begin(peers), end(peers), [&txSocket](auto const &peer) { return (peer.peerId == txSocket.getPeerId()); });
+            if (isMoved)
+            {
+                movedPeerIds.push_back(txSocket.getPeerId());
+            }
+            else
+            {
+                log(LOG_TYPE::MSG, fmt::format("Peer {} left the group.", txSocket.getPeerId()));
+            }
+            // also drops the socket from m_txSockets, which the middleware refers to
+            m_pMiddleWare->removePeer(txSocket.getPeerId());
+            it = m_ownedTxSockets.erase(it);
+            ret++;
+        }
+    }
+
+    for (auto const &peer : peers)
+    {
+        bool isKnown = (peer.peerId == m_ownPeerId) || std::any_of(begin(m_ownedTxSockets), end(m_ownedTxSockets),
+            [&peer](auto const &pTxSocket) { return (pTxSocket->getPeerId() == peer.peerId); });
+
+        if (!isKnown)
+        {
+            m_ownedTxSockets.push_back(makeTxSocket(peer));
+            bool isMoved = (std::find(begin(movedPeerIds), end(movedPeerIds), peer.peerId) != end(movedPeerIds));
+            log(LOG_TYPE::MSG, isMoved ? 
+                fmt::format("Peer {} moved to {}.", peer.peerId, MiddleWare::toString(m_ownedTxSockets.back()->getRemoteSocketAddr())) :
+                fmt::format("Peer {} joined the group.", peer.peerId));
+            m_pMiddleWare->addPeer(m_ownedTxSockets.back().get());
+            ret++;
+        }
+    }
+
+    return ret;
+}
+
+void Endpoint::run()
+{
+    vector<struct pollfd> pollFds;
+    for (int fd : getDescriptors())
+    {
+        pollFds.push_back({ fd, POLLIN, 0 });
+    }
+
+    while (!m_stop)
+    {
+        auto now = m_clock.now();
+        auto wait = std::clamp(duration_cast<milliseconds>(getNextTimeout() - now), milliseconds(0), MAX_POLL_WAIT);
+        ::poll(pollFds.data(), pollFds.size(), static_cast<int>(wait.count()));
+        poll(m_clock.now());
+    }
+}
+
+void Endpoint::deliverMessages(delivery_t const *deliveries, size_t numDeliveries) const
+{
+    if (m_onDelivery)
+    {
+        m_onDelivery(deliveries, numDeliveries);
+    }
+}
+
+void Endpoint::log(LOG_TYPE type, std::string const &msg) const
+{
+    if (m_onLog)
+    {
+        m_onLog(type, msg);
+    }
+}
+
+} // namespace rgc
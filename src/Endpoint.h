@@ -0,0 +1,127 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "IApp.h"
+#include "IClock.h"
+#include "ConfigParser.h"
+#include "MiddleWare.h"
+#include "UdpSocket.h"
+#include "UringSocket.h"
+#include "WriteAheadLog.h"
+
+namespace rgc {
+
+// Receives all messages which became deliverable in one middleware iteration. The views are only
+// valid during the call, copy what needs to be kept.
+typedef std::function<void(delivery_t const *deliveries, size_t numDeliveries)> deliveryCallback_t;
+typedef std::function<void(IApp::LOG_TYPE type, std::string const &msg)> logCallback_t;
+
+// Embeddable group member: Owns the Udp sockets and the middleware of one peer, as configured
+// in a config_t. The owner either calls run(), or integrates getDescriptors() and
+// getNextTimeout() into its own event loop and calls poll() when one of them fires.
+class Endpoint final : public IApp
+{
+public:
+    Endpoint(config_t const &config, deliveryCallback_t onDelivery, logCallback_t onLog = logCallback_t(),
+        IClock const &clock = SystemClock::instance());
+    virtual ~Endpoint() {}
+
+    SendStatus send(uint8_t const *data, size_t size, std::chrono::system_clock::time_point const &now,
+        Priority priority = Priority::NORMAL, std::chrono::milliseconds ttl = std::chrono::milliseconds(0))
+    {
+        return m_pMiddleWare->sendMessage(data, size, now, priority, ttl);
+    }
+
+    SendStatus send(std::string const &message, std::chrono::system_clock::time_point const &now,
+        Priority priority = Priority::NORMAL, std::chrono::milliseconds ttl = std::chrono::milliseconds(0))
+    {
+        return m_pMiddleWare->sendMessage(message, now, priority, ttl);
+    }
+
+    // Receives whatever is pending, handles timeouts and delivers messages. Returns the number of received datagrams.
+    size_t poll(std::chrono::system_clock::time_point const &now)
+    {
+        size_t ret = m_pMiddleWare->rxTxLoop(now);
+        if (m_pUring)
+        {
+            // all datagrams of this iteration in one system call
+            m_pUring->submit();
+        }
+        return ret;
+    }
+
+    // True if the io_uring backend was requested and is supported by the kernel
+    bool isUringActive() const
+    {
+        return (m_pUring != nullptr);
+    }
+
+    // Descriptors which become readable when poll() has something to receive
+    std::vector<int> getDescriptors() const;
+
+    std::chrono::system_clock::time_point getNextTimeout() const
+    {
+        return m_pMiddleWare->getNextTimeout();
+    }
+
+    MiddleWare &getMiddleWare()
+    {
+        return *m_pMiddleWare;
+    }
+
+    IClock const &getClock() const
+    {
+        return m_clock;
+    }
+
+    mwUsage_t getUsage() const
+    {
+        return m_pMiddleWare->getUsage();
+    }
+
+    std::optional<rttStats_t> getRtt(peerId_t peerId) const
+    {
+        return m_pMiddleWare->getRtt(peerId);
+    }
+
+    // Applies a new list of remote peers in place: Departed peers are removed, in-flight messages stop waiting for
+    // them. A peer whose address changed is replaced. Returns the number of peers which joined or departed.
+    size_t updatePeers(std::vector<peer_t> const &peers);
+
+    // Blocks and calls poll() whenever a descriptor or timeout fires, until stop() is called
+    virtual void run();
+
+    void stop()
+    {
+        m_stop = true;
+    }
+
+    virtual void deliverMessages(delivery_t const *deliveries, size_t numDeliveries) const;
+    virtual void log(LOG_TYPE type, std::string const &msg) const;
+
+private:
+    std::unique_ptr<ITxSocket> makeTxSocket(peer_t const &peer);
+
+    deliveryCallback_t m_onDelivery;
+    logCallback_t m_onLog;
+    IClock const &m_clock;
+    peerId_t m_ownPeerId;
+    bool m_isTimestamped; // kernel timestamps only match the time of a SystemClock
+    std::unique_ptr<UdpRxSocket> m_pRxSocket;
+    std::unique_ptr<UringContext> m_pUring;
+    std::unique_ptr<UringRxSocket> m_pUringRxSocket;
+    std::vector<std::unique_ptr<ITxSocket>> m_ownedTxSockets;
+    std::vector<ITxSocket *> m_txSockets;
+    std::unique_ptr<UdpMcastRxSocket> m_pMcastRxSocket;
+    std::unique_ptr<UdpMcastTxSocket> m_pMcastTxSocket;
+    std::unique_ptr<WriteAheadLog> m_pWal;
+    std::unique_ptr<MiddleWare> m_pMiddleWare;
+    bool m_stop;
+};
+
+} // namespace rgc
@@ -18,7 +18,8 @@ public:
     };
 
     virtual ~IApp() {};
-    virtual void deliverMessage(MessageId msgId, payload_t const &payload) const = 0;
+    // All messages which became deliverable in one iteration of the middleware, in the order of their reception
+    virtual void deliverMessages(delivery_t const *deliveries, size_t numDeliveries) const = 0;
     virtual void run() = 0;
     virtual void log(LOG_TYPE, std::string const &msg) const = 0;
 };
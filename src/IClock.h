@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+
+namespace rgc {
+
+// Source of the current time for driving the middleware. MiddleWare itself only works on the points in
+// time passed to it, so that it runs the same on real and on simulated time.
+class IClock
+{
+public:
+    virtual ~IClock() {};
+    virtual std::chrono::system_clock::time_point now() const = 0;
+};
+
+class SystemClock final : public IClock
+{
+public:
+    virtual std::chrono::system_clock::time_point now() const
+    {
+        return std::chrono::system_clock::now();
+    }
+
+    static SystemClock const &instance()
+    {
+        static SystemClock clock;
+        return clock;
+    }
+};
+
+// Time only passes when it is told to, for tests and simulations
+class ManualClock final : public IClock
+{
+public:
+    explicit ManualClock(std::chrono::system_clock::time_point start = std::chrono::system_clock::time_point()) :
+        m_now(start)
+    {}
+
+    virtual std::chrono::system_clock::time_point now() const
+    {
+        return m_now;
+    }
+
+    void set(std::chrono::system_clock::time_point now)
+    {
+        m_now = now;
+    }
+
+    void advance(std::chrono::system_clock::duration duration)
+    {
+        m_now += duration;
+    }
+
+private:
+    std::chrono::system_clock::time_point m_now;
+};
+
+} // namespace rgc
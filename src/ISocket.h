@@ -1,5 +1,6 @@
 #pragma once
 #include <array>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 
@@ -17,6 +18,11 @@ struct [[nodiscard]] TransmitStatus
 {
     size_t transmitBytes;
     uint8_t status;
+    // receive: kernel arrival time of the datagram, send: time the datagram was handed to the kernel. The epoch if the
+    // socket does not take timestamps.
+    std::chrono::system_clock::time_point timestamp = {};
+    // receive: datagrams the kernel dropped on this socket for a full receive buffer since its creation, if reported
+    uint32_t rxQueueDrops = 0;
 };
 
 class IRxSocket
@@ -24,6 +30,11 @@ class IRxSocket
 public:
     virtual ~IRxSocket() {};
     virtual TransmitStatus receive(rx_buffer_t &buf, struct sockaddr_in &remoteAddr) const = 0;
+    // Descriptor which becomes readable when there is something to receive, -1 if there is none
+    virtual int getSocketDescriptor() const
+    {
+        return -1;
+    }
 };
 
 class ITxSocket
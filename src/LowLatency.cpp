@@ -0,0 +1,49 @@
+#include <cerrno>
+#include <cstdlib>
+
+#include <malloc.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "LowLatency.h"
+
+namespace rgc
+{
+
+int pinToCpu(int cpu)
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    return (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0) ? 0 : errno;
+}
+
+int lockMemory(size_t prefaultBytes)
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        return errno;
+    }
+
+    // Freed heap is neither trimmed nor were large blocks mmap()ed and unmapped again
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    uint8_t *pHeap = static_cast<uint8_t *>(malloc(prefaultBytes));
+    if (pHeap == nullptr)
+    {
+        return ENOMEM;
+    }
+
+    // one write per page faults it in
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t offset = 0; offset < prefaultBytes; offset += pageSize)
+    {
+        pHeap[offset] = 0;
+    }
+    free(pHeap);
+
+    return 0;
+}
+
+} // namespace rgc
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <sched.h>
+
+namespace rgc {
+
+// Adaptive backoff of a busy-polling loop: While idle, it spins first, then pauses the CPU between polls, then yields
+// it to other threads. Any work resets it to spinning.
+class Backoff final
+{
+public:
+    static constexpr uint32_t SPIN_LIMIT = 64;
+    static constexpr uint32_t PAUSE_LIMIT = 1024;
+
+    void reset()
+    {
+        m_numIdle = 0;
+    }
+
+    void idle()
+    {
+        if (m_numIdle < SPIN_LIMIT)
+        {
+            m_numIdle++;
+        }
+        else if (m_numIdle < PAUSE_LIMIT)
+        {
+            pause();
+            m_numIdle++;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    uint32_t getNumIdle() const
+    {
+        return m_numIdle;
+    }
+
+private:
+    static void pause()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#endif
+    }
+
+    uint32_t m_numIdle = 0;
+};
+
+// Pins the calling thread to the given CPU, returns 0 or the errno
+extern int pinToCpu(int cpu);
+// Locks all current and future memory of the process, and pre-faults prefaultBytes of heap which stays with the
+// process when freed, so that later allocations of message states neither page fault nor call the kernel.
+// Returns 0 or the errno.
+extern int lockMemory(size_t prefaultBytes);
+
+} // namespace rgc
@@ -1,262 +1,2021 @@
+#include <cerrno>
+#include <cstring>
+
 #include <fmt/core.h>
 #include <fmt/ranges.h>
 #include <sstream>
 #include <iomanip>
 
-#include "MiddleWare.h"
+#include "Compression.h"
+#include "Crc32c.h"
+#include "MiddleWare.h"
+#include "Tracer.h"
+
+using namespace std;
+using namespace rgc;
+using namespace std::chrono;
+
+// Extended sequence numbers in the frames are 4 Bytes in network byte order
+static seqNr_t readSeqNr(uint8_t const *p)
+{
+    return (static_cast<seqNr_t>(p[0]) << 24) + (p[1] << 16) + (p[2] << 8) + p[3];
+}
+
+static void appendSeqNr(payload_t &frame, seqNr_t seqNr)
+{
+    frame.push_back((seqNr >> 24) & 0xff);
+    frame.push_back((seqNr >> 16) & 0xff);
+    frame.push_back((seqNr >> 8) & 0xff);
+    frame.push_back(seqNr & 0xff);
+}
+
+// Trace events need names which outlive the middleware
+static char const *getTraceName(ControlType type)
+{
+    switch (type)
+    {
+        case ControlType::DIGEST: return "processRxMessage DIGEST";
+        case ControlType::HEARTBEAT: return "processRxMessage HEARTBEAT";
+        case ControlType::STATUS: return "processRxMessage STATUS";
+        case ControlType::STATUS_REQUEST: return "processRxMessage STATUS_REQUEST";
+        case ControlType::NACK: return "processRxMessage NACK";
+        case ControlType::FEC_PARITY: return "processRxMessage FEC_PARITY";
+        default: return "processRxMessage CONTROL";
+    }
+}
+
+static void appendSeqNrEntry(payload_t &entries, peerId_t peerId, seqNr_t seqNr)
+{
+    entries.push_back(peerId >> 8);
+    entries.push_back(peerId & 0xff);
+    appendSeqNr(entries, seqNr);
+}
+
+// unsigned arithmetic takes care of the wrap-around of the extended sequence number
+static bool isSeqNrBefore(seqNr_t lhs, seqNr_t rhs)
+{
+    return (static_cast<int32_t>(lhs - rhs) < 0);
+}
+
+static constexpr size_t CONTROL_HEADER_SIZE = sizeof(peerId_t) + sizeof(ControlType);
+static constexpr size_t DIGEST_ENTRY_SIZE = sizeof(peerId_t) + sizeof(seqNr_t);
+static constexpr size_t NACK_ENTRY_SIZE = sizeof(peerId_t) + sizeof(seqNr_t) + sizeof(uint16_t);
+static constexpr size_t FEC_PARITY_HEADER_SIZE = sizeof(peerId_t) + sizeof(seqNr_t) + sizeof(uint8_t) + sizeof(uint16_t);
+static constexpr seqNr_t FEC_BLOCKS_KEPT = 4; // blocks of an origin kept for rebuilding a message
+static constexpr seqNr_t SEQ_NR_WINDOW = 10; // number of sequence numbers accepted ahead of the expected one
+static constexpr seqNr_t NACK_SEQ_NR_WINDOW = 1024; // same in NACK mode, where the origin does not wait for the receivers
+
+static constexpr duration<int64_t, std::milli> ACK_TIMEOUT = milliseconds(1000);
+
+size_t MiddleWare::rxTxLoop(system_clock::time_point const &now)
+{
+    refillPacers(now);
+    // ACKs are held back, so that all received messages share one commit before they go out
+    m_isHoldingTx = (m_pWal != nullptr);
+    size_t ret = listenRxSocket(m_pRxSocket, now);
+    if (m_pMcastRxSocket != nullptr)
+    {
+        ret += listenRxSocket(m_pMcastRxSocket, now);
+    }
+    m_isHoldingTx = false;
+    releaseHeldDatagrams();
+
+    if (m_config.heartbeatInterval.count() > 0)
+    {
+        checkLiveness(now);
+        if (m_nextHeartbeat <= now)
+        {
+            sendHeartbeats();
+            m_nextHeartbeat = now + m_config.heartbeatInterval;
+        }
+    }
+
+    checkPendingTxMessages(now);
+
+    if ((m_config.dissemination == Dissemination::GOSSIP) && (m_nextAntiEntropy <= now))
+    {
+        sendDigests();
+        m_nextAntiEntropy = now + m_config.antiEntropyInterval;
+    }
+
+    if ((m_config.reliability == Reliability::NACK) && (m_nextStatus <= now))
+    {
+        runStatusRound();
+        m_nextStatus = now + m_config.statusInterval;
+    }
+
+    if (m_pWal != nullptr)
+    {
+        // the records appended after the last datagram, e.g. of finished messages
+        checkWalError(m_pWal->commit());
+    }
+
+    return ret;
+}
+
+SendStatus MiddleWare::sendMessage(uint8_t const *message, size_t size, system_clock::time_point const &now, Priority priority,
+    milliseconds ttl)
+{
+    // Deflated once here, relays and retransmissions send the frame as it is
+    payload_t deflated;
+    if ((m_config.compressionThresholdBytes > 0) && (size >= m_config.compressionThresholdBytes) && (size <= MAX_INFLATED_BYTES))
+    {
+        deflated = deflateData(message, size);
+    }
+    bool isDeflated = !deflated.empty();
+    size_t contentSize = isDeflated ? (INFLATED_SIZE_BYTES + deflated.size()) : size;
+
+    // the receivers would truncate the frame
+    if (contentSize + m_headerSize + m_checksumSize > BUFFER_SIZE)
+    {
+        return SendStatus::TOO_LARGE;
+    }
+
+    if (!isInFlightBudgetAvailable(m_ownPeerId, contentSize + m_headerSize + m_checksumSize))
+    {
+        m_usage.numBlockedSends++;
+        return SendStatus::WOULD_BLOCK;
+    }
+
+    MessageId msgId = MessageId(m_ownPeerId, m_nextSeqNr);
+    payload_t payload;
+    payload.reserve(contentSize + m_headerSize + m_checksumSize);
+    payload.push_back(m_ownPeerId >> 8);
+    payload.push_back(m_ownPeerId & 0xff);
+    payload.push_back((m_nextSeqNr >> 8) & 0xff);
+    payload.push_back(m_nextSeqNr & 0xff);
+    ttl = std::min(ttl, MAX_MESSAGE_TTL);
+    if (m_headerSize > MSG_ID_SIZE)
+    {
+        uint8_t flags = isDeflated ? FRAME_FLAG_DEFLATED : 0;
+        if (m_config.priorityLanes)
+        {
+            flags |= static_cast<uint8_t>(priority) << FRAME_PRIORITY_SHIFT;
+        }
+        payload.push_back(flags);
+    }
+    if (m_config.priorityLanes)
+    {
+        payload.push_back(static_cast<uint8_t>(ttl.count() >> 8));
+        payload.push_back(static_cast<uint8_t>(ttl.count() & 0xff));
+    }
+    if (isDeflated)
+    {
+        payload.push_back((size >> 24) & 0xff);
+        payload.push_back((size >> 16) & 0xff);
+        payload.push_back((size >> 8) & 0xff);
+        payload.push_back(size & 0xff);
+        payload.insert(end(payload), begin(deflated), end(deflated));
+    }
+    else
+    {
+        payload.insert(end(payload), message, message + size);
+    }
+    appendChecksum(m_config.checksumType, payload, getEpoch(m_nextSeqNr));
+
+    payload_t inflatedMessage = isDeflated ? payload_t(message, message + size) : payload_t();
+    payload_t fecParity = makeFecParity(msgId, payload);
+    if (m_config.reliability == Reliability::NACK)
+    {
+        sendStreamMessage(msgId, std::move(payload), now, std::move(inflatedMessage), fecParity);
+        ++m_nextSeqNr;
+        return SendStatus::OK;
+    }
+
+    addTxMessageState(msgId, std::move(payload), nullptr, now, std::move(inflatedMessage), std::move(fecParity), priority, ttl);
+    ++m_nextSeqNr;
+
+#if defined (PEER_SENDS_TO_ITSELF)
+    setAcceptedSeqNrOfPeer(m_ownPeerId, m_nextSeqNr);
+#endif    
+
+    return SendStatus::OK;
+}
+
+size_t MiddleWare::listenRxSocket(IRxSocket *pRxSocket, system_clock::time_point const &now)
+{
+    TraceScope trace("listenRxSocket");
+    size_t ret = 0;
+    rx_buffer_t buf;
+    struct sockaddr_in remoteSockAddr;
+    
+    // Polling for incoming data until there is nothing left to receive or an error happens 
+    for (;;)
+    {
+        rgc::TransmitStatus status = pRxSocket->receive(buf, remoteSockAddr);
+
+        if (status.status != 0)
+        {
+             m_pApp->log(IApp::LOG_TYPE::ERR, fmt::format("Error reading from Rx Socket, error code: {}", status.status));
+        }
+        else
+        {
+            if (status.transmitBytes > 0)
+            {
+                uint32_t &lastRxQueueDrops = (pRxSocket == m_pMcastRxSocket) ? m_mcastRxQueueDrops : m_rxQueueDrops;
+                if (status.rxQueueDrops > lastRxQueueDrops)
+                {
+                    m_usage.numRxQueueDrops += status.rxQueueDrops - lastRxQueueDrops;
+                    lastRxQueueDrops = status.rxQueueDrops;
+                }
+
+                // A batch of datagrams shares now, but each has its own kernel timestamp
+                system_clock::time_point rxTime = now;
+                if (status.timestamp.time_since_epoch().count() != 0)
+                {
+                    rxTime = status.timestamp;
+                    size_t rxDelayNs = static_cast<size_t>(std::max(duration_cast<nanoseconds>(now - rxTime).count(), int64_t(0)));
+                    m_usage.numRxTimestamps++;
+                    m_usage.rxDelayNsSum += rxDelayNs;
+                    m_usage.rxDelayNsMax = std::max(m_usage.rxDelayNsMax, rxDelayNs);
+                }
+
+                payload_t payload(&buf[0], &buf[status.transmitBytes]);
+                injectError(payload);
+                processRxMessage(payload, remoteSockAddr, now, rxTime);
+                ret++;
+            }
+        }
+
+        if ((status.transmitBytes == 0) || (status.status != 0))
+        {
+            break;
+        }
+    }
+
+    return ret;
+}
+
+void MiddleWare::injectError(rgc::payload_t &payload) const
+{
+    for (auto it = begin(m_bitFlipInfos); it != end(m_bitFlipInfos); ++it)
+    {
+        uint16_t peerIdtemp = (payload[0] << 8) + payload[1];
+        uint16_t seqNrIdIdtemp = (payload[2] << 8) + payload[3];
+        if (it->peerId == peerIdtemp && it->seqNrId == seqNrIdIdtemp && (it->bitOffset + 16 < static_cast<uint16_t>(payload.size()*8))){
+            size_t bytePos = (it->bitOffset + 16) / 8;
+            size_t bitPos  = (it->bitOffset + 16) % 8;
+            payload[bytePos] ^= static_cast<unsigned char>(1 << bitPos);
+        }
+    }
+}
+
+system_clock::time_point MiddleWare::getNextTimeout() const
+{
+    system_clock::time_point ret = system_clock::time_point::max();
+
+    for (auto const &txMsgState : m_txMessageStates)
+    {
+        for (auto const &txState : txMsgState.getTxStates())
+        {
+            if (!txState.isAcknowledged())
+            {
+                ret = std::min(ret, txState.getTimeout());
+            }
+        }
+        ret = std::min(ret, txMsgState.getExpiry());
+    }
+
+    if (m_config.heartbeatInterval.count() > 0)
+    {
+        // Liveness is checked on each heartbeat, a suspicion is detected at most one interval late
+        ret = std::min(ret, m_nextHeartbeat);
+    }
+
+    if (m_config.dissemination == Dissemination::GOSSIP)
+    {
+        ret = std::min(ret, m_nextAntiEntropy);
+    }
+
+    if (m_config.reliability == Reliability::NACK)
+    {
+        ret = std::min(ret, std::min(m_nextStatus, m_nextPacedStreamFrame));
+    }
+
+    return ret;
+}
+
+void MiddleWare::checkPendingTxMessages(system_clock::time_point const &now)
+{
+    TraceScope trace("checkPendingTxMessages");
+    dropExpiredMessages(now);
+    if (!m_pacedStreamFrames.empty())
+    {
+        releasePacedStreamFrames(now);
+    }
+
+    // Higher lanes come first in the list
+    for (auto it = begin(m_txMessageStates); it != end(m_txMessageStates); ++it)
+    {
+        auto &txMsgState = *it;
+
+        vector<TxState> &txStates = txMsgState.getTxStates();
+        if ((m_pMcastTxSocket != nullptr) && txMsgState.isNothingSent())
+        {
+            // One datagram for all peers, deferred as a whole
+            system_clock::time_point slot = m_pacer.getNextSlot(txMsgState.getPayload().size());
+            if (m_pacer.isLimited() && (slot > now))
+            {
+                for (auto &txState : txStates)
+                {
+                    if (!txState.getPacedSince().has_value())
+                    {
+                        txState.setPacedSince(std::min(txState.getTimeout(), now));
+                    }
+                    txState.setTimeout(slot);
+                }
+                continue;
+            }
+            if (processMcastTxMessage(txMsgState, now))
+            {
+                continue;
+            }
+        }
+
+        for (auto &txState : txStates)
+        {
+            if (!txState.isAcknowledged() && txState.isTimeoutElapsed(now) &&
+                ((txState.getRemainingTxAttempts() == 0) || !deferByPacing(txState, txMsgState.getPayload().size(), now)))
+            {
+                refreshFrameTtl(txMsgState, now);
+                processTxMessage(txState, txMsgState.getPayload(), txMsgState.getFecParity(), now);
+            }
+        }
+    }
+
+    if (!m_txMessageStates.empty())
+    {
+        // Hand all deliverable messages to the application in one batch, the views point into the tx states
+        m_deliveries.clear();
+        for (auto const &s : m_txMessageStates)
+        {
+            if (s.isAllAcknowledged())
+            {
+                m_deliveries.push_back(makeDelivery(s));
+            }
+        }
+
+        if (!m_deliveries.empty())
+        {
+            TraceScope trace("deliverMessages");
+            m_pApp->deliverMessages(m_deliveries.data(), m_deliveries.size());
+        }
+
+        for (auto it = begin(m_txMessageStates); it != end(m_txMessageStates);)
+        {
+            if (it->isAllAcknowledged() || it->isTxToSelfFailed())
+            {
+                if (m_pWal != nullptr)
+                {
+                    checkWalError(m_pWal->logDone(it->getMsgId()));
+                }
+                accountTxMessageState(*it, false);
+                it = m_txMessageStates.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+}
+
+void MiddleWare::dropExpiredMessages(system_clock::time_point const &now)
+{
+    for (auto it = begin(m_txMessageStates); it != end(m_txMessageStates);)
+    {
+        // A message acknowledged by all peers is still delivered
+        if (it->isExpired(now) && !it->isAllAcknowledged())
+        {
+            m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Dropping message {}: Time to live elapsed.", toString(it->getMsgId())));
+            m_usage.numExpired++;
+            if (m_pWal != nullptr)
+            {
+                checkWalError(m_pWal->logDone(it->getMsgId()));
+            }
+            accountTxMessageState(*it, false);
+            it = m_txMessageStates.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void MiddleWare::processTxMessage(TxState &txState, payload_t const &msg, payload_t const &fecParity, system_clock::time_point const &now)
+{
+    uint8_t remainingTxAttempts = txState.getRemainingTxAttempts();
+    if (remainingTxAttempts == 0)
+    {
+        // we did not get an ACK after the third tx attempt
+        m_pApp->log(IApp::LOG_TYPE::DEBUG, 
+            fmt::format("Got no ACK for message {} after max number of retries, giving up.", toString(msg, m_checksumSize, m_headerSize)));
+
+        if (txState.getSocket()->getPeerId() == m_ownPeerId)
+        {
+            // This peer is broken since it can't propertly receive its own tx message -> Drop the message
+            txState.setTxToSelfFailed();
+        }
+        else
+        {
+            // The remote peer is broken. We handle this as if we got an ACK
+            txState.setAcknowledged();
+        }
+    }
+    else
+    {
+        accountPacingDelay(txState, now);
+        auto result = sendDatagram(txState.getSocket(), msg);
+        txState.setLastTxTime((result.timestamp.time_since_epoch().count() != 0) ? result.timestamp : now);
+        auto const &remoteSockAddr = txState.getSocket()->getRemoteSocketAddr();
+        if (result.status != 0)
+        {
+            m_pApp->log(IApp::LOG_TYPE::ERR, 
+                fmt::format("Failed to send message {} to {}; error code: {}", toString(msg, m_checksumSize, m_headerSize), toString(remoteSockAddr), result.status));
+        }
+        else
+        {
+            m_pApp->log(IApp::LOG_TYPE::MSG, fmt::format("Sending message {} to {}.", toString(msg, m_checksumSize, m_headerSize), toString(remoteSockAddr)));
+        }
+
+        if ((remainingTxAttempts == MAX_TX_ATTEMPTS) && !fecParity.empty())
+        {
+            // The parity follows the last message of its block
+            (void)sendDatagram(txState.getSocket(), fecParity);
+        }
+
+        system_clock::time_point timeout = now + ACK_TIMEOUT;
+        txState.setTimeout(timeout);
+        txState.setRemainingTxAttempts(remainingTxAttempts - 1);
+    }
+}
+
+TransmitStatus MiddleWare::sendDatagram(ITxSocket const *pTxSocket, payload_t const &payload)
+{
+    if (m_pWal != nullptr)
+    {
+        if (m_isHoldingTx)
+        {
+            // looks like a successful send to the caller
+            m_heldDatagrams.emplace_back(pTxSocket, payload);
+            return TransmitStatus { payload.size(), 0 };
+        }
+        // Otherwise, a crash could leave the group with frames or ACKs of messages the restarted peer does not know
+        checkWalError(m_pWal->commit());
+    }
+
+    m_usage.numTxDatagrams++;
+    if (isPaced(pTxSocket))
+    {
+        // also datagrams which are not deferred, like ACKs, take their tokens
+        m_pacer.consume(payload.size());
+        TokenBucket *pPeerPacer = getPeerPacer(pTxSocket->getPeerId());
+        if (pPeerPacer != nullptr)
+        {
+            pPeerPacer->consume(payload.size());
+        }
+    }
+
+    if ((m_config.txLossPercent > 0) && (std::uniform_int_distribution<int>(0, 99)(m_rng) < m_config.txLossPercent))
+    {
+        // looks like a successful send to the caller
+        m_usage.numDroppedDatagrams++;
+        return TransmitStatus { payload.size(), 0 };
+    }
+
+    TransmitStatus ret = pTxSocket->send(payload);
+    if ((ret.status == ENOBUFS) || (ret.status == EAGAIN))
+    {
+        m_usage.numTxSocketDrops++;
+    }
+    return ret;
+}
+
+void MiddleWare::releaseHeldDatagrams()
+{
+    for (auto const &held : m_heldDatagrams)
+    {
+        TransmitStatus txStatus = sendDatagram(held.first, held.second);
+        if (txStatus.status != 0)
+        {
+            m_pApp->log(IApp::LOG_TYPE::ERR, fmt::format("Failed to send {} to {}; error code: {}.",
+                toString(held.second, m_checksumSize, m_headerSize), toString(held.first->getRemoteSocketAddr()), txStatus.status));
+        }
+    }
+    m_heldDatagrams.clear();
+}
+
+bool MiddleWare::isPaced(ITxSocket const *pTxSocket) const
+{
+    return (pTxSocket->getPeerId() != m_ownPeerId) &&
+        (m_pacer.isLimited() || (m_config.pacePeerBytesPerSec > 0) || (m_config.pacePeerPacketsPerSec > 0));
+}
+
+TokenBucket *MiddleWare::getPeerPacer(peerId_t peerId)
+{
+    if ((peerId == CONTROL_PEER_ID) || ((m_config.pacePeerBytesPerSec == 0) && (m_config.pacePeerPacketsPerSec == 0)))
+    {
+        return nullptr;
+    }
+
+    auto it = m_peerPacers.find(peerId);
+    if (it == end(m_peerPacers))
+    {
+        it = m_peerPacers.emplace(peerId, TokenBucket(m_config.pacePeerBytesPerSec, m_config.pacePeerPacketsPerSec, m_config.paceBurst)).first;
+    }
+    return &it->second;
+}
+
+void MiddleWare::refillPacers(system_clock::time_point const &now)
+{
+    m_pacer.refill(now);
+    for (auto &peerPacer : m_peerPacers)
+    {
+        peerPacer.second.refill(now);
+    }
+}
+
+system_clock::time_point MiddleWare::getPacingSlot(ITxSocket const *pTxSocket, size_t bytes, system_clock::time_point const &now)
+{
+    system_clock::time_point slot = m_pacer.getNextSlot(bytes);
+    TokenBucket *pPeerPacer = getPeerPacer(pTxSocket->getPeerId());
+    if (pPeerPacer != nullptr)
+    {
+        pPeerPacer->refill(now);
+        slot = std::max(slot, pPeerPacer->getNextSlot(bytes));
+    }
+    return slot;
+}
+
+bool MiddleWare::deferByPacing(TxState &txState, size_t bytes, system_clock::time_point const &now)
+{
+    ITxSocket const *pTxSocket = txState.getSocket();
+    if (!isPaced(pTxSocket))
+    {
+        return false;
+    }
+
+    system_clock::time_point slot = getPacingSlot(pTxSocket, bytes, now);
+    if (slot <= now)
+    {
+        return false;
+    }
+
+    if (!txState.getPacedSince().has_value())
+    {
+        txState.setPacedSince(std::min(txState.getTimeout(), now));
+    }
+    txState.setTimeout(slot);
+    return true;
+}
+
+void MiddleWare::accountPacingDelay(TxState &txState, system_clock::time_point const &now)
+{
+    if (txState.getPacedSince().has_value())
+    {
+        size_t delayNs = static_cast<size_t>(std::max(duration_cast<nanoseconds>(now - *txState.getPacedSince()).count(), int64_t(0)));
+        m_usage.numPacedDatagrams++;
+        m_usage.pacingDelayNsSum += delayNs;
+        m_usage.pacingDelayNsMax = std::max(m_usage.pacingDelayNsMax, delayNs);
+        txState.setPacedSince(std::nullopt);
+    }
+}
+
+bool MiddleWare::processMcastTxMessage(TxMessageState &txMsgState, system_clock::time_point const &now)
+{
+    refreshFrameTtl(txMsgState, now);
+    payload_t const &msg = txMsgState.getPayload();
+    auto result = sendDatagram(m_pMcastTxSocket, msg);
+    if (result.status != 0)
+    {
+        // Fall back to unicast for this message
+        m_pApp->log(IApp::LOG_TYPE::ERR, 
+            fmt::format("Failed to send message {} to group {}; error code: {}", toString(msg, m_checksumSize, m_headerSize), toString(m_pMcastTxSocket->getRemoteSocketAddr()), result.status));
+        return false;
+    }
+
+    m_pApp->log(IApp::LOG_TYPE::MSG, fmt::format("Sending message {} to group {}.", toString(msg, m_checksumSize, m_headerSize), toString(m_pMcastTxSocket->getRemoteSocketAddr())));
+    if (!txMsgState.getFecParity().empty())
+    {
+        (void)sendDatagram(m_pMcastTxSocket, txMsgState.getFecParity());
+    }
+
+    // The multicast datagram counts as first transmission to every peer
+    system_clock::time_point timeout = now + ACK_TIMEOUT;
+    system_clock::time_point txTime = (result.timestamp.time_since_epoch().count() != 0) ? result.timestamp : now;
+    if (!txMsgState.getTxStates().empty())
+    {
+        accountPacingDelay(txMsgState.getTxStates().front(), now);
+    }
+    for (auto &txState : txMsgState.getTxStates())
+    {
+        txState.setPacedSince(std::nullopt);
+        txState.setTimeout(timeout);
+        txState.setLastTxTime(txTime);
+        txState.setRemainingTxAttempts(MAX_TX_ATTEMPTS - 1);
+    }
+
+    return true;
+}
+
+void MiddleWare::processRxMessage(rgc::payload_t const &payload, struct sockaddr_in const &remoteSockAddr, system_clock::time_point const &now,
+    system_clock::time_point const &rxTime)
+{
+    ITxSocket *txSocket = getTxSocketForRemoteAddress(remoteSockAddr);
+
+    if (txSocket == nullptr)
+    {
+        m_pApp->log(IApp::LOG_TYPE::WARN, fmt::format("Discarding rx message: Unknown IP/Port: {}.", toString(remoteSockAddr)));
+        return;
+    }
+
+    markHeardFrom(txSocket->getPeerId(), now);
+
+    // Truncated frame, discard
+    if (payload.size() < CONTROL_HEADER_SIZE + m_checksumSize)
+    {
+        m_pApp->log(IApp::LOG_TYPE::WARN, "Discarding rx message: Truncated.");
+        return;
+    }
+
+    peerId_t peerId = (payload[0] << 8) + payload[1];
+    if (peerId == CONTROL_PEER_ID)
+    {
+        processRxControlMessage(payload, txSocket, now);
+        return;
+    }
+
+    if (payload.size() < MSG_ID_SIZE + m_checksumSize)
+    {
+        m_pApp->log(IApp::LOG_TYPE::WARN, "Discarding rx message: Truncated.");
+        return;
+    }
+
+    if (!isPeerSupported(peerId))
+    {
+        m_pApp->log(IApp::LOG_TYPE::WARN, fmt::format("Discarding rx message: Unknown peer id: {}", peerId));
+        return;
+    }
+
+    bool isAckMessage = (payload.size() == MSG_ID_SIZE + m_checksumSize);
+
+    if (isAckMessage)
+    {
+        TraceScope trace("processRxMessage ACK");
+        processRxAckMessage(payload, peerId, remoteSockAddr, rxTime);
+    }
+    else
+    {
+        TraceScope trace("processRxMessage DATA");
+        processRxDataMessage(payload, peerId, txSocket, now);
+    }
+}
+
+void MiddleWare::processRxAckMessage(rgc::payload_t const &payload, peerId_t peerId, struct sockaddr_in const &remoteSockAddr,
+    system_clock::time_point const &rxTime)
+{
+    wireSeqNr_t wireSeqNr = (payload[2] << 8) + payload[3];
+    TxMessageState *txMsgState = findTxMsgStateOfAck(payload, peerId, wireSeqNr);
+
+    if (txMsgState == nullptr)
+    {
+        m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Discarding ACK {} from {}: Checksum error or unknown message.", toString(payload, m_checksumSize, m_headerSize), toString(remoteSockAddr)));
+    }
+    else
+    {
+        // Message found, check content
+        TxState *txState = txMsgState->findTxState(remoteSockAddr);
+        if (txState != nullptr)
+        {
+            // Karn: the ACK of a retransmitted message may belong to any of its transmissions
+            if (!txState->isAcknowledged() && (txState->getRemainingTxAttempts() == MAX_TX_ATTEMPTS - 1))
+            {
+                sampleRtt(txState->getSocket()->getPeerId(), duration_cast<nanoseconds>(rxTime - txState->getLastTxTime()));
+            }
+            txState->setAcknowledged();
+            m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Received ACK for sent message {} from {}.", toString(payload, m_checksumSize, m_headerSize), toString(remoteSockAddr)));
+        }
+    }
+}
+
+void MiddleWare::sampleRtt(peerId_t peerId, nanoseconds rtt)
+{
+    rtt = std::max(rtt, nanoseconds(0));
+    auto it = std::find_if(begin(m_peerRtts), end(m_peerRtts), [peerId](auto const &peerRtt) { return (peerRtt.peerId == peerId); });
+    if (it == end(m_peerRtts))
+    {
+        m_peerRtts.push_back({ peerId, { rtt, rtt / 2, 1 } });
+        return;
+    }
+
+    // RFC 6298: alpha = 1/8, beta = 1/4
+    rttStats_t &stats = it->rtt;
+    nanoseconds deviation = (stats.srtt > rtt) ? (stats.srtt - rtt) : (rtt - stats.srtt);
+    stats.rttVar = (3 * stats.rttVar + deviation) / 4;
+    stats.srtt = (7 * stats.srtt + rtt) / 8;
+    stats.numSamples++;
+}
+
+optional<rttStats_t> MiddleWare::getRtt(peerId_t peerId) const
+{
+    auto it = std::find_if(begin(m_peerRtts), end(m_peerRtts), [peerId](auto const &peerRtt) { return (peerRtt.peerId == peerId); });
+    return (it == end(m_peerRtts)) ? std::nullopt : optional<rttStats_t>(it->rtt);
+}
+
+void MiddleWare::processRxDataMessage(rgc::payload_t const &payload, peerId_t peerId, ITxSocket *txSocket, system_clock::time_point const &now,
+    bool isFecRecovered)
+{
+    struct sockaddr_in const &remoteSockAddr = txSocket->getRemoteSocketAddr();
+    wireSeqNr_t wireSeqNr = (payload[2] << 8) + payload[3];
+    seqNr_t seqNr = extendSeqNr(getAcceptedSeqNrOfPeer(peerId), wireSeqNr);
+
+    if (!verifyChecksum(m_config.checksumType, payload.data(), payload.size(), getEpoch(seqNr)))
+    {
+        // A relay lagging behind by more than half of the wire sequence number space still sends
+        // frames of the previous epoch. These are old messages which only need to be acknowledged.
+        seqNr_t previousEpochSeqNr = seqNr - (1 << (sizeof(wireSeqNr_t) * 8));
+        if ((seqNr < previousEpochSeqNr) || !verifyChecksum(m_config.checksumType, payload.data(), payload.size(), getEpoch(previousEpochSeqNr)))
+        {
+            // All peers of a group must use the same checksum type, point out a misconfigured one
+            ChecksumType otherType = (m_config.checksumType == ChecksumType::CRC32C) ? ChecksumType::RFC1071 : ChecksumType::CRC32C;
+            bool isOtherType = (payload.size() >= MSG_ID_SIZE + getChecksumSize(otherType)) && 
+                verifyChecksum(otherType, payload.data(), payload.size(), getEpoch(seqNr));
+            m_pApp->log(IApp::LOG_TYPE::WARN, isOtherType ? 
+                fmt::format("Discarding rx message: Peer {} uses a different checksum type.", peerId) : "Discarding rx message: Checksum error.");
+            return;
+        }
+        seqNr = previousEpochSeqNr;
+    }
+
+    if (!isFecRecovered)
+    {
+        syncSeqNrOfPeer(peerId, seqNr);
+    }
+
+    MessageId msgId = MessageId(peerId, seqNr);
+    if ((m_config.fecBlockSize > 0) && (peerId != m_ownPeerId) && !isFecRecovered)
+    {
+        recordFecFrame(msgId, payload, now);
+    }
+
+    if (m_config.reliability == Reliability::NACK)
+    {
+        processRxStreamMessage(payload, msgId, txSocket);
+        return;
+    }
+
+    // A rebuilt message may be further ahead than the window. Behind the accepted sequence number, only the messages
+    // it skipped are accepted, the others may have been delivered already.
+    bool isAccepted = isSeqNrOfPeerAccepted(peerId, seqNr) || isFecSkipped(peerId, seqNr) ||
+        (isFecRecovered && !isSeqNrBefore(seqNr, getAcceptedSeqNrOfPeer(peerId)));
+    bool isNewMessage = isAccepted && (findTxMsgState(msgId) == nullptr);
+    if (isNewMessage && (m_config.relayPolicy == RelayPolicy::DEFER) && !isInFlightBudgetAvailable(peerId, payload.size()))
+    {
+        // No ACK, the remote peer will retransmit the message later
+        m_usage.numDeferredRelays++;
+        m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Deferring message {} from {}: In-flight budget exhausted.", toString(payload, m_checksumSize, m_headerSize), toString(remoteSockAddr)));
+        return;
+    }
+
+    payload_t inflatedMessage;
+    if (isNewMessage && isDeflatedFrame(payload))
+    {
+        // Not acknowledged, the message could not be delivered
+        optional<payload_t> optInflated = inflateFrame(payload);
+        if (!optInflated.has_value())
+        {
+            m_pApp->log(IApp::LOG_TYPE::WARN, fmt::format("Discarding rx message {}: Could not inflate.", toString(MessageId(peerId, seqNr))));
+            return;
+        }
+        inflatedMessage = std::move(*optInflated);
+    }
+
+    // Send back an ACK in any case, even if we already delivered that message to the app
+    TransmitStatus txStatus = sendDatagram(txSocket, makeAckMessage(payload, getEpoch(seqNr)));
+    if (txStatus.status != 0)
+    {
+        m_pApp->log(IApp::LOG_TYPE::ERR, 
+            fmt::format("Failed to send ACK for message: {} from {}; error code: {}.", toString(payload, m_checksumSize, m_headerSize), toString(remoteSockAddr), txStatus.status));
+    }
+
+    if (!isAccepted)
+    {
+        m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Discarding message due to SeqNr: {} from {}.", toString(payload, m_checksumSize, m_headerSize), toString(remoteSockAddr)));
+        return;
+    }
+
+    TxMessageState *txMsgState = findTxMsgState(msgId);
+
+    if (txMsgState == nullptr)
+    {
+        // No such message found in the state, set up anew
+        m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Received data message {} from {}.", toString(payload, m_checksumSize, m_headerSize), toString(remoteSockAddr)));
+        addTxMessageState(msgId, payload, txSocket, now, std::move(inflatedMessage), {}, getFramePriority(payload), getFrameTtl(payload));
+        m_fecSkipped.erase({ peerId, seqNr });
+        if (isSeqNrOfPeerAccepted(peerId, seqNr))
+        {
+            if (m_config.fecBlockSize > 0)
+            {
+                // a parity may still rebuild the messages in between
+                for (seqNr_t skipped = getAcceptedSeqNrOfPeer(peerId); isSeqNrBefore(skipped, seqNr); ++skipped)
+                {
+                    m_fecSkipped.insert({ peerId, skipped });
+                }
+            }
+            setAcceptedSeqNrOfPeer(peerId, seqNr + 1);
+        }
+    }
+    else
+    {
+        // We have received that message already, ignore it here
+        m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Discarding already received message {} from {}.", toString(payload, m_checksumSize, m_headerSize), toString(remoteSockAddr)));
+    }
+}
+
+payload_t MiddleWare::makeAckMessage(payload_t const &dataMessage, epoch_t epoch) const
+{
+    // Peer-Id
+    payload_t ret(begin(dataMessage), begin(dataMessage) + sizeof(peerId_t) + sizeof(wireSeqNr_t));
+    appendChecksum(m_config.checksumType, ret, epoch);
+    return ret;
+}
+
+void MiddleWare::processRxControlMessage(payload_t const &payload, ITxSocket *txSocket, system_clock::time_point const &now)
+{
+    if ((payload.size() < CONTROL_HEADER_SIZE + m_checksumSize) || !verifyChecksum(m_config.checksumType, payload.data(), payload.size()))
+    {
+        m_pApp->log(IApp::LOG_TYPE::WARN, "Discarding rx control message: Truncated or checksum error.");
+        return;
+    }
+
+    ControlType type = static_cast<ControlType>(payload[sizeof(peerId_t)]);
+    TraceScope trace(getTraceName(type));
+    switch (type)
+    {
+        case ControlType::DIGEST:
+            processRxDigestMessage(payload, txSocket);
+            break;
+        case ControlType::HEARTBEAT:
+            // the failure detector already took note of the sender
+            break;
+        case ControlType::STATUS:
+        case ControlType::STATUS_REQUEST:
+            processRxStatusMessage(payload, txSocket, (type == ControlType::STATUS_REQUEST));
+            break;
+        case ControlType::NACK:
+            processRxNackMessage(payload, txSocket, now);
+            break;
+        case ControlType::FEC_PARITY:
+            processRxFecParity(payload, now);
+            break;
+        default:
+            m_pApp->log(IApp::LOG_TYPE::WARN, fmt::format("Discarding rx control message: Unknown type {}.", static_cast<uint16_t>(type)));
+            break;
+    }
+}
+
+void MiddleWare::sendHeartbeats()
+{
+    payload_t heartbeat = { CONTROL_PEER_ID >> 8, CONTROL_PEER_ID & 0xff, static_cast<uint8_t>(ControlType::HEARTBEAT) };
+    appendChecksum(m_config.checksumType, heartbeat);
+
+    for (ITxSocket *pTxSocket : m_txSockets)
+    {
+        if (pTxSocket->getPeerId() != m_ownPeerId)
+        {
+            TransmitStatus txStatus = sendDatagram(pTxSocket, heartbeat);
+            if (txStatus.status != 0)
+            {
+                m_pApp->log(IApp::LOG_TYPE::ERR, fmt::format("Failed to send heartbeat to {}; error code: {}.", 
+                    toString(pTxSocket->getRemoteSocketAddr()), txStatus.status));
+            }
+        }
+    }
+}
+
+void MiddleWare::markHeardFrom(peerId_t peerId, system_clock::time_point const &now)
+{
+    if (m_config.heartbeatInterval.count() == 0)
+    {
+        return;
+    }
+
+    auto it = std::find_if(begin(m_peerLiveness), end(m_peerLiveness),
+        [&peerId](auto const &liveness) { return (liveness.peerId == peerId); });
+
+    if (it != end(m_peerLiveness))
+    {
+        it->lastHeard = now;
+        if (it->suspected)
+        {
+            it->suspected = false;
+            m_numSuspected--;
+            m_pApp->log(IApp::LOG_TYPE::MSG, fmt::format("Peer {} is alive again, sending to it again.", peerId));
+        }
+    }
+}
+
+void MiddleWare::checkLiveness(system_clock::time_point const &now)
+{
+    for (auto &liveness : m_peerLiveness)
+    {
+        // Every peer gets the full suspect timeout after our start
+        if (!liveness.lastHeard.has_value())
+        {
+            liveness.lastHeard = now;
+        }
+
+        if (!liveness.suspected && (now - *liveness.lastHeard > m_config.suspectTimeout))
+        {
+            liveness.suspected = true;
+            m_numSuspected++;
+            m_pApp->log(IApp::LOG_TYPE::WARN, fmt::format("Suspecting peer {} to have failed, nothing received for {} ms.", 
+                liveness.peerId, duration_cast<milliseconds>(now - *liveness.lastHeard).count()));
+
+            // Stop waiting for its ACKs, like after giving up retransmitting to it
+            for (auto &txMsgState : m_txMessageStates)
+            {
+                for (auto &txState : txMsgState.getTxStates())
+                {
+                    if (txState.getSocket()->getPeerId() == liveness.peerId)
+                    {
+                        txState.setAcknowledged();
+                    }
+                }
+            }
+        }
+    }
+}
+
+void MiddleWare::addPeer(ITxSocket *pTxSocket)
+{
+    peerId_t peerId = pTxSocket->getPeerId();
+    m_txSockets.push_back(pTxSocket);
+    // A peer joining an existing group, or re-added with a new address, may be far beyond sequence number 0
+    m_nextSeqNrs.push_back({peerId, 0, (peerId == m_ownPeerId)});
+    if (peerId != m_ownPeerId)
+    {
+        m_peerLiveness.push_back({peerId, std::nullopt, false});
+    }
+}
+
+void MiddleWare::removePeer(peerId_t peerId)
+{
+    // In-flight messages complete once the remaining peers have acknowledged them
+    for (auto &txMsgState : m_txMessageStates)
+    {
+        accountTxMessageState(txMsgState, false);
+        txMsgState.removeTxStates(peerId);
+        accountTxMessageState(txMsgState, true);
+    }
+
+    m_txSockets.erase(std::remove_if(begin(m_txSockets), end(m_txSockets),
+        [peerId](auto const *pTxSocket) { return (pTxSocket->getPeerId() == peerId); }), end(m_txSockets));
+    m_nextSeqNrs.erase(std::remove_if(begin(m_nextSeqNrs), end(m_nextSeqNrs),
+        [peerId](auto const &nsn) { return (nsn.peerId == peerId); }), end(m_nextSeqNrs));
+    m_peerRtts.erase(std::remove_if(begin(m_peerRtts), end(m_peerRtts),
+        [peerId](auto const &peerRtt) { return (peerRtt.peerId == peerId); }), end(m_peerRtts));
+    m_rxStreams.erase(peerId);
+    m_peerStatus.erase(peerId);
+    m_peerPacers.erase(peerId);
+    m_digestNextSeqNrs.erase(peerId);
+    m_pacedStreamFrames.remove_if([peerId](auto const &pacedTx) { return (pacedTx.pTxSocket->getPeerId() == peerId); });
+    m_statusDue.erase(std::remove(begin(m_statusDue), end(m_statusDue), peerId), end(m_statusDue));
+    m_fecFrames.erase(m_fecFrames.lower_bound({ peerId, 0 }), m_fecFrames.upper_bound({ peerId, UINT32_MAX }));
+    m_fecParities.erase(m_fecParities.lower_bound({ peerId, 0 }), m_fecParities.upper_bound({ peerId, UINT32_MAX }));
+    m_fecSkipped.erase(m_fecSkipped.lower_bound({ peerId, 0 }), m_fecSkipped.upper_bound({ peerId, UINT32_MAX }));
+
+    auto it = std::find_if(begin(m_peerLiveness), end(m_peerLiveness),
+        [peerId](auto const &liveness) { return (liveness.peerId == peerId); });
+    if (it != end(m_peerLiveness))
+    {
+        if (it->suspected)
+        {
+            m_numSuspected--;
+        }
+        m_peerLiveness.erase(it);
+    }
+
+    // Own messages may only have waited for the departed peer
+    releaseStableMessages();
+}
+
+bool MiddleWare::isSuspected(peerId_t peerId) const
+{
+    if (m_numSuspected == 0)
+    {
+        return false;
+    }
+
+    auto it = std::find_if(begin(m_peerLiveness), end(m_peerLiveness),
+        [&peerId](auto const &liveness) { return (liveness.peerId == peerId); });
+    return ((it != end(m_peerLiveness)) && it->suspected);
+}
+
+vector<ITxSocket *> const &MiddleWare::getUnsuspectedTxSockets()
+{
+    if (m_numSuspected == 0)
+    {
+        return m_txSockets;
+    }
+
+    m_unsuspectedTxSockets.clear();
+    std::copy_if(begin(m_txSockets), end(m_txSockets), back_inserter(m_unsuspectedTxSockets), 
+        [this](auto const *pTxSocket) { return !isSuspected(pTxSocket->getPeerId()); });
+    return m_unsuspectedTxSockets;
+}
+
+void MiddleWare::processRxDigestMessage(payload_t const &payload, ITxSocket *txSocket)
+{
+    size_t const entriesEnd = payload.size() - m_checksumSize;
+    if ((entriesEnd - CONTROL_HEADER_SIZE) % DIGEST_ENTRY_SIZE != 0)
+    {
+        m_pApp->log(IApp::LOG_TYPE::WARN, "Discarding digest: Truncated.");
+        return;
+    }
+
+    for (size_t pos = CONTROL_HEADER_SIZE; pos < entriesEnd; pos += DIGEST_ENTRY_SIZE)
+    {
+        peerId_t originPeerId = (payload[pos] << 8) + payload[pos + 1];
+        seqNr_t remoteNextSeqNr = readSeqNr(&payload[pos + 2]);
+        m_digestNextSeqNrs[txSocket->getPeerId()][originPeerId] = remoteNextSeqNr;
+
+        // Push the retained messages the remote peer is missing and would accept. The remote peer treats them
+        // like any other new message, i.e. it acknowledges and relays them.
+        for (auto const &retained : m_retainedMsgs)
+        {
+            if ((retained.msgId.getPeerId() == originPeerId) && (retained.msgId.getSeqNr() - remoteNextSeqNr < SEQ_NR_WINDOW))
+            {
+                m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Pushing message {} missing in digest of {}.", 
+                    toString(retained.payload, m_checksumSize, m_headerSize), toString(txSocket->getRemoteSocketAddr())));
+                TransmitStatus txStatus = sendDatagram(txSocket, retained.payload);
+                if (txStatus.status != 0)
+                {
+                    m_pApp->log(IApp::LOG_TYPE::ERR, fmt::format("Failed to push message {} to {}; error code: {}.", 
+                        toString(retained.payload, m_checksumSize, m_headerSize), toString(txSocket->getRemoteSocketAddr()), txStatus.status));
+                }
+            }
+        }
+    }
+}
+
+void MiddleWare::addTxMessageState(MessageId const &msgId, payload_t payload, ITxSocket const *pReceivedFrom, system_clock::time_point const &now,
+    payload_t inflatedMessage, payload_t fecParity, Priority priority, milliseconds ttl)
+{
+    // Behind the last message of the same or a higher lane, searched from the back where the message usually goes
+    auto pos = std::find_if(m_txMessageStates.rbegin(), m_txMessageStates.rend(),
+        [priority](auto const &other) { return (other.getPriority() <= priority); }).base();
+
+    list<TxMessageState>::iterator it;
+    if (m_config.dissemination == Dissemination::GOSSIP)
+    {
+        retainMessage(msgId, payload);
+        it = m_txMessageStates.emplace(pos, msgId, selectGossipTxSockets(pReceivedFrom), std::move(payload), now);
+    }
+    else
+    {
+        it = m_txMessageStates.emplace(pos, msgId, getUnsuspectedTxSockets(), std::move(payload), now);
+    }
+
+    it->setInflatedMessage(std::move(inflatedMessage));
+    it->setFecParity(std::move(fecParity));
+    it->setPriority(priority);
+    if (ttl.count() > 0)
+    {
+        it->setExpiry(now + ttl);
+    }
+    accountTxMessageState(*it, true);
+
+    if (m_pWal != nullptr)
+    {
+        checkWalError(m_pWal->logMessage(msgId, it->getPayload()));
+    }
+}
+
+Priority MiddleWare::getFramePriority(payload_t const &payload) const
+{
+    if (!m_config.priorityLanes || (payload.size() < m_headerSize + m_checksumSize))
+    {
+        return Priority::NORMAL;
+    }
+    uint8_t priority = (payload[MSG_ID_SIZE] & FRAME_PRIORITY_MASK) >> FRAME_PRIORITY_SHIFT;
+    return (priority <= static_cast<uint8_t>(Priority::BULK)) ? static_cast<Priority>(priority) : Priority::BULK;
+}
+
+milliseconds MiddleWare::getFrameTtl(payload_t const &payload) const
+{
+    if (!m_config.priorityLanes || (payload.size() < m_headerSize + m_checksumSize))
+    {
+        return milliseconds(0);
+    }
+    // Each transmission carries the time the message has left, see refreshFrameTtl()
+    return milliseconds((payload[MSG_ID_SIZE + 1] << 8) + payload[MSG_ID_SIZE + 2]);
+}
+
+void MiddleWare::setFrameTtl(payload_t &frame, milliseconds ttl, epoch_t epoch) const
+{
+    frame[MSG_ID_SIZE + 1] = static_cast<uint8_t>(ttl.count() >> 8);
+    frame[MSG_ID_SIZE + 2] = static_cast<uint8_t>(ttl.count() & 0xff);
+    // shrinking keeps the capacity, the deliveries may point into the frame
+    frame.resize(frame.size() - m_checksumSize);
+    appendChecksum(m_config.checksumType, frame, epoch);
+}
+
+void MiddleWare::refreshFrameTtl(TxMessageState &txMsgState, system_clock::time_point const &now) const
+{
+    payload_t &frame = txMsgState.getPayload();
+    if (!m_config.priorityLanes || (txMsgState.getExpiry() == system_clock::time_point::max()) ||
+        (frame.size() < m_headerSize + m_checksumSize))
+    {
+        return;
+    }
+    // The origin and each relay send the remaining time to live, so that it does not start over on every hop
+    milliseconds ttl = std::clamp(duration_cast<milliseconds>(txMsgState.getExpiry() - now), milliseconds(1), MAX_MESSAGE_TTL);
+    setFrameTtl(frame, ttl, getEpoch(txMsgState.getMsgId().getSeqNr()));
+}
+
+payload_t MiddleWare::getFecFrame(payload_t const &frame, epoch_t epoch) const
+{
+    // The time to live changes on the way of a frame, the parity covers it as 0
+    payload_t ret = frame;
+    if (m_config.priorityLanes && (ret.size() >= m_headerSize + m_checksumSize))
+    {
+        setFrameTtl(ret, milliseconds(0), epoch);
+    }
+    return ret;
+}
+
+size_t MiddleWare::restore(walState_t const &state, system_clock::time_point const &now)
+{
+    for (auto const &watermark : state.watermarks)
+    {
+        if (watermark.peerId == m_ownPeerId)
+        {
+            m_nextSeqNr = watermark.nextSeqNr;
+        }
+        setAcceptedSeqNrOfPeer(watermark.peerId, watermark.nextSeqNr);
+    }
+
+    size_t ret = 0;
+    for (auto const &message : state.messages)
+    {
+        payload_t inflatedMessage;
+        if (isDeflatedFrame(message.frame))
+        {
+            optional<payload_t> optInflated = inflateFrame(message.frame);
+            if (!optInflated.has_value())
+            {
+                continue;
+            }
+            inflatedMessage = std::move(*optInflated);
+        }
+
+        if (m_config.reliability == Reliability::NACK)
+        {
+            // Only own messages are logged, the receivers request them again if they miss them
+            if (message.msgId.getPeerId() == m_ownPeerId)
+            {
+                sendStreamMessage(message.msgId, message.frame, now, std::move(inflatedMessage));
+                ret++;
+            }
+            continue;
+        }
+
+        // The time to live starts again with the new process
+        addTxMessageState(message.msgId, message.frame, nullptr, now, std::move(inflatedMessage), {}, getFramePriority(message.frame),
+            getFrameTtl(message.frame));
+        ret++;
+    }
+
+    return ret;
+}
+
+int MiddleWare::setWriteAheadLog(WriteAheadLog *pWal)
+{
+    m_pWal = pWal;
+    m_pWal->setSnapshotWriter([this]() { writeSnapshot(); });
+    return m_pWal->roll();
+}
+
+void MiddleWare::writeSnapshot()
+{
+    checkWalError(m_pWal->logWatermark(m_ownPeerId, m_nextSeqNr));
+    for (auto const &nsn : m_nextSeqNrs)
+    {
+        if (nsn.peerId != m_ownPeerId)
+        {
+            checkWalError(m_pWal->logWatermark(nsn.peerId, nsn.nextSeqNr));
+        }
+    }
+
+    for (auto const &txMsgState : m_txMessageStates)
+    {
+        checkWalError(m_pWal->logMessage(txMsgState.getMsgId(), txMsgState.getPayload()));
+    }
+    for (auto const &unstable : m_unstableMsgs)
+    {
+        checkWalError(m_pWal->logMessage(unstable.getMsgId(), unstable.getPayload()));
+    }
+}
+
+void MiddleWare::checkWalError(int error) const
+{
+    if (error != 0)
+    {
+        m_pApp->log(IApp::LOG_TYPE::ERR, fmt::format("Could not write the write-ahead log: {}.", strerror(error)));
+    }
+}
+
+bool MiddleWare::isDeflatedFrame(payload_t const &payload) const
+{
+    return ((m_headerSize > MSG_ID_SIZE) && (payload.size() > MSG_ID_SIZE + m_checksumSize) && 
+            ((payload[MSG_ID_SIZE] & FRAME_FLAG_DEFLATED) != 0));
+}
+
+optional<payload_t> MiddleWare::inflateFrame(payload_t const &payload) const
+{
+    if (payload.size() < m_headerSize + INFLATED_SIZE_BYTES + m_checksumSize)
+    {
+        return std::nullopt;
+    }
+
+    uint8_t const *pContent = payload.data() + m_headerSize;
+    size_t inflatedSize = (static_cast<size_t>(pContent[0]) << 24) + (pContent[1] << 16) + (pContent[2] << 8) + pContent[3];
+    return inflateData(pContent + INFLATED_SIZE_BYTES, payload.size() - m_headerSize - INFLATED_SIZE_BYTES - m_checksumSize, inflatedSize);
+}
+
+delivery_t MiddleWare::makeDelivery(TxMessageState const &txMsgState) const
+{
+    payload_t const &inflated = txMsgState.getInflatedMessage();
+    if (!inflated.empty())
+    {
+        return { txMsgState.getMsgId(), inflated.data(), inflated.size() };
+    }
+
+    payload_t const &payload = txMsgState.getPayload();
+    return { txMsgState.getMsgId(), payload.data() + m_headerSize, payload.size() - m_headerSize - m_checksumSize };
+}
+
+bool MiddleWare::isInFlightBudgetAvailable(peerId_t originPeerId, size_t payloadSize) const
+{
+    auto it = m_inFlightPerOrigin.find(originPeerId);
+    size_t inFlightOfOrigin = (it == end(m_inFlightPerOrigin)) ? 0 : it->second;
+    size_t stateBytes = TxMessageState::estimateStateBytes(payloadSize, m_txSockets.size());
+
+    return (((m_config.maxInFlightPerOrigin == 0) || (inFlightOfOrigin < m_config.maxInFlightPerOrigin)) &&
+            ((m_config.maxPayloadBytes == 0) || (m_usage.payloadBytes + payloadSize <= m_config.maxPayloadBytes)) &&
+            ((m_config.maxStateBytes == 0) || (m_usage.stateBytes + stateBytes <= m_config.maxStateBytes)));
+}
+
+void MiddleWare::accountTxMessageState(TxMessageState const &txMsgState, bool isAdded)
+{
+    peerId_t originPeerId = txMsgState.getMsgId().getPeerId();
+    size_t payloadBytes = txMsgState.getPayload().size();
+    size_t stateBytes = txMsgState.getStateBytes();
+
+    if (isAdded)
+    {
+        m_inFlightPerOrigin[originPeerId]++;
+        m_usage.numMessages++;
+        m_usage.payloadBytes += payloadBytes;
+        m_usage.stateBytes += stateBytes;
+    }
+    else
+    {
+        auto it = m_inFlightPerOrigin.find(originPeerId);
+        if (--(it->second) == 0)
+        {
+            m_inFlightPerOrigin.erase(it);
+        }
+        m_usage.numMessages--;
+        m_usage.payloadBytes -= payloadBytes;
+        m_usage.stateBytes -= stateBytes;
+    }
+}
+
+mwUsage_t MiddleWare::getUsage() const
+{
+    mwUsage_t ret = m_usage;
+    ret.maxInFlightOfOrigin = std::accumulate(begin(m_inFlightPerOrigin), end(m_inFlightPerOrigin), static_cast<size_t>(0), 
+        [](size_t acc, auto const &e) { return std::max(acc, e.second); });
+    return ret;
+}
+
+vector<ITxSocket *> MiddleWare::selectGossipTxSockets(ITxSocket const *pReceivedFrom)
+{
+    vector<ITxSocket *> ret;
+    vector<ITxSocket *> candidates;
+
+    for (ITxSocket *pTxSocket : m_txSockets)
+    {
+        if (pTxSocket->getPeerId() == m_ownPeerId)
+        {
+            // We keep sending to ourselves, so that a peer which can't receive does not deliver
+            ret.push_back(pTxSocket);
+        }
+        else if ((pTxSocket != pReceivedFrom) && !isSuspected(pTxSocket->getPeerId()))
+        {
+            candidates.push_back(pTxSocket);
+        }
+    }
+
+    // Partial Fisher-Yates shuffle: the first fanOut candidates are a random subset
+    size_t fanOut = std::min<size_t>(m_config.gossipFanOut, candidates.size());
+    for (size_t i = 0; i < fanOut; i++)
+    {
+        std::uniform_int_distribution<size_t> dist(i, candidates.size() - 1);
+        std::swap(candidates[i], candidates[dist(m_rng)]);
+        ret.push_back(candidates[i]);
+    }
+
+    return ret;
+}
+
+void MiddleWare::retainMessage(MessageId const &msgId, payload_t const &payload)
+{
+    m_retainedMsgs.push_back({msgId, payload});
+    while (m_retainedMsgs.size() > m_config.gossipRetention)
+    {
+        // anti-entropy can't repair the message any more
+        if (!isCoveredByDigests(m_retainedMsgs.front().msgId))
+        {
+            m_usage.numUnconfirmedEvictions++;
+        }
+        m_retainedMsgs.pop_front();
+    }
+}
+
+bool MiddleWare::isCoveredByDigests(MessageId const &msgId) const
+{
+    for (ITxSocket const *pTxSocket : m_txSockets)
+    {
+        peerId_t peerId = pTxSocket->getPeerId();
+        if ((peerId == m_ownPeerId) || (peerId == msgId.getPeerId()) || isSuspected(peerId))
+        {
+            continue;
+        }
+
+        auto itPeer = m_digestNextSeqNrs.find(peerId);
+        if (itPeer == end(m_digestNextSeqNrs))
+        {
+            return false;
+        }
+        auto itOrigin = itPeer->second.find(msgId.getPeerId());
+        if ((itOrigin == end(itPeer->second)) || !isSeqNrBefore(msgId.getSeqNr(), itOrigin->second))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MiddleWare::sendDigests()
+{
+    vector<ITxSocket *> candidates;
+    std::copy_if(begin(m_txSockets), end(m_txSockets), back_inserter(candidates), 
+        [this](auto const *pTxSocket) { return (pTxSocket->getPeerId() != m_ownPeerId); });
+
+    if (candidates.empty())
+    {
+        return;
+    }
+
+    ITxSocket *pTxSocket = candidates[std::uniform_int_distribution<size_t>(0, candidates.size() - 1)(m_rng)];
+
+    payload_t entries;
+    appendSeqNrEntry(entries, m_ownPeerId, m_nextSeqNr);
+    for (auto const &nsn : m_nextSeqNrs)
+    {
+        if (nsn.peerId != m_ownPeerId)
+        {
+            appendSeqNrEntry(entries, nsn.peerId, nsn.nextSeqNr);
+        }
+    }
+
+    sendControlMessage(pTxSocket, ControlType::DIGEST, entries, DIGEST_ENTRY_SIZE, "digest");
+}
+
+void MiddleWare::sendControlMessage(ITxSocket *pTxSocket, ControlType type, payload_t const &entries, size_t entrySize, char const *name)
+{
+    // Split up the entries so that each frame fits into the rx buffer of the remote peer
+    size_t const maxEntryBytesPerFrame = (BUFFER_SIZE - CONTROL_HEADER_SIZE - m_checksumSize) / entrySize * entrySize;
+    for (size_t first = 0; first < entries.size(); first += maxEntryBytesPerFrame)
+    {
+        size_t last = std::min(entries.size(), first + maxEntryBytesPerFrame);
+        payload_t frame;
+        frame.reserve(CONTROL_HEADER_SIZE + (last - first) + m_checksumSize);
+        frame.push_back(CONTROL_PEER_ID >> 8);
+        frame.push_back(CONTROL_PEER_ID & 0xff);
+        frame.push_back(static_cast<uint8_t>(type));
+        frame.insert(end(frame), begin(entries) + first, begin(entries) + last);
+        appendChecksum(m_config.checksumType, frame);
+
+        TransmitStatus txStatus = sendDatagram(pTxSocket, frame);
+        if (txStatus.status != 0)
+        {
+            m_pApp->log(IApp::LOG_TYPE::ERR, fmt::format("Failed to send {} to {}; error code: {}.", 
+                name, toString(pTxSocket->getRemoteSocketAddr()), txStatus.status));
+        }
+    }
+}
+
+ITxSocket *MiddleWare::findTxSocket(peerId_t peerId) const
+{
+    auto it = std::find_if(begin(m_txSockets), end(m_txSockets),
+        [peerId](auto const *pTxSocket) { return (pTxSocket->getPeerId() == peerId); });
+    return (it != end(m_txSockets)) ? *it : nullptr;
+}
+
+void MiddleWare::sendStreamMessage(MessageId const &msgId, payload_t payload, system_clock::time_point const &now, payload_t inflatedMessage,
+    payload_t const &fecParity)
+{
+    // Kept without tx states until all peers confirmed it in their status
+    m_unstableMsgs.emplace_back(msgId, vector<ITxSocket *>(), std::move(payload), now);
+    TxMessageState &unstable = m_unstableMsgs.back();
+    unstable.setInflatedMessage(std::move(inflatedMessage));
+    accountTxMessageState(unstable, true);
+    if (m_pWal != nullptr)
+    {
+        checkWalError(m_pWal->logMessage(msgId, unstable.getPayload()));
+    }
+
+    // A lost message to ourselves shows up as gap like any other
+    rxStream_t &ownStream = getRxStream(m_ownPeerId);
+    if (isSeqNrBefore(ownStream.knownEnd, msgId.getSeqNr() + 1))
+    {
+        ownStream.knownEnd = msgId.getSeqNr() + 1;
+    }
+
+    if (m_pMcastTxSocket != nullptr)
+    {
+        queueStreamFrame(m_pMcastTxSocket, unstable.getPayload(), fecParity, false, now);
+    }
+    else
+    {
+        for (ITxSocket *pTxSocket : getUnsuspectedTxSockets())
+        {
+            queueStreamFrame(pTxSocket, unstable.getPayload(), fecParity, false, now);
+        }
+    }
+    releasePacedStreamFrames(now);
+}
+
+void MiddleWare::queueStreamFrame(ITxSocket *pTxSocket, payload_t const &frame, payload_t const &fecParity, bool isRetransmission,
+    system_clock::time_point const &now)
+{
+    if (!isPaced(pTxSocket))
+    {
+        sendStreamFrame(pTxSocket, frame, fecParity, isRetransmission, now);
+        return;
+    }
+
+    // Unlike in ACK mode, the origin does not keep tx states, so the frame waits in a queue of its own
+    m_pacedStreamFrames.push_back({ pTxSocket, frame, fecParity, isRetransmission, now, false });
+}
+
+void MiddleWare::releasePacedStreamFrames(system_clock::time_point const &now)
+{
+    // A socket whose frame has to wait holds back its later frames as well
+    vector<ITxSocket const *> heldSockets;
+    m_nextPacedStreamFrame = system_clock::time_point::max();
+    for (auto it = begin(m_pacedStreamFrames); it != end(m_pacedStreamFrames);)
+    {
+        if (std::find(begin(heldSockets), end(heldSockets), it->pTxSocket) != end(heldSockets))
+        {
+            ++it;
+            continue;
+        }
+
+        system_clock::time_point slot = getPacingSlot(it->pTxSocket, it->frame.size(), now);
+        if (slot > now)
+        {
+            it->isDeferred = true;
+            heldSockets.push_back(it->pTxSocket);
+            m_nextPacedStreamFrame = std::min(m_nextPacedStreamFrame, slot);
+            ++it;
+            continue;
+        }
+
+        if (it->isDeferred)
+        {
+            size_t delayNs = static_cast<size_t>(std::max(duration_cast<nanoseconds>(now - it->dueSince).count(), int64_t(0)));
+            m_usage.numPacedDatagrams++;
+            m_usage.pacingDelayNsSum += delayNs;
+            m_usage.pacingDelayNsMax = std::max(m_usage.pacingDelayNsMax, delayNs);
+        }
+        // a multicast fallback appends its unicast frames, which this loop then serves as well
+        sendStreamFrame(it->pTxSocket, it->frame, it->fecParity, it->isRetransmission, now);
+        it = m_pacedStreamFrames.erase(it);
+    }
+}
+
+void MiddleWare::sendStreamFrame(ITxSocket *pTxSocket, payload_t const &frame, payload_t const &fecParity, bool isRetransmission,
+    system_clock::time_point const &now)
+{
+    auto result = sendDatagram(pTxSocket, frame);
+    if (isRetransmission)
+    {
+        if (result.status != 0)
+        {
+            m_pApp->log(IApp::LOG_TYPE::ERR, fmt::format("Failed to retransmit message {} to {}; error code: {}.", 
+                toString(frame, m_checksumSize, m_headerSize), toString(pTxSocket->getRemoteSocketAddr()), result.status));
+        }
+        return;
+    }
+
+    if ((result.status != 0) && (pTxSocket == m_pMcastTxSocket))
+    {
+        // Fall back to unicast for this message
+        m_pApp->log(IApp::LOG_TYPE::ERR, 
+            fmt::format("Failed to send message {} to group {}; error code: {}", toString(frame, m_checksumSize, m_headerSize), toString(pTxSocket->getRemoteSocketAddr()), result.status));
+        for (ITxSocket *pUnicastTxSocket : getUnsuspectedTxSockets())
+        {
+            queueStreamFrame(pUnicastTxSocket, frame, fecParity, false, now);
+        }
+        return;
+    }
+
+    if (result.status != 0)
+    {
+        m_pApp->log(IApp::LOG_TYPE::ERR, 
+            fmt::format("Failed to send message {} to {}; error code: {}", toString(frame, m_checksumSize, m_headerSize), toString(pTxSocket->getRemoteSocketAddr()), result.status));
+    }
+    else
+    {
+        std::string group = (pTxSocket == m_pMcastTxSocket) ? "group " : "";
+        m_pApp->log(IApp::LOG_TYPE::MSG, fmt::format("Sending message {} to {}{}.", toString(frame, m_checksumSize, m_headerSize), group, toString(pTxSocket->getRemoteSocketAddr())));
+    }
+
+    if (!fecParity.empty())
+    {
+        (void)sendDatagram(pTxSocket, fecParity);
+    }
+}
+
+void MiddleWare::processRxStreamMessage(payload_t const &payload, MessageId const &msgId, ITxSocket *txSocket)
+{
+    struct sockaddr_in const &remoteSockAddr = txSocket->getRemoteSocketAddr();
+    peerId_t originPeerId = msgId.getPeerId();
+    seqNr_t seqNr = msgId.getSeqNr();
+    rxStream_t &stream = getRxStream(originPeerId);
+
+    if (!isSeqNrOfPeerAccepted(originPeerId, seqNr) || (stream.pending.count(seqNr) > 0))
+    {
+        m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Discarding message due to SeqNr: {} from {}.", toString(payload, m_checksumSize, m_headerSize), toString(remoteSockAddr)));
+        return;
+    }
+
+    payload_t inflatedMessage;
+    if (isDeflatedFrame(payload))
+    {
+        optional<payload_t> optInflated = inflateFrame(payload);
+        if (!optInflated.has_value())
+        {
+            m_pApp->log(IApp::LOG_TYPE::WARN, fmt::format("Discarding rx message {}: Could not inflate.", toString(msgId)));
+            return;
+        }
+        inflatedMessage = std::move(*optInflated);
+    }
 
-using namespace std;
-using namespace rgc;
-using namespace std::chrono;
+    m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Received data message {} from {}.", toString(payload, m_checksumSize, m_headerSize), toString(remoteSockAddr)));
+    stream.pending.emplace(seqNr, streamMsg_t{ payload, std::move(inflatedMessage) });
 
-static constexpr size_t MSG_ID_SIZE = 4;
-static constexpr size_t CRC_SIZE = 2;
+    // Messages between the last known one and this one are missing, request them right away
+    seqNr_t gapStart = stream.knownEnd;
+    if (isSeqNrBefore(gapStart, seqNr + 1))
+    {
+        stream.knownEnd = seqNr + 1;
+        requestMissing(originPeerId, stream, gapStart);
+    }
 
-static constexpr duration<int64_t, std::milli> ACK_TIMEOUT = milliseconds(1000);
+    deliverStream(originPeerId, stream);
+}
 
-void MiddleWare::rxTxLoop(system_clock::time_point const &now)
+MiddleWare::rxStream_t &MiddleWare::getRxStream(peerId_t originPeerId)
 {
-    listenRxSocket(now);
-    checkPendingTxMessages(now);
+    auto it = m_rxStreams.find(originPeerId);
+    if (it == end(m_rxStreams))
+    {
+        it = m_rxStreams.emplace(originPeerId, rxStream_t{ getAcceptedSeqNrOfPeer(originPeerId), {} }).first;
+    }
+    return it->second;
 }
 
-void MiddleWare::sendMessage(string const &message, system_clock::time_point const &now)
+void MiddleWare::deliverStream(peerId_t originPeerId, rxStream_t &stream)
 {
-    MessageId msgId = MessageId(m_ownPeerId, m_nextSeqNr);
-    payload_t payload;
-    payload.reserve(message.length() + 6);
-    payload.push_back(m_ownPeerId >> 8);
-    payload.push_back(m_ownPeerId & 0xff);
-    payload.push_back(m_nextSeqNr >> 8);
-    payload.push_back(m_nextSeqNr & 0xff);
-    payload.insert(end(payload), begin(message), end(message));
-    checksum_t checksum = rfc1071Checksum(payload.data(), payload.size());
-    payload.push_back(checksum >> 8);
-    payload.push_back(checksum & 0xff);
+    // Deliver the messages without gap in the order of the origin, the views point into the pending messages
+    seqNr_t nextSeqNr = getAcceptedSeqNrOfPeer(originPeerId);
+    m_deliveries.clear();
+    auto it = begin(stream.pending);
+    for (; (it != end(stream.pending)) && (it->first == nextSeqNr); ++it, ++nextSeqNr)
+    {
+        payload_t const &inflated = it->second.inflatedMessage;
+        payload_t const &payload = it->second.payload;
+        m_deliveries.push_back(inflated.empty() ?
+            delivery_t{ MessageId(originPeerId, it->first), payload.data() + m_headerSize, payload.size() - m_headerSize - m_checksumSize } :
+            delivery_t{ MessageId(originPeerId, it->first), inflated.data(), inflated.size() });
+    }
 
-    m_txMessageStates.emplace_back(msgId, m_txSockets, payload, now);
-    ++m_nextSeqNr;
+    if (m_deliveries.empty())
+    {
+        return;
+    }
 
-#if defined (PEER_SENDS_TO_ITSELF)
-    setAcceptedSeqNrOfPeer(m_ownPeerId, m_nextSeqNr);
-#endif    
+    {
+        TraceScope trace("deliverMessages");
+        m_pApp->deliverMessages(m_deliveries.data(), m_deliveries.size());
+    }
+    stream.pending.erase(begin(stream.pending), it);
+    setAcceptedSeqNrOfPeer(originPeerId, nextSeqNr);
+    markStatusDue(originPeerId);
+
+    if (m_pWal != nullptr)
+    {
+        checkWalError(m_pWal->logWatermark(originPeerId, nextSeqNr));
+    }
 }
 
-void MiddleWare::listenRxSocket(system_clock::time_point const &now)
+void MiddleWare::requestMissing(peerId_t originPeerId, rxStream_t const &stream, seqNr_t first)
 {
-    rx_buffer_t buf;
-    struct sockaddr_in remoteSockAddr;
-    
-    // Polling for incoming data until there is nothing left to receive or an error happens 
-    for (;;)
+    ITxSocket *pTxSocket = findTxSocket(originPeerId);
+    seqNr_t nextSeqNr = getAcceptedSeqNrOfPeer(originPeerId);
+    if ((pTxSocket == nullptr) || !isSeqNrBefore(nextSeqNr, stream.knownEnd))
     {
-        rgc::TransmitStatus status = m_pRxSocket->receive(buf, remoteSockAddr);
+        return;
+    }
 
-        if (status.status != 0)
-        {
-             m_pApp->log(IApp::LOG_TYPE::ERR, fmt::format("Error reading from Rx Socket, error code: {}", status.status));
-        }
-        else
+    // Only messages which would be accepted are requested
+    seqNr_t last = isSeqNrBefore(nextSeqNr + NACK_SEQ_NR_WINDOW, stream.knownEnd) ? (nextSeqNr + NACK_SEQ_NR_WINDOW) : stream.knownEnd;
+    payload_t entries;
+    for (auto it = stream.pending.lower_bound(first);; ++it)
+    {
+        seqNr_t rangeEnd = ((it == end(stream.pending)) || !isSeqNrBefore(it->first, last)) ? last : it->first;
+        if (isSeqNrBefore(first, rangeEnd))
         {
-            if (status.transmitBytes > 0)
-            {
-                payload_t payload(&buf[0], &buf[status.transmitBytes]);
-                injectError(payload);
-                processRxMessage(payload, remoteSockAddr, now);
-            }
+            appendSeqNrEntry(entries, originPeerId, first);
+            entries.push_back(((rangeEnd - first) >> 8) & 0xff);
+            entries.push_back((rangeEnd - first) & 0xff);
         }
 
-        if ((status.transmitBytes == 0) || (status.status != 0))
+        if (rangeEnd == last)
         {
             break;
         }
+        first = it->first + 1;
+    }
+
+    if (!entries.empty())
+    {
+        m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Requesting {} missing ranges of peer {} from {}.", 
+            entries.size() / NACK_ENTRY_SIZE, originPeerId, toString(pTxSocket->getRemoteSocketAddr())));
+        sendControlMessage(pTxSocket, ControlType::NACK, entries, NACK_ENTRY_SIZE, "NACK");
     }
 }
 
-void MiddleWare::injectError(rgc::payload_t &payload) const
+void MiddleWare::processRxNackMessage(payload_t const &payload, ITxSocket *txSocket, system_clock::time_point const &now)
 {
-    for (auto it = begin(m_bitFlipInfos); it != end(m_bitFlipInfos); ++it)
+    size_t const entriesEnd = payload.size() - m_checksumSize;
+    if ((entriesEnd - CONTROL_HEADER_SIZE) % NACK_ENTRY_SIZE != 0)
     {
-        uint16_t peerIdtemp = (payload[0] << 8) + payload[1];
-        uint16_t seqNrIdIdtemp = (payload[2] << 8) + payload[3];
-        if (it->peerId == peerIdtemp && it->seqNrId == seqNrIdIdtemp && (it->bitOffset + 16 < static_cast<uint16_t>(payload.size()*8))){
-            size_t bytePos = (it->bitOffset + 16) / 8;
-            size_t bitPos  = (it->bitOffset + 16) % 8;
-            payload[bytePos] ^= static_cast<unsigned char>(1 << bitPos);
+        m_pApp->log(IApp::LOG_TYPE::WARN, "Discarding NACK: Truncated.");
+        return;
+    }
+
+    for (size_t pos = CONTROL_HEADER_SIZE; pos < entriesEnd; pos += NACK_ENTRY_SIZE)
+    {
+        peerId_t originPeerId = (payload[pos] << 8) + payload[pos + 1];
+        seqNr_t first = readSeqNr(&payload[pos + 2]);
+        seqNr_t count = (payload[pos + 6] << 8) + payload[pos + 7];
+        if (originPeerId != m_ownPeerId)
+        {
+            continue;
+        }
+
+        // Retransmitted via unicast to the requesting peer only
+        for (auto const &unstable : m_unstableMsgs)
+        {
+            if (unstable.getMsgId().getSeqNr() - first < count)
+            {
+                m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Retransmitting message {} requested by {}.", 
+                    toString(unstable.getPayload(), m_checksumSize, m_headerSize), toString(txSocket->getRemoteSocketAddr())));
+                queueStreamFrame(txSocket, unstable.getPayload(), {}, true, now);
+            }
         }
     }
+    releasePacedStreamFrames(now);
 }
 
-void MiddleWare::checkPendingTxMessages(system_clock::time_point const &now)
+void MiddleWare::processRxStatusMessage(payload_t const &payload, ITxSocket *txSocket, bool isRequest)
 {
-    for (auto it = begin(m_txMessageStates); it != end(m_txMessageStates); ++it)
+    size_t const entriesEnd = payload.size() - m_checksumSize;
+    if ((entriesEnd - CONTROL_HEADER_SIZE) % DIGEST_ENTRY_SIZE != 0)
     {
-        auto &txMsgState = *it;
+        m_pApp->log(IApp::LOG_TYPE::WARN, "Discarding status: Truncated.");
+        return;
+    }
 
-        vector<TxState> &txStates = txMsgState.getTxStates();
-        for (auto &txState : txStates)
+    peerId_t remotePeerId = txSocket->getPeerId();
+    for (size_t pos = CONTROL_HEADER_SIZE; pos < entriesEnd; pos += DIGEST_ENTRY_SIZE)
+    {
+        peerId_t originPeerId = (payload[pos] << 8) + payload[pos + 1];
+        seqNr_t nextSeqNr = readSeqNr(&payload[pos + 2]);
+
+        if (originPeerId == m_ownPeerId)
+        {
+            // The remote peer has received all our messages before nextSeqNr
+            auto it = m_peerStatus.find(remotePeerId);
+            if (it == end(m_peerStatus))
+            {
+                m_peerStatus.emplace(remotePeerId, nextSeqNr);
+            }
+            else if (isSeqNrBefore(it->second, nextSeqNr))
+            {
+                it->second = nextSeqNr;
+            }
+        }
+        else if (originPeerId == remotePeerId)
         {
-            if (!txState.isAcknowledged() && txState.isTimeoutElapsed(now))
+            // The messages the remote peer sent last are missing here, if they were lost
+            rxStream_t &stream = getRxStream(remotePeerId);
+            if (isSeqNrBefore(stream.knownEnd, nextSeqNr))
             {
-                processTxMessage(txState, txMsgState.getPayload(), now);
+                stream.knownEnd = nextSeqNr;
             }
         }
     }
 
-    if (!m_txMessageStates.empty())
+    if (isRequest)
     {
-        auto deliver_if_acked = [&](const TxMessageState &s){ if (s.isAllAcknowledged()) { m_pApp->deliverMessage(s.getMsgId(), s.getPayload()); } };
-        for_each(begin(m_txMessageStates), end(m_txMessageStates), deliver_if_acked);
-        m_txMessageStates.erase(remove_if(begin(m_txMessageStates), end(m_txMessageStates), 
-            [](const TxMessageState &s){ return s.isAllAcknowledged() || s.isTxToSelfFailed(); }), end(m_txMessageStates));
+        markStatusDue(remotePeerId);
     }
+
+    releaseStableMessages();
 }
 
-void MiddleWare::processTxMessage(TxState &txState, payload_t const &msg, system_clock::time_point const &now)
+void MiddleWare::markStatusDue(peerId_t peerId)
 {
-    uint8_t remainingTxAttempts = txState.getRemainingTxAttempts();
-    if (remainingTxAttempts == 0)
+    if ((peerId != m_ownPeerId) && (std::find(begin(m_statusDue), end(m_statusDue), peerId) == end(m_statusDue)))
     {
-        // we did not get an ACK after the third tx attempt
-        m_pApp->log(IApp::LOG_TYPE::DEBUG, 
-            fmt::format("Got no ACK for message {} after max number of retries, giving up.", toString(msg)));
+        m_statusDue.push_back(peerId);
+    }
+}
 
-        if (txState.getSocket()->getPeerId() == m_ownPeerId)
+void MiddleWare::runStatusRound()
+{
+    // Repeat the requests for all messages which are still missing
+    for (auto const &rxStream : m_rxStreams)
+    {
+        requestMissing(rxStream.first, rxStream.second, getAcceptedSeqNrOfPeer(rxStream.first));
+    }
+
+    // Peers get a status if we received new messages from them or they asked for it. Peers which did not
+    // confirm all our messages yet are asked for their status.
+    for (ITxSocket *pTxSocket : m_txSockets)
+    {
+        peerId_t peerId = pTxSocket->getPeerId();
+        if ((peerId == m_ownPeerId) || isSuspected(peerId))
         {
-            // This peer is broken since it can't propertly receive its own tx message -> Drop the message
-            txState.setTxToSelfFailed();
+            continue;
         }
-        else
+
+        auto it = m_peerStatus.find(peerId);
+        bool isUnconfirmed = !m_unstableMsgs.empty() && ((it == end(m_peerStatus)) || isSeqNrBefore(it->second, m_nextSeqNr));
+        bool isDue = (std::find(begin(m_statusDue), end(m_statusDue), peerId) != end(m_statusDue));
+        if (isUnconfirmed || isDue)
         {
-            // The remote peer is broken. We handle this as if we got an ACK
-            txState.setAcknowledged();
+            payload_t entries;
+            appendSeqNrEntry(entries, m_ownPeerId, m_nextSeqNr);
+            appendSeqNrEntry(entries, peerId, getAcceptedSeqNrOfPeer(peerId));
+            sendControlMessage(pTxSocket, isUnconfirmed ? ControlType::STATUS_REQUEST : ControlType::STATUS, entries, DIGEST_ENTRY_SIZE, "status");
         }
     }
-    else
+    m_statusDue.clear();
+
+    releaseStableMessages();
+}
+
+void MiddleWare::releaseStableMessages()
+{
+    if (m_unstableMsgs.empty())
     {
-        auto result = txState.getSocket()->send(msg);
-        auto const &remoteSockAddr = txState.getSocket()->getRemoteSocketAddr();
-        if (result.status != 0)
+        return;
+    }
+
+    // Stable are the messages we and all unsuspected peers have received
+    seqNr_t stableEnd = getAcceptedSeqNrOfPeer(m_ownPeerId);
+    for (ITxSocket const *pTxSocket : m_txSockets)
+    {
+        peerId_t peerId = pTxSocket->getPeerId();
+        if ((peerId == m_ownPeerId) || isSuspected(peerId))
         {
-            m_pApp->log(IApp::LOG_TYPE::ERR, 
-                fmt::format("Failed to send message {} to {}; error code: {}", toString(msg), toString(remoteSockAddr), result.status));
+            continue;
         }
-        else
+
+        auto it = m_peerStatus.find(peerId);
+        if (it == end(m_peerStatus))
+        {
+            return;
+        }
+        if (isSeqNrBefore(it->second, stableEnd))
         {
-            m_pApp->log(IApp::LOG_TYPE::MSG, fmt::format("Sending message {} to {}.", toString(msg), toString(remoteSockAddr)));
+            stableEnd = it->second;
         }
+    }
 
-        system_clock::time_point timeout = now + ACK_TIMEOUT;
-        txState.setTimeout(timeout);
-        txState.setRemainingTxAttempts(remainingTxAttempts - 1);
+    while (!m_unstableMsgs.empty() && isSeqNrBefore(m_unstableMsgs.front().getMsgId().getSeqNr(), stableEnd))
+    {
+        if (m_pWal != nullptr)
+        {
+            checkWalError(m_pWal->logDone(m_unstableMsgs.front().getMsgId()));
+        }
+        accountTxMessageState(m_unstableMsgs.front(), false);
+        m_unstableMsgs.pop_front();
     }
 }
 
-void MiddleWare::processRxMessage(rgc::payload_t const &payload, struct sockaddr_in const &remoteSockAddr, system_clock::time_point const &now)
+payload_t MiddleWare::makeFecParity(MessageId const &msgId, payload_t const &frame)
 {
-    ITxSocket *txSocket = getTxSocketForRemoteAddress(remoteSockAddr);
+    if (m_config.fecBlockSize == 0)
+    {
+        return payload_t();
+    }
 
-    if (txSocket == nullptr)
+    // Blocks start at the multiples of the block size, so that the receivers know their bounds
+    seqNr_t seqNr = msgId.getSeqNr();
+    if (seqNr % m_config.fecBlockSize == 0)
     {
-        m_pApp->log(IApp::LOG_TYPE::WARN, fmt::format("Discarding rx message: Unknown IP/Port: {}.", toString(remoteSockAddr)));
-        return;
+        m_fecXor.clear();
+        m_fecXorSize = 0;
+        m_fecNumXored = 0;
     }
 
-    // Truncated frame, discard
-    if (payload.size() < MSG_ID_SIZE + CRC_SIZE)
+    payload_t fecFrame = getFecFrame(frame, getEpoch(seqNr));
+    if (m_fecXor.size() < fecFrame.size())
     {
-        m_pApp->log(IApp::LOG_TYPE::WARN, "Discarding rx message: Truncated.");
-        return;
+        m_fecXor.resize(fecFrame.size(), 0);
+    }
+    for (size_t i = 0; i < fecFrame.size(); i++)
+    {
+        m_fecXor[i] ^= fecFrame[i];
     }
+    m_fecXorSize ^= static_cast<uint16_t>(fecFrame.size());
+    m_fecNumXored++;
 
-    // Checksum error, discard
-    if (!verifyChecksum(payload.data(), payload.size()))
+    // A block started by a previous process is incomplete
+    if ((seqNr % m_config.fecBlockSize != m_config.fecBlockSize - 1u) || (m_fecNumXored != m_config.fecBlockSize))
     {
-        m_pApp->log(IApp::LOG_TYPE::WARN, "Discarding rx message: Checksum error.");
-        return;
+        return payload_t();
     }
 
-    peerId_t peerId = (payload[0] << 8) + payload[1];
-    if (!isPeerSupported(peerId))
+    seqNr_t blockStart = seqNr - (m_config.fecBlockSize - 1u);
+    payload_t ret = { CONTROL_PEER_ID >> 8, CONTROL_PEER_ID & 0xff, static_cast<uint8_t>(ControlType::FEC_PARITY) };
+    ret.reserve(CONTROL_HEADER_SIZE + FEC_PARITY_HEADER_SIZE + m_fecXor.size() + m_checksumSize);
+    appendSeqNrEntry(ret, m_ownPeerId, blockStart);
+    ret.push_back(m_config.fecBlockSize);
+    ret.push_back(m_fecXorSize >> 8);
+    ret.push_back(m_fecXorSize & 0xff);
+    ret.insert(end(ret), begin(m_fecXor), end(m_fecXor));
+    appendChecksum(m_config.checksumType, ret);
+
+    if (ret.size() > BUFFER_SIZE)
+    {
+        m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("No parity for block at {}: Frames too large.", toString(MessageId(m_ownPeerId, blockStart))));
+        return payload_t();
+    }
+    return ret;
+}
+
+void MiddleWare::recordFecFrame(MessageId const &msgId, payload_t const &frame, system_clock::time_point const &now)
+{
+    peerId_t originPeerId = msgId.getPeerId();
+    seqNr_t seqNr = msgId.getSeqNr();
+    if (!m_fecFrames.emplace(std::make_pair(originPeerId, seqNr), frame).second)
     {
-        m_pApp->log(IApp::LOG_TYPE::WARN, fmt::format("Discarding rx message: Unknown peer id: {}", peerId));
         return;
     }
 
-    bool isAckMessage = (payload.size() == MSG_ID_SIZE + CRC_SIZE);
+    trimFecState(originPeerId, seqNr);
+    tryFecRecovery(originPeerId, seqNr - seqNr % m_config.fecBlockSize, now);
+}
 
-    if (isAckMessage)
+void MiddleWare::processRxFecParity(payload_t const &payload, system_clock::time_point const &now)
+{
+    if ((m_config.fecBlockSize == 0) || (payload.size() < CONTROL_HEADER_SIZE + FEC_PARITY_HEADER_SIZE + m_checksumSize))
     {
-        processRxAckMessage(payload, peerId, remoteSockAddr);
+        return;
     }
-    else
+
+    peerId_t originPeerId = (payload[CONTROL_HEADER_SIZE] << 8) + payload[CONTROL_HEADER_SIZE + 1];
+    seqNr_t blockStart = readSeqNr(&payload[CONTROL_HEADER_SIZE + 2]);
+    if ((originPeerId == m_ownPeerId) || !isPeerSupported(originPeerId))
     {
-        processRxDataMessage(payload, peerId, txSocket, now);
+        return;
     }
+
+    m_fecParities[{ originPeerId, blockStart }] = payload;
+    trimFecState(originPeerId, blockStart);
+    tryFecRecovery(originPeerId, blockStart, now);
 }
 
-void MiddleWare::processRxAckMessage(rgc::payload_t const &payload, peerId_t peerId, struct sockaddr_in const &remoteSockAddr)
+void MiddleWare::tryFecRecovery(peerId_t originPeerId, seqNr_t blockStart, system_clock::time_point const &now)
 {
-    seqNr_t seqNr = (payload[2] << 8) + payload[3];
-    MessageId msgId = MessageId(peerId, seqNr);
-    TxMessageState *txMsgState = findTxMsgState(msgId);
+    auto itParity = m_fecParities.find({ originPeerId, blockStart });
+    if (itParity == end(m_fecParities))
+    {
+        return;
+    }
 
-    if (txMsgState != nullptr)
+    payload_t const &parity = itParity->second;
+    uint8_t blockSize = parity[CONTROL_HEADER_SIZE + 6];
+    size_t numMissing = 0;
+    seqNr_t missingSeqNr = 0;
+    for (seqNr_t i = 0; i < blockSize; i++)
     {
-        // Message found, check content
-        TxState *txState = txMsgState->findTxState(remoteSockAddr);
-        if (txState != nullptr)
+        if (m_fecFrames.count({ originPeerId, blockStart + i }) == 0)
         {
-            txState->setAcknowledged();
-            m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Received ACK for sent message {} from {}.", toString(payload), toString(remoteSockAddr)));
+            numMissing++;
+            missingSeqNr = blockStart + i;
         }
     }
-}
 
-void MiddleWare::processRxDataMessage(rgc::payload_t const &payload, peerId_t peerId, ITxSocket *txSocket, system_clock::time_point const &now)
-{
-    // Send back an ACK in any case, even if we already delivered that message to the app
-    struct sockaddr_in const &remoteSockAddr = txSocket->getRemoteSocketAddr();
-    TransmitStatus txStatus = txSocket->send(makeAckMessage(payload));
-    if (txStatus.status != 0)
+    // With more than one message missing, wait for the retransmissions
+    if (numMissing > 1)
     {
-        m_pApp->log(IApp::LOG_TYPE::ERR, 
-            fmt::format("Failed to send ACK for message: {} from {}; error code: {}.", toString(payload), toString(remoteSockAddr), txStatus.status));
+        return;
     }
 
-    seqNr_t seqNr = (payload[2] << 8) + payload[3];
+    payload_t frame;
+    std::vector<payload_t const *> others;
+    if (numMissing == 1)
+    {
+        // XOR of the parity and all other frames of the block is the missing frame
+        uint16_t frameSize = (parity[CONTROL_HEADER_SIZE + 7] << 8) + parity[CONTROL_HEADER_SIZE + 8];
+        frame.assign(begin(parity) + CONTROL_HEADER_SIZE + FEC_PARITY_HEADER_SIZE, end(parity) - m_checksumSize);
+        for (seqNr_t i = 0; i < blockSize; i++)
+        {
+            auto itFrame = m_fecFrames.find({ originPeerId, blockStart + i });
+            if (itFrame != end(m_fecFrames))
+            {
+                others.push_back(&itFrame->second);
+                payload_t other = getFecFrame(itFrame->second, getEpoch(blockStart + i));
+                frameSize ^= static_cast<uint16_t>(other.size());
+                for (size_t j = 0; (j < other.size()) && (j < frame.size()); j++)
+                {
+                    frame[j] ^= other[j];
+                }
+            }
+        }
+        frame.resize(std::min(static_cast<size_t>(frameSize), frame.size()));
+    }
+    m_fecParities.erase(itParity);
 
-    if (!isSeqNrOfPeerAccepted(peerId, seqNr))
+    ITxSocket *pTxSocket = findTxSocket(originPeerId);
+    if ((numMissing == 0) || (pTxSocket == nullptr) ||
+        (isSeqNrBefore(missingSeqNr, getAcceptedSeqNrOfPeer(originPeerId)) && !isFecSkipped(originPeerId, missingSeqNr)) ||
+        (frame.size() < MSG_ID_SIZE + m_checksumSize) ||
+        !verifyChecksum(m_config.checksumType, frame.data(), frame.size(), getEpoch(missingSeqNr)))
     {
-        m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Discarding message due to SeqNr: {} from {}.", toString(payload), toString(remoteSockAddr)));
         return;
     }
 
-    MessageId msgId = MessageId(peerId, seqNr);
-    TxMessageState *txMsgState = findTxMsgState(msgId);
-
-    if (txMsgState == nullptr)
+    if (m_config.priorityLanes && (frame.size() >= m_headerSize + m_checksumSize))
     {
-        // No such message found in the state, set up anew
-        m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Received data message {} from {}.", toString(payload), toString(remoteSockAddr)));
-        m_txMessageStates.emplace_back(msgId, m_txSockets, payload, now);
-        setAcceptedSeqNrOfPeer(peerId, seqNr + 1);
+        // The rebuilt frame gets the time to live of the first frame of its block in the same lane
+        auto itOther = std::find_if(begin(others), end(others),
+            [this, &frame](auto const *pOther) { return (getFramePriority(*pOther) == getFramePriority(frame)); });
+        if (itOther != end(others))
+        {
+            setFrameTtl(frame, getFrameTtl(**itOther), getEpoch(missingSeqNr));
+        }
     }
-    else
+
+    // Processed as if the origin had sent it, i.e. the origin gets the ACK at once
+    m_usage.numFecRecovered++;
+    m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Rebuilt message {} from parity.", toString(MessageId(originPeerId, missingSeqNr))));
+    m_fecFrames.emplace(std::make_pair(originPeerId, missingSeqNr), frame);
+    processRxDataMessage(frame, originPeerId, pTxSocket, now, true);
+}
+
+void MiddleWare::trimFecState(peerId_t originPeerId, seqNr_t seqNr)
+{
+    seqNr_t const keptSeqNrs = FEC_BLOCKS_KEPT * m_config.fecBlockSize;
+    if (seqNr < keptSeqNrs)
     {
-        // We have received that message already, ignore it here
-        m_pApp->log(IApp::LOG_TYPE::DEBUG, fmt::format("Discarding already received message {} from {}.", toString(payload), toString(remoteSockAddr)));
+        return;
     }
+
+    // Whole blocks only, otherwise the trimmed frames of a block would look missing to its parity
+    seqNr_t cut = seqNr - keptSeqNrs;
+    cut -= cut % m_config.fecBlockSize;
+    m_fecFrames.erase(m_fecFrames.lower_bound({ originPeerId, 0 }), m_fecFrames.lower_bound({ originPeerId, cut }));
+    m_fecParities.erase(m_fecParities.lower_bound({ originPeerId, 0 }), m_fecParities.lower_bound({ originPeerId, cut }));
+    m_fecSkipped.erase(m_fecSkipped.lower_bound({ originPeerId, 0 }), m_fecSkipped.lower_bound({ originPeerId, cut }));
 }
 
-payload_t MiddleWare::makeAckMessage(payload_t const &dataMessage) const
+bool MiddleWare::isFecSkipped(peerId_t originPeerId, seqNr_t seqNr) const
 {
-    // Peer-Id
-    payload_t ret(begin(dataMessage), begin(dataMessage) + sizeof(peerId_t) + sizeof(seqNr_t));
-    checksum_t checksum = rfc1071Checksum(ret.data(), ret.size());
-    ret.push_back(checksum >> 8);
-    ret.push_back(checksum & 0xff);
-    return ret;
+    return (m_fecSkipped.count({ originPeerId, seqNr }) > 0);
 }
 
 bool MiddleWare::isPeerSupported(peerId_t peerId) const
@@ -290,16 +2049,36 @@ bool MiddleWare::isSeqNrOfPeerAccepted(peerId_t peerId, seqNr_t seqNr) const
 
     if (it != end(m_nextSeqNrs))
     {
-        auto diff = (it->nextSeqNr <= seqNr) ?
-            seqNr - it->nextSeqNr : 
-            seqNr + (1 << (sizeof(seqNr_t) * 8)) - it->nextSeqNr;
-
-        ret = (diff < 10);
+        // unsigned arithmetic takes care of the wrap-around of the extended sequence number
+        seqNr_t diff = seqNr - it->nextSeqNr;
+        ret = (diff < ((m_config.reliability == Reliability::NACK) ? NACK_SEQ_NR_WINDOW : SEQ_NR_WINDOW));
     }
 
     return ret;
 }
 
+seqNr_t MiddleWare::getAcceptedSeqNrOfPeer(peerId_t peerId) const
+{
+    auto it = std::find_if(begin(m_nextSeqNrs), end(m_nextSeqNrs),
+        [&peerId](auto const &nsn) { return (nsn.peerId == peerId); });
+
+    if (it != end(m_nextSeqNrs))
+    {
+        return it->nextSeqNr;
+    }
+
+    // Without sending to ourselves, our own messages are only referenced by ACKs
+    return (peerId == m_ownPeerId) ? m_nextSeqNr : 0;
+}
+
+seqNr_t MiddleWare::extendSeqNr(seqNr_t reference, wireSeqNr_t wireSeqNr)
+{
+    // The extended sequence number is the one closest to the reference whose lower bits match the wire
+    // sequence number, i.e. it is located in [reference - 2^15, reference + 2^15)
+    int16_t delta = static_cast<int16_t>(static_cast<wireSeqNr_t>(wireSeqNr - static_cast<wireSeqNr_t>(reference)));
+    return reference + static_cast<seqNr_t>(static_cast<int32_t>(delta));
+}
+
 void MiddleWare::setAcceptedSeqNrOfPeer(peerId_t peerId, seqNr_t seqNr)
 {
     auto it = std::find_if(begin(m_nextSeqNrs), end(m_nextSeqNrs),
@@ -308,6 +2087,34 @@ void MiddleWare::setAcceptedSeqNrOfPeer(peerId_t peerId, seqNr_t seqNr)
     if (it != end(m_nextSeqNrs))
     {
         it->nextSeqNr = seqNr;
+        it->isSynced = true;
+    }
+}
+
+void MiddleWare::syncSeqNrOfPeer(peerId_t peerId, seqNr_t seqNr)
+{
+    auto it = std::find_if(begin(m_nextSeqNrs), end(m_nextSeqNrs),
+        [&peerId](auto const &nsn) { return (nsn.peerId == peerId); });
+
+    if ((it == end(m_nextSeqNrs)) || it->isSynced)
+    {
+        return;
+    }
+
+    it->isSynced = true;
+    if (isSeqNrOfPeerAccepted(peerId, seqNr))
+    {
+        return;
+    }
+
+    // Otherwise we would acknowledge and discard all its messages; earlier ones were sent before we knew each other
+    m_pApp->log(IApp::LOG_TYPE::MSG, fmt::format("Peer {} starts at sequence number {}.", peerId, seqNr));
+    it->nextSeqNr = seqNr;
+    auto itStream = m_rxStreams.find(peerId);
+    if (itStream != end(m_rxStreams))
+    {
+        itStream->second.knownEnd = seqNr;
+        itStream->second.pending.clear();
     }
 }
 
@@ -323,7 +2130,20 @@ std::string MiddleWare::toString(rgc::MessageId const &msgId)
     return fmt::format("[{},{}]", msgId.getPeerId(), msgId.getSeqNr());
 }
 
-std::string MiddleWare::toString(rgc::payload_t const &payload)
+std::string MiddleWare::toString(rgc::delivery_t const &delivery, ChecksumType checksumType)
+{
+    // Rebuild the frame layout so that deliveries are logged like received messages
+    payload_t payload(MSG_ID_SIZE, 0);
+    payload[0] = delivery.msgId.getPeerId() >> 8;
+    payload[1] = delivery.msgId.getPeerId() & 0xff;
+    payload[2] = (delivery.msgId.getSeqNr() >> 8) & 0xff;
+    payload[3] = delivery.msgId.getSeqNr() & 0xff;
+    payload.insert(end(payload), delivery.data, delivery.data + delivery.size);
+    appendChecksum(checksumType, payload, getEpoch(delivery.msgId.getSeqNr()));
+    return toString(payload, getChecksumSize(checksumType));
+}
+
+std::string MiddleWare::toString(rgc::payload_t const &payload, size_t checksumSize, size_t headerSize)
 {
     stringstream ss;
 
@@ -335,10 +2155,10 @@ std::string MiddleWare::toString(rgc::payload_t const &payload)
     }
 
     // We have got data
-    if (payload.size() > MSG_ID_SIZE + CRC_SIZE)
+    if (payload.size() > headerSize + checksumSize)
     {
-        auto itStart = begin(payload) + MSG_ID_SIZE;
-        auto itEnd = end(payload) - CRC_SIZE;
+        auto itStart = begin(payload) + headerSize;
+        auto itEnd = end(payload) - checksumSize;
 
         bool isPrintable = std::accumulate(itStart, itEnd, true, [](bool a, auto const &el) { return (a && (std::isprint(el))); });
         ss << "[";
@@ -357,36 +2177,82 @@ std::string MiddleWare::toString(rgc::payload_t const &payload)
         ss << "]";
     }
 
-    if (payload.size() >= MSG_ID_SIZE + CRC_SIZE)
+    if (payload.size() >= MSG_ID_SIZE + checksumSize)
     {
-        uint8_t const *pCRC = &(payload.data()[payload.size() - 2]);
-        ss << fmt::format("[0x{:04x}]", (pCRC[0] << 8) + pCRC[1]);
+        ss << "[0x";
+        for (auto it = end(payload) - checksumSize; it < end(payload); it++)
+        {
+            ss << fmt::format("{:02x}", *it);
+        }
+        ss << "]";
     }
     return ss.str();
 }
 
 
-bool MiddleWare::verifyChecksum(uint8_t const *pl, size_t size)
+bool MiddleWare::verifyChecksum(uint8_t const *pl, size_t size, epoch_t epoch)
 {
     checksum_t plChecksum = (pl[size - 2] << 8) + pl[size - 1];
-    checksum_t sum = checksumMethod(pl, size - 2) + plChecksum;
+    checksum_t sum = checksumMethod(pl, size - 2, epoch) + plChecksum;
 
     // If all 1s, checksum is valid
     return (sum == 0xFFFF); 
 }
 
-checksum_t MiddleWare::rfc1071Checksum(uint8_t const *pl, size_t size)
+bool MiddleWare::verifyChecksum(ChecksumType type, uint8_t const *pl, size_t size, epoch_t epoch)
+{
+    switch (type)
+    {
+        case ChecksumType::CRC32C:
+        {
+            uint32_t plChecksum = (static_cast<uint32_t>(pl[size - 4]) << 24) + (pl[size - 3] << 16) + (pl[size - 2] << 8) + pl[size - 1];
+            return (crc32cChecksum(pl, size - 4, epoch) == plChecksum);
+        }
+        case ChecksumType::RFC1071:
+        default:
+            return verifyChecksum(pl, size, epoch);
+    }
+}
+
+void MiddleWare::appendChecksum(ChecksumType type, payload_t &frame, epoch_t epoch)
+{
+    if (type == ChecksumType::CRC32C)
+    {
+        uint32_t checksum = crc32cChecksum(frame.data(), frame.size(), epoch);
+        frame.push_back(checksum >> 24);
+        frame.push_back((checksum >> 16) & 0xff);
+        frame.push_back((checksum >> 8) & 0xff);
+        frame.push_back(checksum & 0xff);
+    }
+    else
+    {
+        checksum_t checksum = rfc1071Checksum(frame.data(), frame.size(), epoch);
+        frame.push_back(checksum >> 8);
+        frame.push_back(checksum & 0xff);
+    }
+}
+
+uint32_t MiddleWare::crc32cChecksum(uint8_t const *pl, size_t size, epoch_t epoch)
+{
+    // The epoch precedes the frame like an additional 16-bit word
+    uint8_t const epochBytes[] = { static_cast<uint8_t>(epoch >> 8), static_cast<uint8_t>(epoch & 0xff) };
+    return crc32c(pl, size, crc32c(epochBytes, sizeof(epochBytes)));
+}
+
+checksum_t MiddleWare::rfc1071Checksum(uint8_t const *pl, size_t size, epoch_t epoch)
 {
-    checksum_t sum = checksumMethod(pl, size);
+    checksum_t sum = checksumMethod(pl, size, epoch);
 
     // Return the one's complement of the sum
     return static_cast<checksum_t>(~sum);
 }
 
 
-checksum_t MiddleWare::checksumMethod(uint8_t const *pl, size_t size)
+checksum_t MiddleWare::checksumMethod(uint8_t const *pl, size_t size, epoch_t epoch)
 {
-    uint32_t sum = 0;
+    // The epoch is summed up like an additional 16-bit word of the frame. For epoch 0 the
+    // checksum is the same as the one of a frame without extended sequence numbers
+    uint32_t sum = epoch;
 
     // Process 16-bit words
     while (size > 1) 
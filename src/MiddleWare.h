@@ -2,6 +2,11 @@
 #include <numeric>
 #include <vector>
 #include <list>
+#include <map>
+#include <set>
+#include <deque>
+#include <random>
+#include <unordered_map>
 #include <optional>
 #include <chrono>
 #include <algorithm>
@@ -12,11 +17,52 @@
 
 #include "ISocket.h"
 #include "IApp.h"
+#include "TokenBucket.h"
+#include "WriteAheadLog.h"
 
 namespace rgc {
 
 static constexpr uint8_t MAX_TX_ATTEMPTS = 4;
 
+// Frames with this peer id in the header carry control information instead of a message
+static constexpr peerId_t CONTROL_PEER_ID = 0xffff;
+
+// 2 Bytes Peer-Id, 2 Bytes Sequence Number
+static constexpr size_t MSG_ID_SIZE = 4;
+
+// With compression or priority lanes enabled, data frames carry a flags byte after the Sequence Number. A deflated
+// frame continues with the 4 Bytes size of the inflated message and the zlib stream.
+static constexpr uint8_t FRAME_FLAG_DEFLATED = 0x01;
+static constexpr size_t INFLATED_SIZE_BYTES = 4;
+// With priority lanes, bits 1..2 of the flags byte hold the Priority, followed by the 2 Bytes time to live in
+// milliseconds, 0 if the message does not expire
+static constexpr uint8_t FRAME_PRIORITY_SHIFT = 1;
+static constexpr uint8_t FRAME_PRIORITY_MASK = 0x06;
+static constexpr size_t TTL_SIZE_BYTES = 2;
+static constexpr std::chrono::milliseconds MAX_MESSAGE_TTL = std::chrono::milliseconds(UINT16_MAX);
+
+// Control frame: 2 Bytes CONTROL_PEER_ID, 1 Byte ControlType, type specific content, 2 Bytes checksum
+enum class ControlType : uint8_t
+{
+    DIGEST = 1,    // per origin: 2 Bytes Peer-Id, 4 Bytes next expected extended sequence number
+    HEARTBEAT = 2, // no content
+    // NACK mode, per origin: 2 Bytes Peer-Id, 4 Bytes next expected extended sequence number. Carries the sender's own
+    // next sequence number and the one it expects from the receiver.
+    STATUS = 3,
+    STATUS_REQUEST = 4, // like STATUS, the receiver answers with a STATUS in its next status round
+    NACK = 5,           // per range: 2 Bytes Peer-Id, 4 Bytes first missing extended sequence number, 2 Bytes count
+    // 2 Bytes Peer-Id of the origin, 4 Bytes extended sequence number of the first message of the block, 1 Byte number
+    // of messages, 2 Bytes XOR of the frame sizes, XOR of the data frames of the block, each padded with zeros
+    FEC_PARITY = 6,
+};
+
+enum class SendStatus : uint8_t
+{
+    OK,
+    WOULD_BLOCK, // the in-flight budget is exhausted, try again later
+    TOO_LARGE    // the frame would exceed BUFFER_SIZE, even if deflated; the message is not sent
+};
+
 class MiddleWare;
 
 // Represents the state of an outgoing message w.r.t. one specific sender
@@ -25,6 +71,8 @@ class TxState final
 public:
     explicit TxState(rgc::ITxSocket *pTxSocket, std::chrono::system_clock::time_point now) : 
         m_timeout(now),
+        m_lastTxTime(),
+        m_pacedSince(),
         m_pTxSocket(pTxSocket), 
         m_remainingTxAttempts(MAX_TX_ATTEMPTS), 
         m_txAcknowledged(false),
@@ -56,6 +104,11 @@ public:
         return m_txToSelfFailed;
     }
 
+    std::chrono::system_clock::time_point getTimeout() const
+    {
+        return m_timeout;
+    }
+
     bool isTimeoutElapsed(std::chrono::system_clock::time_point now) const
     {
         bool ret = (m_timeout <= now);
@@ -77,13 +130,37 @@ public:
         return m_remainingTxAttempts;
     }
 
+    // Time of the last transmission, the reference for the round trip time
+    std::chrono::system_clock::time_point getLastTxTime() const
+    {
+        return m_lastTxTime;
+    }
+
+    void setLastTxTime(std::chrono::system_clock::time_point txTime)
+    {
+        m_lastTxTime = txTime;
+    }
+
     void setRemainingTxAttempts(uint8_t remainingTxAttempts)
     {
         m_remainingTxAttempts = remainingTxAttempts;
     }
 
+    // Time the transmission was due before pacing deferred it, nothing if it was not deferred
+    std::optional<std::chrono::system_clock::time_point> const &getPacedSince() const
+    {
+        return m_pacedSince;
+    }
+
+    void setPacedSince(std::optional<std::chrono::system_clock::time_point> pacedSince)
+    {
+        m_pacedSince = pacedSince;
+    }
+
 private:
     std::chrono::system_clock::time_point m_timeout;
+    std::chrono::system_clock::time_point m_lastTxTime;
+    std::optional<std::chrono::system_clock::time_point> m_pacedSince;
     rgc::ITxSocket *m_pTxSocket;
     uint8_t m_remainingTxAttempts;
     bool m_txAcknowledged;
@@ -94,9 +171,11 @@ private:
 class TxMessageState final
 {
 public:
-    TxMessageState(MessageId msgId, std::vector<ITxSocket *> const &txSockets, rgc::payload_t const &payload, std::chrono::system_clock::time_point now) :
+    TxMessageState(MessageId msgId, std::vector<ITxSocket *> const &txSockets, rgc::payload_t payload, std::chrono::system_clock::time_point now) :
         m_msgId(msgId),
-        m_payload(payload)
+        m_payload(std::move(payload)),
+        m_priority(Priority::NORMAL),
+        m_expiry(std::chrono::system_clock::time_point::max())
     {
         std::chrono::system_clock::time_point sendTime = now;
         std::chrono::duration<int64_t, std::milli> tx_client_delay = std::chrono::milliseconds(1000);
@@ -150,35 +229,143 @@ public:
             });
     }
 
+    void removeTxStates(peerId_t peerId)
+    {
+        m_txStates.erase(std::remove_if(begin(m_txStates), end(m_txStates),
+            [peerId](auto const &txState) { return (txState.getSocket()->getPeerId() == peerId); }), end(m_txStates));
+    }
+
+    bool isNothingSent() const
+    {
+        return std::none_of(std::begin(m_txStates), std::end(m_txStates), [](auto const &e) { return e.alreadySent(); });
+    }
+
     rgc::payload_t const &getPayload() const
     {
         return m_payload;
     }
 
+    rgc::payload_t &getPayload()
+    {
+        return m_payload;
+    }
+
+    // Message of a deflated frame, inflated once when the state is set up; empty for other frames
+    rgc::payload_t const &getInflatedMessage() const
+    {
+        return m_inflatedMessage;
+    }
+
+    void setInflatedMessage(rgc::payload_t inflatedMessage)
+    {
+        m_inflatedMessage = std::move(inflatedMessage);
+    }
+
+    // Parity frame of the block this message completes, sent along with its first transmission; empty for other messages
+    rgc::payload_t const &getFecParity() const
+    {
+        return m_fecParity;
+    }
+
+    void setFecParity(rgc::payload_t fecParity)
+    {
+        m_fecParity = std::move(fecParity);
+    }
+
+    Priority getPriority() const
+    {
+        return m_priority;
+    }
+
+    void setPriority(Priority priority)
+    {
+        m_priority = priority;
+    }
+
+    // The message is dropped instead of retransmitted from then on; the max. time point if it does not expire
+    std::chrono::system_clock::time_point getExpiry() const
+    {
+        return m_expiry;
+    }
+
+    void setExpiry(std::chrono::system_clock::time_point expiry)
+    {
+        m_expiry = expiry;
+    }
+
+    bool isExpired(std::chrono::system_clock::time_point now) const
+    {
+        return (m_expiry <= now);
+    }
+
     std::vector<TxState> &getTxStates()
     {
         return m_txStates;
     }
 
+    std::vector<TxState> const &getTxStates() const
+    {
+        return m_txStates;
+    }
+
+    // Estimated memory used by a message state, including the list node holding it
+    static size_t estimateStateBytes(size_t payloadSize, size_t numTxStates)
+    {
+        return sizeof(TxMessageState) + 2 * sizeof(void *) + payloadSize + numTxStates * sizeof(TxState);
+    }
+
+    size_t getStateBytes() const
+    {
+        return estimateStateBytes(m_payload.size(), m_txStates.size()) + m_inflatedMessage.size() + m_fecParity.size();
+    }
+
 private:
     MessageId m_msgId;
     rgc::payload_t m_payload;
+    rgc::payload_t m_inflatedMessage;
+    rgc::payload_t m_fecParity;
+    Priority m_priority;
+    std::chrono::system_clock::time_point m_expiry;
     std::vector<TxState> m_txStates;
 };
 
 class MiddleWare final
 {
 public:
-    MiddleWare(rgc::IApp *pApp, peerId_t ownPeerId, rgc::IRxSocket *pRxSocket, std::vector<ITxSocket *> &txSockets, std::optional<bitflip_t> bitFlipInfo) : 
+    MiddleWare(rgc::IApp *pApp, peerId_t ownPeerId, rgc::IRxSocket *pRxSocket, std::vector<ITxSocket *> &txSockets, std::optional<bitflip_t> bitFlipInfo, mwConfig_t const &mwConfig = mwConfig_t()) : 
         m_pApp(pApp),
         m_ownPeerId(ownPeerId),
         m_nextSeqNr(0),
         m_pRxSocket(pRxSocket),
-        m_txSockets(txSockets)
+        m_txSockets(txSockets),
+        m_pMcastRxSocket(nullptr),
+        m_pMcastTxSocket(nullptr),
+        m_pWal(nullptr),
+        m_isHoldingTx(false),
+        m_config(mwConfig),
+        m_checksumSize(getChecksumSize(mwConfig.checksumType)),
+        m_headerSize(MSG_ID_SIZE + (((mwConfig.compressionThresholdBytes > 0) || mwConfig.priorityLanes) ? 1 : 0) +
+            (mwConfig.priorityLanes ? TTL_SIZE_BYTES : 0)),
+        m_rng(std::random_device()()),
+        m_nextAntiEntropy(),
+        m_usage{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+        m_rxQueueDrops(0),
+        m_mcastRxQueueDrops(0),
+        m_nextHeartbeat(),
+        m_numSuspected(0),
+        m_nextStatus(),
+        m_fecXorSize(0),
+        m_fecNumXored(0),
+        m_pacer(mwConfig.paceBytesPerSec, mwConfig.pacePacketsPerSec, mwConfig.paceBurst),
+        m_nextPacedStreamFrame(std::chrono::system_clock::time_point::max())
     {
         for (auto const &txSocket : txSockets)
         {
-            m_nextSeqNrs.push_back({txSocket->getPeerId(), 0});
+            m_nextSeqNrs.push_back({txSocket->getPeerId(), 0, (txSocket->getPeerId() == ownPeerId)});
+            if (txSocket->getPeerId() != ownPeerId)
+            {
+                m_peerLiveness.push_back({txSocket->getPeerId(), std::nullopt, false});
+            }
         }
 
         if (bitFlipInfo.has_value())
@@ -187,40 +374,235 @@ public:
         }
     }
 
-    void rxTxLoop(std::chrono::system_clock::time_point const &now);
-    void sendMessage(std::string const &message, std::chrono::system_clock::time_point const &now);
+    // Returns the number of received datagrams
+    size_t rxTxLoop(std::chrono::system_clock::time_point const &now);
+    // A message with a time to live is dropped once it elapsed, at most MAX_MESSAGE_TTL; 0 means it does not expire.
+    // Both only apply in ACK mode; relays honor them with priority lanes enabled.
+    SendStatus sendMessage(uint8_t const *message, size_t size, std::chrono::system_clock::time_point const &now,
+        Priority priority = Priority::NORMAL, std::chrono::milliseconds ttl = std::chrono::milliseconds(0));
+    SendStatus sendMessage(std::string const &message, std::chrono::system_clock::time_point const &now,
+        Priority priority = Priority::NORMAL, std::chrono::milliseconds ttl = std::chrono::milliseconds(0))
+    {
+        return sendMessage(reinterpret_cast<uint8_t const *>(message.data()), message.size(), now, priority, ttl);
+    }
+
+    // Point in time at which rxTxLoop() has to be called at the latest, unless something is received before
+    std::chrono::system_clock::time_point getNextTimeout() const;
     void addBitFlipInfo(bitflip_t const &bf)
     {
         m_bitFlipInfos.push_back(bf);
     }
 
-    static bool verifyChecksum(uint8_t const *pl, size_t size);
-    static checksum_t rfc1071Checksum(uint8_t const *pl, size_t size);
-    static checksum_t checksumMethod(uint8_t const *pl, size_t size);
+    // The first transmission of each message goes to the multicast group, retransmissions are sent via unicast
+    void setMulticastSockets(rgc::IRxSocket *pMcastRxSocket, ITxSocket *pMcastTxSocket)
+    {
+        m_pMcastRxSocket = pMcastRxSocket;
+        m_pMcastTxSocket = pMcastTxSocket;
+    }
+
+    // Resumes the in-flight messages and watermarks of a previous process, before setWriteAheadLog(). Returns the
+    // number of resumed messages, which are retransmitted to all peers.
+    size_t restore(walState_t const &state, std::chrono::system_clock::time_point const &now);
+    // Logs all changes of the in-flight messages and watermarks from now on, starting with a snapshot of them.
+    // Returns 0 or the errno of writing the snapshot.
+    int setWriteAheadLog(WriteAheadLog *pWal);
+
+    // Random decisions (gossip targets, simulated tx loss) become reproducible, e.g. in simulations
+    void seedRandom(uint32_t seed)
+    {
+        m_rng.seed(seed);
+    }
+
+    // Membership changes at runtime. A joining peer only takes part in messages sent or received from now on.
+    // The socket of a departing peer may be destroyed after removePeer(), in-flight messages stop waiting for it.
+    void addPeer(ITxSocket *pTxSocket);
+    void removePeer(peerId_t peerId);
+
+    // In NACK mode, the own messages which are not stable yet
+    size_t getNumPendingTxMessages() const
+    {
+        return m_txMessageStates.size() + m_unstableMsgs.size();
+    }
+
+    mwUsage_t getUsage() const;
+    // Nothing before the first ACK of a message which was sent once
+    std::optional<rttStats_t> getRtt(peerId_t peerId) const;
+
+    // The epoch of a sequence number is never transmitted, but covered by the checksum of the frame
+    static bool verifyChecksum(uint8_t const *pl, size_t size, epoch_t epoch = 0);
+    static checksum_t rfc1071Checksum(uint8_t const *pl, size_t size, epoch_t epoch = 0);
+    static checksum_t checksumMethod(uint8_t const *pl, size_t size, epoch_t epoch = 0);
+    // Frames carrying the checksum trailer of the given type
+    static bool verifyChecksum(ChecksumType type, uint8_t const *pl, size_t size, epoch_t epoch = 0);
+    static void appendChecksum(ChecksumType type, rgc::payload_t &frame, epoch_t epoch = 0);
+    static uint32_t crc32cChecksum(uint8_t const *pl, size_t size, epoch_t epoch = 0);
+
+    static size_t getChecksumSize(ChecksumType type)
+    {
+        return (type == ChecksumType::CRC32C) ? sizeof(uint32_t) : sizeof(checksum_t);
+    }
+
+    static epoch_t getEpoch(seqNr_t seqNr)
+    {
+        return static_cast<epoch_t>(seqNr >> (sizeof(wireSeqNr_t) * 8));
+    }
+
+    static seqNr_t extendSeqNr(seqNr_t reference, wireSeqNr_t wireSeqNr);
 
     static std::string toString(struct sockaddr_in const &sockAddr);
-    static std::string toString(rgc::payload_t const &payload);
+    static std::string toString(rgc::payload_t const &payload, size_t checksumSize = sizeof(checksum_t), size_t headerSize = MSG_ID_SIZE);
     static std::string toString(rgc::MessageId const &msgId);
+    static std::string toString(rgc::delivery_t const &delivery, ChecksumType checksumType = ChecksumType::RFC1071);
 
 private:
     typedef struct
     {
         peerId_t peerId;
         seqNr_t nextSeqNr;
+        bool isSynced; // a message of the peer was accepted, or its sequence number restored
     } nextSeqNr_t;
 
-    void listenRxSocket(std::chrono::system_clock::time_point const &now);
+    // A received message kept for answering anti-entropy digests in gossip mode
+    typedef struct
+    {
+        MessageId msgId;
+        payload_t payload;
+    } retainedMsg_t;
+
+    // Failure detector state of a remote peer
+    typedef struct
+    {
+        peerId_t peerId;
+        std::optional<std::chrono::system_clock::time_point> lastHeard;
+        bool suspected;
+    } peerLiveness_t;
+
+    typedef struct
+    {
+        peerId_t peerId;
+        rttStats_t rtt;
+    } peerRtt_t;
+
+    // NACK mode: received message waiting for its predecessors
+    typedef struct
+    {
+        payload_t payload;
+        payload_t inflatedMessage;
+    } streamMsg_t;
+
+    // NACK mode: messages of an origin peer received out of order
+    typedef struct
+    {
+        seqNr_t knownEnd; // next extended sequence number after the last one known to be sent by the origin
+        std::map<seqNr_t, streamMsg_t> pending;
+    } rxStream_t;
+
+    // NACK mode: transmission waiting for its pacing slot
+    typedef struct
+    {
+        ITxSocket *pTxSocket;
+        payload_t frame;
+        payload_t fecParity;
+        bool isRetransmission;
+        std::chrono::system_clock::time_point dueSince;
+        bool isDeferred; // missed its slot at least once
+    } pacedTx_t;
+
+    size_t listenRxSocket(rgc::IRxSocket *pRxSocket, std::chrono::system_clock::time_point const &now);
     void checkPendingTxMessages(std::chrono::system_clock::time_point const &now);
-    void processTxMessage(TxState &txState, payload_t const &msg, std::chrono::system_clock::time_point const &now);
-    void processRxMessage(rgc::payload_t const &payload, struct sockaddr_in const &remoteSockAddr, std::chrono::system_clock::time_point const &now);
-    void processRxAckMessage(rgc::payload_t const &payload, peerId_t peerId, struct sockaddr_in const &remoteSockAddr);
-    void processRxDataMessage(rgc::payload_t const &payload, peerId_t peerId, ITxSocket *txSocket, std::chrono::system_clock::time_point const &now);
-    rgc::payload_t makeAckMessage(rgc::payload_t const &dataMessage) const;
-    
+    void dropExpiredMessages(std::chrono::system_clock::time_point const &now);
+    void processTxMessage(TxState &txState, payload_t const &msg, payload_t const &fecParity, std::chrono::system_clock::time_point const &now);
+    // All datagrams are sent here, for accounting, pacing and tx loss fault injection. With a write-ahead log, no
+    // datagram leaves before the records appended so far are committed.
+    TransmitStatus sendDatagram(ITxSocket const *pTxSocket, payload_t const &payload);
+    void releaseHeldDatagrams();
+
+    // Egress pacing, datagrams to the peer itself are not paced
+    bool isPaced(ITxSocket const *pTxSocket) const;
+    TokenBucket *getPeerPacer(peerId_t peerId);
+    void refillPacers(std::chrono::system_clock::time_point const &now);
+    // Earliest point in time at which a datagram to the socket conforms to the pacing rates
+    std::chrono::system_clock::time_point getPacingSlot(ITxSocket const *pTxSocket, size_t bytes, std::chrono::system_clock::time_point const &now);
+    // Moves the timeout of a due transmission to its pacing slot if that is later than now. Returns true if deferred.
+    bool deferByPacing(TxState &txState, size_t bytes, std::chrono::system_clock::time_point const &now);
+    void accountPacingDelay(TxState &txState, std::chrono::system_clock::time_point const &now);
+    bool processMcastTxMessage(TxMessageState &txMsgState, std::chrono::system_clock::time_point const &now);
+    // rxTime is the kernel receive timestamp of the datagram if there is one, else now
+    void processRxMessage(rgc::payload_t const &payload, struct sockaddr_in const &remoteSockAddr, std::chrono::system_clock::time_point const &now,
+        std::chrono::system_clock::time_point const &rxTime);
+    void processRxAckMessage(rgc::payload_t const &payload, peerId_t peerId, struct sockaddr_in const &remoteSockAddr,
+        std::chrono::system_clock::time_point const &rxTime);
+    void sampleRtt(peerId_t peerId, std::chrono::nanoseconds rtt);
+    // A message rebuilt from a parity frame is accepted although later ones of its origin were received already
+    void processRxDataMessage(rgc::payload_t const &payload, peerId_t peerId, ITxSocket *txSocket, std::chrono::system_clock::time_point const &now,
+        bool isFecRecovered = false);
+    rgc::payload_t makeAckMessage(rgc::payload_t const &dataMessage, epoch_t epoch) const;
+    void processRxControlMessage(rgc::payload_t const &payload, ITxSocket *txSocket, std::chrono::system_clock::time_point const &now);
+    void sendHeartbeats();
+    void markHeardFrom(peerId_t peerId, std::chrono::system_clock::time_point const &now);
+    void checkLiveness(std::chrono::system_clock::time_point const &now);
+    bool isSuspected(peerId_t peerId) const;
+    std::vector<ITxSocket *> const &getUnsuspectedTxSockets();
+    void processRxDigestMessage(rgc::payload_t const &payload, ITxSocket *txSocket);
+    void sendControlMessage(ITxSocket *pTxSocket, ControlType type, rgc::payload_t const &entries, size_t entrySize, char const *name);
+    ITxSocket *findTxSocket(peerId_t peerId) const;
+
+    // NACK mode
+    void sendStreamMessage(MessageId const &msgId, rgc::payload_t payload, std::chrono::system_clock::time_point const &now,
+        rgc::payload_t inflatedMessage, rgc::payload_t const &fecParity = {});
+    void processRxStreamMessage(rgc::payload_t const &payload, MessageId const &msgId, ITxSocket *txSocket);
+    rxStream_t &getRxStream(peerId_t originPeerId);
+    void deliverStream(peerId_t originPeerId, rxStream_t &stream);
+    void requestMissing(peerId_t originPeerId, rxStream_t const &stream, seqNr_t first);
+    void processRxNackMessage(rgc::payload_t const &payload, ITxSocket *txSocket, std::chrono::system_clock::time_point const &now);
+    // Sends a data frame right away if the socket is not paced, otherwise queues it for releasePacedStreamFrames()
+    void queueStreamFrame(ITxSocket *pTxSocket, rgc::payload_t const &frame, rgc::payload_t const &fecParity, bool isRetransmission,
+        std::chrono::system_clock::time_point const &now);
+    void sendStreamFrame(ITxSocket *pTxSocket, rgc::payload_t const &frame, rgc::payload_t const &fecParity, bool isRetransmission,
+        std::chrono::system_clock::time_point const &now);
+    // Sends the queued frames whose slot has come, in their order per socket
+    void releasePacedStreamFrames(std::chrono::system_clock::time_point const &now);
+    void processRxStatusMessage(rgc::payload_t const &payload, ITxSocket *txSocket, bool isRequest);
+    void markStatusDue(peerId_t peerId);
+    void runStatusRound();
+    void releaseStableMessages();
+
+    // Forward error correction
+    rgc::payload_t makeFecParity(MessageId const &msgId, rgc::payload_t const &frame);
+    void recordFecFrame(MessageId const &msgId, rgc::payload_t const &frame, std::chrono::system_clock::time_point const &now);
+    void processRxFecParity(rgc::payload_t const &payload, std::chrono::system_clock::time_point const &now);
+    void tryFecRecovery(peerId_t originPeerId, seqNr_t blockStart, std::chrono::system_clock::time_point const &now);
+    void trimFecState(peerId_t originPeerId, seqNr_t seqNr);
+    bool isFecSkipped(peerId_t originPeerId, seqNr_t seqNr) const;
+
+    void addTxMessageState(MessageId const &msgId, rgc::payload_t payload, ITxSocket const *pReceivedFrom, std::chrono::system_clock::time_point const &now,
+        rgc::payload_t inflatedMessage = {}, rgc::payload_t fecParity = {}, Priority priority = Priority::NORMAL,
+        std::chrono::milliseconds ttl = std::chrono::milliseconds(0));
+    Priority getFramePriority(rgc::payload_t const &payload) const;
+    std::chrono::milliseconds getFrameTtl(rgc::payload_t const &payload) const;
+    void setFrameTtl(rgc::payload_t &frame, std::chrono::milliseconds ttl, epoch_t epoch) const;
+    void refreshFrameTtl(TxMessageState &txMsgState, std::chrono::system_clock::time_point const &now) const;
+    rgc::payload_t getFecFrame(rgc::payload_t const &frame, epoch_t epoch) const;
+    bool isDeflatedFrame(rgc::payload_t const &payload) const;
+    std::optional<rgc::payload_t> inflateFrame(rgc::payload_t const &payload) const;
+    delivery_t makeDelivery(TxMessageState const &txMsgState) const;
+    std::vector<ITxSocket *> selectGossipTxSockets(ITxSocket const *pReceivedFrom);
+    void retainMessage(MessageId const &msgId, rgc::payload_t const &payload);
+    // True if the last digest of each live peer except the origin shows it has the message
+    bool isCoveredByDigests(MessageId const &msgId) const;
+    bool isInFlightBudgetAvailable(peerId_t originPeerId, size_t payloadSize) const;
+    void accountTxMessageState(TxMessageState const &txMsgState, bool isAdded);
+    void sendDigests();
+    void writeSnapshot();
+    void checkWalError(int error) const;
+
 
     ITxSocket *getTxSocketForRemoteAddress(struct sockaddr_in const &remoteSockAddr) const;
     bool isPeerSupported(peerId_t peerId) const;
     bool isSeqNrOfPeerAccepted(peerId_t peerId, seqNr_t seqNr) const;
+    seqNr_t getAcceptedSeqNrOfPeer(peerId_t peerId) const;
+    // Takes the first sequence number received from a peer as its base, if it is outside the window
+    void syncSeqNrOfPeer(peerId_t peerId, seqNr_t seqNr);
     void setAcceptedSeqNrOfPeer(peerId_t peerId, seqNr_t seqNr);
 
     void injectError(rgc::payload_t &payload) const;
@@ -237,15 +619,76 @@ private:
         return (it == end(m_txMessageStates)) ? nullptr : &(*it);
     }
 
+    // Finds the message an ACK refers to, the checksum of the ACK must match the epoch of the message
+    TxMessageState *findTxMsgStateOfAck(rgc::payload_t const &ack, peerId_t peerId, wireSeqNr_t wireSeqNr)
+    {
+        auto it = std::find_if(begin(m_txMessageStates), end(m_txMessageStates), 
+            [this, &ack, peerId, wireSeqNr](auto const &other) 
+            { 
+                MessageId const &msgId = other.getMsgId();
+                return ((msgId.getPeerId() == peerId) && 
+                        (static_cast<wireSeqNr_t>(msgId.getSeqNr()) == wireSeqNr) &&
+                        verifyChecksum(m_config.checksumType, ack.data(), ack.size(), getEpoch(msgId.getSeqNr())));
+            }
+        );
+
+        return (it == end(m_txMessageStates)) ? nullptr : &(*it);
+    }
+
     rgc::IApp *m_pApp;
     peerId_t m_ownPeerId;
     seqNr_t m_nextSeqNr;
     rgc::IRxSocket *m_pRxSocket;
     std::vector<ITxSocket *> &m_txSockets;
+    rgc::IRxSocket *m_pMcastRxSocket;
+    ITxSocket *m_pMcastTxSocket;
+    WriteAheadLog *m_pWal;
+    // While the received datagrams are processed, the datagrams they cause wait for the commit of their records
+    bool m_isHoldingTx;
+    std::vector<std::pair<ITxSocket const *, payload_t>> m_heldDatagrams;
     std::vector<nextSeqNr_t> m_nextSeqNrs;
     std::vector<bitflip_t> m_bitFlipInfos;
-
-    std::list<TxMessageState> m_txMessageStates;
+    mwConfig_t m_config;
+    size_t m_checksumSize;
+    size_t m_headerSize; // of data frames
+    std::minstd_rand m_rng;
+    std::chrono::system_clock::time_point m_nextAntiEntropy;
+    std::deque<retainedMsg_t> m_retainedMsgs;
+    // per peer, the next sequence numbers of the origins in its last digest
+    std::unordered_map<peerId_t, std::unordered_map<peerId_t, seqNr_t>> m_digestNextSeqNrs;
+    mwUsage_t m_usage;
+    // last cumulative drop counts reported by the sockets
+    uint32_t m_rxQueueDrops;
+    uint32_t m_mcastRxQueueDrops;
+    std::unordered_map<peerId_t, size_t> m_inFlightPerOrigin;
+    std::vector<peerLiveness_t> m_peerLiveness;
+    std::vector<peerRtt_t> m_peerRtts;
+    std::chrono::system_clock::time_point m_nextHeartbeat;
+    size_t m_numSuspected;
+    std::vector<ITxSocket *> m_unsuspectedTxSockets;
+    std::vector<delivery_t> m_deliveries;
+    // NACK mode
+    std::chrono::system_clock::time_point m_nextStatus;
+    std::list<TxMessageState> m_unstableMsgs; // own messages not confirmed by all peers yet, without tx states
+    std::unordered_map<peerId_t, rxStream_t> m_rxStreams;
+    std::unordered_map<peerId_t, seqNr_t> m_peerStatus; // next own sequence number each peer expects
+    std::vector<peerId_t> m_statusDue; // peers getting a STATUS in the next round
+    // Forward error correction: XOR of the own frames of the current block
+    rgc::payload_t m_fecXor;
+    uint16_t m_fecXorSize;
+    uint8_t m_fecNumXored;
+    // recently received frames and parity frames waiting for them, by origin peer and extended sequence number
+    std::map<std::pair<peerId_t, seqNr_t>, rgc::payload_t> m_fecFrames;
+    std::map<std::pair<peerId_t, seqNr_t>, rgc::payload_t> m_fecParities;
+    // ACK mode: messages the accepted sequence number skipped, acceptable while their block is kept
+    std::set<std::pair<peerId_t, seqNr_t>> m_fecSkipped;
+    // Egress pacing of all datagrams, and of those to each peer
+    TokenBucket m_pacer;
+    std::unordered_map<peerId_t, TokenBucket> m_peerPacers;
+    std::list<pacedTx_t> m_pacedStreamFrames;
+    std::chrono::system_clock::time_point m_nextPacedStreamFrame; // slot of the first frame held back, max if none
+
+    std::list<TxMessageState> m_txMessageStates; // ordered by Priority, in the order of their setup within a lane
 };
 
 }
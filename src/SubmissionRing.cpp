@@ -0,0 +1,266 @@
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fmt/core.h>
+
+#include "CommandSocket.h"
+#include "SubmissionRing.h"
+
+using namespace std;
+using namespace rgc;
+
+static constexpr uint32_t RING_MAGIC = 0x52474352; // "RGCR"
+static constexpr size_t RING_HEADER_SIZE = 192;    // header rounded up to full cache lines
+static constexpr size_t SLOT_LENGTH_SIZE = sizeof(uint32_t);
+
+static_assert(sizeof(ringHeader_t) <= RING_HEADER_SIZE, "ring header exceeds its reserved space");
+
+static uint8_t *getSlot(ringHeader_t *pHeader, uint32_t idx, uint32_t numSlots, uint32_t slotStride)
+{
+    return reinterpret_cast<uint8_t *>(pHeader) + RING_HEADER_SIZE + static_cast<size_t>(idx % numSlots) * slotStride;
+}
+
+SubmissionRing::SubmissionRing(string const &name, uint32_t numSlots, uint32_t slotSize) :
+    m_name(name),
+    m_eventDesc(-1),
+    m_mapSize(0),
+    m_pHeader(nullptr),
+    m_numSlots(numSlots),
+    m_slotSize(slotSize),
+    m_slotStride(0)
+{
+    // the free running indices wrap around at 2^32, which keeps slot order only for powers of two
+    if ((numSlots == 0) || ((numSlots & (numSlots - 1)) != 0) || (slotSize == 0))
+    {
+        throw std::runtime_error("Submission ring requires a power of two number of slots of non-zero size.");
+    }
+
+    // slots are cache line aligned, so that producer and consumer don't share lines of different slots
+    m_slotStride = ((SLOT_LENGTH_SIZE + slotSize + 63) / 64) * 64;
+    m_mapSize = RING_HEADER_SIZE + static_cast<size_t>(numSlots) * m_slotStride;
+
+    // a stale ring of a previous run is replaced
+    shm_unlink(name.c_str());
+    int shmDesc = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (shmDesc < 0)
+    {
+        throw std::runtime_error(fmt::format("Could not create submission ring {}.", name));
+    }
+
+    if (ftruncate(shmDesc, static_cast<off_t>(m_mapSize)) < 0)
+    {
+        close(shmDesc);
+        shm_unlink(name.c_str());
+        throw std::runtime_error(fmt::format("Could not size submission ring {}.", name));
+    }
+
+    void *pMap = mmap(nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmDesc, 0);
+    close(shmDesc);
+    if (pMap == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        throw std::runtime_error(fmt::format("Could not map submission ring {}.", name));
+    }
+
+    m_pHeader = new (pMap) ringHeader_t();
+    m_pHeader->numSlots = numSlots;
+    m_pHeader->slotSize = slotSize;
+    m_pHeader->slotStride = m_slotStride;
+    m_pHeader->head.store(0, std::memory_order_relaxed);
+    m_pHeader->tail.store(0, std::memory_order_relaxed);
+    // producers check the magic last
+    std::atomic_thread_fence(std::memory_order_release);
+    m_pHeader->magic = RING_MAGIC;
+
+    m_eventDesc = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_eventDesc < 0)
+    {
+        munmap(m_pHeader, m_mapSize);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Could not create eventfd of submission ring.");
+    }
+}
+
+SubmissionRing::~SubmissionRing()
+{
+    close(m_eventDesc);
+    munmap(m_pHeader, m_mapSize);
+    shm_unlink(m_name.c_str());
+}
+
+size_t SubmissionRing::consume(ringConsumer_t const &consumer, size_t maxMessages)
+{
+    uint32_t tail = m_pHeader->tail.load(std::memory_order_relaxed);
+    uint32_t head = m_pHeader->head.load(std::memory_order_acquire);
+    size_t numConsumed = 0;
+
+    while ((tail != head) && (numConsumed < maxMessages))
+    {
+        uint8_t const *pSlot = getSlot(m_pHeader, tail, m_numSlots, m_slotStride);
+        uint32_t size;
+        memcpy(&size, pSlot, SLOT_LENGTH_SIZE);
+
+        // a broken producer must not make us read beyond the slot
+        if ((size <= m_slotSize) && !consumer(pSlot + SLOT_LENGTH_SIZE, size))
+        {
+            break;
+        }
+
+        ++tail;
+        ++numConsumed;
+    }
+
+    // hand the consumed slots back to the producer in one go
+    m_pHeader->tail.store(tail, std::memory_order_release);
+    return numConsumed;
+}
+
+void SubmissionRing::clearEvent() const
+{
+    eventfd_t value;
+    (void)eventfd_read(m_eventDesc, &value);
+}
+
+
+SubmissionRingProducer::SubmissionRingProducer(string const &name, int eventDesc) :
+    m_eventDesc(eventDesc),
+    m_mapSize(0),
+    m_pHeader(nullptr),
+    m_numSlots(0),
+    m_slotSize(0),
+    m_slotStride(0)
+{
+    int shmDesc = shm_open(name.c_str(), O_RDWR, 0);
+    if (shmDesc < 0)
+    {
+        throw std::runtime_error(fmt::format("Could not open submission ring {}.", name));
+    }
+
+    struct stat shmStat;
+    if ((fstat(shmDesc, &shmStat) < 0) || (static_cast<size_t>(shmStat.st_size) < RING_HEADER_SIZE))
+    {
+        close(shmDesc);
+        throw std::runtime_error(fmt::format("Submission ring {} has no valid header.", name));
+    }
+
+    m_mapSize = static_cast<size_t>(shmStat.st_size);
+    void *pMap = mmap(nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmDesc, 0);
+    close(shmDesc);
+    if (pMap == MAP_FAILED)
+    {
+        throw std::runtime_error(fmt::format("Could not map submission ring {}.", name));
+    }
+
+    m_pHeader = reinterpret_cast<ringHeader_t *>(pMap);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    m_numSlots = m_pHeader->numSlots;
+    m_slotSize = m_pHeader->slotSize;
+    m_slotStride = m_pHeader->slotStride;
+    if ((m_pHeader->magic != RING_MAGIC) || (m_numSlots == 0) || (SLOT_LENGTH_SIZE + m_slotSize > m_slotStride) ||
+        (RING_HEADER_SIZE + static_cast<size_t>(m_numSlots) * m_slotStride > m_mapSize))
+    {
+        munmap(pMap, m_mapSize);
+        throw std::runtime_error(fmt::format("Submission ring {} has no valid header.", name));
+    }
+}
+
+SubmissionRingProducer::~SubmissionRingProducer()
+{
+    close(m_eventDesc);
+    munmap(m_pHeader, m_mapSize);
+}
+
+unique_ptr<SubmissionRingProducer> SubmissionRingProducer::attach(string const &commandSocketPath)
+{
+    struct ::sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, commandSocketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    int sockDesc = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if ((sockDesc < 0) || (connect(sockDesc, reinterpret_cast<struct sockaddr const *>(&addr), sizeof(addr)) < 0))
+    {
+        if (sockDesc >= 0)
+        {
+            close(sockDesc);
+        }
+        throw std::runtime_error(fmt::format("Could not connect to command socket {}.", commandSocketPath));
+    }
+
+    uint8_t request[COMMAND_HEADER_SIZE] = { static_cast<uint8_t>(CommandType::RING), 0, 0 };
+    int eventDesc = -1;
+    string name;
+
+    if (send(sockDesc, request, sizeof(request), MSG_NOSIGNAL) == sizeof(request))
+    {
+        name = CommandSocket::receiveReply(sockDesc, CommandType::RING, eventDesc);
+    }
+    close(sockDesc);
+
+    if (eventDesc < 0)
+    {
+        throw std::runtime_error(fmt::format("Peer at {} did not provide a submission ring.", commandSocketPath));
+    }
+
+    try
+    {
+        return make_unique<SubmissionRingProducer>(name, eventDesc);
+    }
+    catch (...)
+    {
+        close(eventDesc);
+        throw;
+    }
+}
+
+uint8_t *SubmissionRingProducer::claim()
+{
+    uint32_t head = m_pHeader->head.load(std::memory_order_relaxed);
+    uint32_t tail = m_pHeader->tail.load(std::memory_order_acquire);
+
+    if (head - tail >= m_numSlots)
+    {
+        return nullptr;
+    }
+
+    return getSlot(m_pHeader, head, m_numSlots, m_slotStride) + SLOT_LENGTH_SIZE;
+}
+
+void SubmissionRingProducer::publish(size_t size)
+{
+    uint32_t head = m_pHeader->head.load(std::memory_order_relaxed);
+    uint32_t size32 = static_cast<uint32_t>(size);
+    memcpy(getSlot(m_pHeader, head, m_numSlots, m_slotStride), &size32, SLOT_LENGTH_SIZE);
+    m_pHeader->head.store(head + 1, std::memory_order_release);
+}
+
+bool SubmissionRingProducer::tryPush(uint8_t const *data, size_t size)
+{
+    if (size > m_slotSize)
+    {
+        return false;
+    }
+
+    uint8_t *pSlot = claim();
+    if (pSlot == nullptr)
+    {
+        return false;
+    }
+
+    memcpy(pSlot, data, size);
+    publish(size);
+    return true;
+}
+
+void SubmissionRingProducer::notify() const
+{
+    (void)eventfd_write(m_eventDesc, 1);
+}
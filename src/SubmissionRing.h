@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "ISocket.h"
+
+namespace rgc {
+
+static constexpr uint32_t RING_DEFAULT_NUM_SLOTS = 1024;
+// a larger message would only fit into a datagram if deflated
+static constexpr uint32_t RING_DEFAULT_SLOT_SIZE = BUFFER_SIZE;
+
+// Start of the shared memory: Slot i is at offset RING_HEADER_SIZE + (i % numSlots) * slotStride,
+// and holds 4 Bytes length (host byte order) followed by the message
+typedef struct
+{
+    uint32_t magic;
+    uint32_t numSlots;
+    uint32_t slotSize; // max. message size
+    uint32_t slotStride;
+    alignas(64) std::atomic<uint32_t> head; // next slot to publish, written by the producer only
+    alignas(64) std::atomic<uint32_t> tail; // next slot to consume, written by the consumer only
+} ringHeader_t;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "ring indices must be lock free to be shared between processes");
+
+// Called per consumed message; returning false leaves the message in the ring for the next consume()
+typedef std::function<bool(uint8_t const *data, size_t size)> ringConsumer_t;
+
+// Single producer, single consumer ring in POSIX shared memory, created by the peer (the consumer).
+// The producer signals the eventfd after publishing messages.
+class SubmissionRing final
+{
+public:
+    SubmissionRing(std::string const &name, uint32_t numSlots = RING_DEFAULT_NUM_SLOTS, uint32_t slotSize = RING_DEFAULT_SLOT_SIZE);
+    ~SubmissionRing();
+    SubmissionRing(SubmissionRing const &) = delete;
+    SubmissionRing &operator=(SubmissionRing const &) = delete;
+
+    // Passes up to maxMessages published messages in place to the consumer, returns the number consumed
+    size_t consume(ringConsumer_t const &consumer, size_t maxMessages);
+
+    // Resets the eventfd after it became readable
+    void clearEvent() const;
+
+    int getEventDescriptor() const
+    {
+        return m_eventDesc;
+    }
+
+    std::string const &getName() const
+    {
+        return m_name;
+    }
+
+private:
+    std::string m_name;
+    int m_eventDesc;
+    size_t m_mapSize;
+    ringHeader_t *m_pHeader;
+    // the producer may overwrite the geometry in the header, only these copies are used
+    uint32_t m_numSlots;
+    uint32_t m_slotSize;
+    uint32_t m_slotStride;
+};
+
+// The producer side, in the same or in another process
+class SubmissionRingProducer final
+{
+public:
+    // Maps the ring of the given name, signalling via the eventfd received from the peer
+    SubmissionRingProducer(std::string const &name, int eventDesc);
+    ~SubmissionRingProducer();
+    SubmissionRingProducer(SubmissionRingProducer const &) = delete;
+    SubmissionRingProducer &operator=(SubmissionRingProducer const &) = delete;
+
+    // Requests the ring from a peer via its command socket, see CommandType::RING
+    static std::unique_ptr<SubmissionRingProducer> attach(std::string const &commandSocketPath);
+
+    // Slot for writing the next message in place, nullptr if the ring is full
+    uint8_t *claim();
+    // Makes the message written into the claimed slot visible to the consumer
+    void publish(size_t size);
+    // Copying variant of claim() and publish(), false if the ring is full or the message too large
+    bool tryPush(uint8_t const *data, size_t size);
+    // Wakes up the consumer, once per batch of published messages is sufficient
+    void notify() const;
+
+    uint32_t getSlotSize() const
+    {
+        return m_slotSize;
+    }
+
+private:
+    int m_eventDesc;
+    size_t m_mapSize;
+    ringHeader_t *m_pHeader;
+    // geometry as validated when the ring was mapped
+    uint32_t m_numSlots;
+    uint32_t m_slotSize;
+    uint32_t m_slotStride;
+};
+
+} // namespace rgc
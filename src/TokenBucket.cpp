@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cmath>
+
+#include "TokenBucket.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Rounding of the token arithmetic, so that a datagram conforms at the slot computed for it
+static constexpr double TOKEN_EPSILON = 1e-6;
+
+namespace rgc
+{
+
+TokenBucket::TokenBucket(size_t bytesPerSec, size_t packetsPerSec, milliseconds burst) :
+    m_bytesPerSec(static_cast<double>(bytesPerSec)),
+    m_packetsPerSec(static_cast<double>(packetsPerSec)),
+    // a burst always covers one datagram
+    m_byteCapacity(std::max(m_bytesPerSec * duration<double>(burst).count(), 1.0)),
+    m_packetCapacity(std::max(m_packetsPerSec * duration<double>(burst).count(), 1.0)),
+    m_byteTokens(m_byteCapacity),
+    m_packetTokens(m_packetCapacity),
+    m_lastRefill(),
+    m_isStarted(false)
+{
+}
+
+void TokenBucket::refill(system_clock::time_point now)
+{
+    if (m_isStarted && (now > m_lastRefill))
+    {
+        double elapsedSec = duration<double>(now - m_lastRefill).count();
+        m_byteTokens = std::min(m_byteCapacity, m_byteTokens + elapsedSec * m_bytesPerSec);
+        m_packetTokens = std::min(m_packetCapacity, m_packetTokens + elapsedSec * m_packetsPerSec);
+    }
+
+    if (!m_isStarted || (now > m_lastRefill))
+    {
+        m_lastRefill = now;
+        m_isStarted = true;
+    }
+}
+
+system_clock::time_point TokenBucket::getNextSlot(size_t bytes) const
+{
+    // A datagram larger than a burst waits for a full bucket
+    double waitSec = 0.0;
+    if (m_bytesPerSec > 0)
+    {
+        double missing = std::min(static_cast<double>(bytes), m_byteCapacity) - m_byteTokens;
+        if (missing > TOKEN_EPSILON)
+        {
+            waitSec = std::max(waitSec, missing / m_bytesPerSec);
+        }
+    }
+    if (m_packetsPerSec > 0)
+    {
+        double missing = 1.0 - m_packetTokens;
+        if (missing > TOKEN_EPSILON)
+        {
+            waitSec = std::max(waitSec, missing / m_packetsPerSec);
+        }
+    }
+
+    return m_lastRefill + duration_cast<system_clock::duration>(duration<double>(std::ceil(waitSec * 1e9) / 1e9));
+}
+
+void TokenBucket::consume(size_t bytes)
+{
+    if (m_bytesPerSec > 0)
+    {
+        m_byteTokens -= static_cast<double>(bytes);
+    }
+    if (m_packetsPerSec > 0)
+    {
+        m_packetTokens -= 1.0;
+    }
+}
+
+} // namespace rgc
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace rgc {
+
+// Egress rate limit in bytes and in datagrams per second, a rate of 0 is unlimited. Each bucket holds the tokens of
+// at most one burst interval. Datagrams which must not wait, e.g. ACKs, are taken from it even if that leaves a debt.
+class TokenBucket final
+{
+public:
+    TokenBucket(size_t bytesPerSec, size_t packetsPerSec, std::chrono::milliseconds burst);
+
+    bool isLimited() const
+    {
+        return (m_bytesPerSec > 0) || (m_packetsPerSec > 0);
+    }
+
+    // Adds the tokens accrued since the last refill; the first one starts with full buckets
+    void refill(std::chrono::system_clock::time_point now);
+    // Earliest point in time at which a datagram conforms, the time of the last refill if it does already
+    std::chrono::system_clock::time_point getNextSlot(size_t bytes) const;
+    void consume(size_t bytes);
+
+private:
+    double m_bytesPerSec;
+    double m_packetsPerSec;
+    double m_byteCapacity;
+    double m_packetCapacity;
+    double m_byteTokens;
+    double m_packetTokens;
+    std::chrono::system_clock::time_point m_lastRefill;
+    bool m_isStarted;
+};
+
+} // namespace rgc
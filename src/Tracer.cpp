@@ -0,0 +1,126 @@
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fmt/core.h>
+
+#include "Tracer.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace rgc
+{
+
+namespace
+{
+
+typedef struct
+{
+    char const *name;
+    int64_t start;
+    int64_t duration;
+} traceEvent_t;
+
+// Only its own thread writes into a buffer, the mutex is contended while the buffer is dumped only
+typedef struct
+{
+    mutex bufMutex;
+    long tid;
+    vector<traceEvent_t> events;
+    size_t next; // index of the oldest event once the buffer wrapped
+} threadBuffer_t;
+
+mutex s_buffersMutex;
+// The buffers of exited threads are kept, so that their events are still dumped
+vector<shared_ptr<threadBuffer_t>> s_buffers;
+thread_local threadBuffer_t *t_pBuffer = nullptr;
+
+threadBuffer_t &getThreadBuffer()
+{
+    if (t_pBuffer == nullptr)
+    {
+        auto pBuffer = make_shared<threadBuffer_t>();
+        pBuffer->tid = syscall(SYS_gettid);
+        pBuffer->events.reserve(Tracer::EVENTS_PER_THREAD);
+        pBuffer->next = 0;
+
+        lock_guard<mutex> lock(s_buffersMutex);
+        s_buffers.push_back(pBuffer);
+        t_pBuffer = pBuffer.get();
+    }
+    return *t_pBuffer;
+}
+
+void writeEvent(ostream &out, traceEvent_t const &event, long tid, bool isFirst)
+{
+    // Chrome trace timestamps are in us
+    out << fmt::format("{}\n{{\"name\":\"{}\",\"cat\":\"rgc\",\"ph\":\"X\",\"pid\":{},\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+        isFirst ? "" : ",", event.name, getpid(), tid, event.start / 1000.0, event.duration / 1000.0);
+}
+
+} // namespace
+
+atomic<bool> Tracer::s_isEnabled(false);
+
+int64_t Tracer::now()
+{
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::record(char const *name, int64_t start, int64_t end)
+{
+    threadBuffer_t &buffer = getThreadBuffer();
+    lock_guard<mutex> lock(buffer.bufMutex);
+    traceEvent_t event = { name, start, end - start };
+    if (buffer.events.size() < EVENTS_PER_THREAD)
+    {
+        buffer.events.push_back(event);
+    }
+    else
+    {
+        buffer.events[buffer.next] = event;
+        buffer.next = (buffer.next + 1) % EVENTS_PER_THREAD;
+    }
+}
+
+size_t Tracer::writeChromeTrace(ostream &out)
+{
+    vector<shared_ptr<threadBuffer_t>> buffers;
+    {
+        lock_guard<mutex> lock(s_buffersMutex);
+        buffers = s_buffers;
+    }
+
+    size_t ret = 0;
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (auto const &pBuffer : buffers)
+    {
+        lock_guard<mutex> lock(pBuffer->bufMutex);
+        // oldest first
+        size_t numEvents = pBuffer->events.size();
+        for (size_t i = 0; i < numEvents; i++)
+        {
+            writeEvent(out, pBuffer->events[(pBuffer->next + i) % numEvents], pBuffer->tid, (ret == 0));
+            ret++;
+        }
+    }
+    out << "\n]}\n";
+    return ret;
+}
+
+void Tracer::clear()
+{
+    lock_guard<mutex> lock(s_buffersMutex);
+    for (auto const &pBuffer : s_buffers)
+    {
+        lock_guard<mutex> bufLock(pBuffer->bufMutex);
+        pBuffer->events.clear();
+        pBuffer->next = 0;
+    }
+}
+
+} // namespace rgc
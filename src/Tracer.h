@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace rgc {
+
+// Durations of the phases of the event loop, for finding where the time of a stall went. Each thread records into a
+// ring buffer of its own, which keeps its latest EVENTS_PER_THREAD events; writeChromeTrace() dumps those of all
+// threads as Chrome trace JSON, which Perfetto (ui.perfetto.dev) and chrome://tracing open. Recording is off by
+// default, a TraceScope then costs the test of one flag.
+class Tracer final
+{
+public:
+    static constexpr size_t EVENTS_PER_THREAD = 65536;
+
+    static void enable(bool isEnabled)
+    {
+        s_isEnabled.store(isEnabled, std::memory_order_relaxed);
+    }
+
+    static bool isEnabled()
+    {
+        return __builtin_expect(s_isEnabled.load(std::memory_order_relaxed), false);
+    }
+
+    // Monotonic time in ns, the time base of all events
+    static int64_t now();
+    // name must outlive the Tracer, i.e. be a string literal
+    static void record(char const *name, int64_t start, int64_t end);
+    // Writes the recorded events of all threads, which keep recording meanwhile. Returns the number of events.
+    static size_t writeChromeTrace(std::ostream &out);
+    // Discards the recorded events of all threads
+    static void clear();
+
+private:
+    static std::atomic<bool> s_isEnabled;
+};
+
+// Records the time from its construction to its destruction as a phase of the calling thread, if recording is on
+class TraceScope final
+{
+public:
+    explicit TraceScope(char const *name) : m_name(nullptr), m_start(0)
+    {
+        if (Tracer::isEnabled())
+        {
+            m_name = name;
+            m_start = Tracer::now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (m_name != nullptr)
+        {
+            Tracer::record(m_name, m_start, Tracer::now());
+        }
+    }
+
+    TraceScope(TraceScope const &) = delete;
+    TraceScope &operator=(TraceScope const &) = delete;
+
+private:
+    char const *m_name;
+    int64_t m_start;
+};
+
+} // namespace rgc
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 #include <unistd.h>
@@ -8,9 +9,91 @@
 #include "UdpSocket.h"
 
 using namespace std;
+using namespace std::chrono;
 using namespace rgc;
 
-UdpRxSocket::UdpRxSocket(in_addr_t localIp, uint16_t localPort)
+// Space for the SO_TIMESTAMPNS and SO_RXQ_OVFL control messages
+static constexpr size_t RX_CONTROL_SIZE = CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t));
+
+void rgc::parseControlMessages(struct ::msghdr const &msg, TransmitStatus &status)
+{
+    for (struct cmsghdr *pCmsg = CMSG_FIRSTHDR(&msg); pCmsg != nullptr; pCmsg = CMSG_NXTHDR(const_cast<struct ::msghdr *>(&msg), pCmsg))
+    {
+        if ((pCmsg->cmsg_level == SOL_SOCKET) && (pCmsg->cmsg_type == SCM_TIMESTAMPNS))
+        {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(pCmsg), sizeof(ts));
+            status.timestamp = system_clock::time_point(duration_cast<system_clock::duration>(seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec)));
+        }
+        else if ((pCmsg->cmsg_level == SOL_SOCKET) && (pCmsg->cmsg_type == SO_RXQ_OVFL))
+        {
+            // only present once the kernel dropped something
+            memcpy(&status.rxQueueDrops, CMSG_DATA(pCmsg), sizeof(status.rxQueueDrops));
+        }
+    }
+}
+
+static TransmitStatus receiveDatagram(int socketDesc, bool hasControlMessages, struct ::iovec *iov, size_t iovLen, struct sockaddr_in &remoteAddr)
+{
+    memset(&remoteAddr, 0, sizeof(struct sockaddr_in));
+    TransmitStatus ret = { 0, 0 };
+    alignas(struct cmsghdr) uint8_t control[RX_CONTROL_SIZE];
+    struct ::msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &remoteAddr;
+    msg.msg_namelen = sizeof(remoteAddr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovLen;
+    if (hasControlMessages)
+    {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+    }
+
+    ssize_t rxBytes = recvmsg(socketDesc, &msg, 0);
+    if (rxBytes < 0)
+    {
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+        {
+            ret.status = errno;
+        }
+    }
+    else
+    {
+        if (hasControlMessages)
+        {
+            parseControlMessages(msg, ret);
+        }
+        ret.transmitBytes = static_cast<size_t>(rxBytes);
+    }
+
+    return ret;
+}
+
+static TransmitStatus receiveDatagram(int socketDesc, bool hasControlMessages, rx_buffer_t &buf, struct sockaddr_in &remoteAddr)
+{
+    struct ::iovec iov = { buf.data(), buf.size() };
+    return receiveDatagram(socketDesc, hasControlMessages, &iov, 1, remoteAddr);
+}
+
+static int enableSocketOption(int socketDesc, int option)
+{
+    int enable = 1;
+    return (setsockopt(socketDesc, SOL_SOCKET, option, &enable, sizeof(enable)) == 0) ? 0 : errno;
+}
+
+static int setBufferSize(int socketDesc, int forceOption, int option, size_t bytes)
+{
+    int value = static_cast<int>(std::min(bytes, static_cast<size_t>(INT32_MAX / 2)));
+    if (setsockopt(socketDesc, SOL_SOCKET, forceOption, &value, sizeof(value)) == 0)
+    {
+        return 0;
+    }
+    // unprivileged: capped by net.core.rmem_max/wmem_max
+    return (setsockopt(socketDesc, SOL_SOCKET, option, &value, sizeof(value)) == 0) ? 0 : errno;
+}
+
+UdpRxSocket::UdpRxSocket(in_addr_t localIp, uint16_t localPort) : m_hasControlMessages(false)
 {
     m_socketDesc = socket(AF_INET, SOCK_DGRAM, 0);
 
@@ -36,6 +119,48 @@ UdpRxSocket::UdpRxSocket(in_addr_t localIp, uint16_t localPort)
     }
 }
 
+int UdpRxSocket::setBusyPoll(uint32_t busyPollUs)
+{
+    int value = static_cast<int>(busyPollUs);
+    return (setsockopt(m_socketDesc, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value)) == 0) ? 0 : errno;
+}
+
+int UdpRxSocket::enableTimestamps()
+{
+    int ret = enableSocketOption(m_socketDesc, SO_TIMESTAMPNS);
+    m_hasControlMessages = m_hasControlMessages || (ret == 0);
+    return ret;
+}
+
+int UdpRxSocket::enableDropCounts()
+{
+    int ret = enableSocketOption(m_socketDesc, SO_RXQ_OVFL);
+    m_hasControlMessages = m_hasControlMessages || (ret == 0);
+    return ret;
+}
+
+int UdpRxSocket::setBufferSizes(size_t rcvBufBytes, size_t sndBufBytes)
+{
+    int ret = 0;
+    if (rcvBufBytes > 0)
+    {
+        ret = setBufferSize(m_socketDesc, SO_RCVBUFFORCE, SO_RCVBUF, rcvBufBytes);
+    }
+    if ((ret == 0) && (sndBufBytes > 0))
+    {
+        ret = setBufferSize(m_socketDesc, SO_SNDBUFFORCE, SO_SNDBUF, sndBufBytes);
+    }
+    return ret;
+}
+
+size_t UdpRxSocket::getBufferBytes(int option) const
+{
+    int value = 0;
+    socklen_t valueLen = sizeof(value);
+    getsockopt(m_socketDesc, SOL_SOCKET, option, &value, &valueLen);
+    return static_cast<size_t>(value);
+}
+
 UdpRxSocket::~UdpRxSocket()
 {
     close(m_socketDesc);
@@ -43,28 +168,89 @@ UdpRxSocket::~UdpRxSocket()
 
 TransmitStatus UdpRxSocket::receive(rx_buffer_t &buf, struct sockaddr_in &remoteAddr) const
 {
-    socklen_t remoteAddrLen = sizeof(remoteAddr);     
-    memset(&remoteAddr, 0, sizeof(struct sockaddr_in));
-    TransmitStatus ret = { 0, 0 };
-    ssize_t rxBytes = recvfrom(m_socketDesc, buf.data(), buf.size(), 0, (struct sockaddr *)&remoteAddr, &remoteAddrLen);
+    return receiveDatagram(m_socketDesc, m_hasControlMessages, buf, remoteAddr);
+}
 
-    if (rxBytes < 0)
+TransmitStatus UdpRxSocket::receive(uint8_t &channelId, rx_buffer_t &buf, struct sockaddr_in &remoteAddr) const
+{
+    // the channel byte lands in front of a complete frame, without copying
+    struct ::iovec iov[2] = { { &channelId, sizeof(channelId) }, { buf.data(), buf.size() } };
+    return receiveDatagram(m_socketDesc, m_hasControlMessages, iov, 2, remoteAddr);
+}
+
+
+UdpMcastRxSocket::UdpMcastRxSocket(in_addr_t localIp, in_addr_t groupIp, uint16_t groupPort) : m_hasControlMessages(false)
+{
+    m_socketDesc = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (m_socketDesc < 0)
     {
-        if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
-        {
-            ret.status = errno;
-        }
+        throw std::runtime_error("Could not create Udp multicast Rx socket.");
     }
-    else
+
+    // all peers on this host bind to the same group port
+    int reuse = 1;
+    if (setsockopt(m_socketDesc, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0)
     {
-        ret.transmitBytes = static_cast<size_t>(rxBytes);
+        close(m_socketDesc);
+        throw std::runtime_error("Could not configure Udp multicast Rx socket for address reuse.");
+    }
+
+    // configure for async rx
+    int flags = fcntl(m_socketDesc, F_GETFL, 0); 
+    fcntl(m_socketDesc, F_SETFL, flags | O_NONBLOCK);
+
+    // bind to the group address, so that we don't receive unicast datagrams to the group port
+    struct ::sockaddr_in groupSockAddr;
+    memset(&groupSockAddr, 0, sizeof(groupSockAddr)); 
+    groupSockAddr.sin_family = AF_INET;
+    groupSockAddr.sin_addr.s_addr = groupIp;
+    groupSockAddr.sin_port = htons(groupPort);
+
+    if (::bind(m_socketDesc, reinterpret_cast<const struct sockaddr *>(&groupSockAddr), sizeof(groupSockAddr)) < 0) 
+    { 
+        close(m_socketDesc);
+        throw std::runtime_error(fmt::format("Could not bind Udp multicast Rx socket to group port: {}.", groupPort));
     }
 
+    m_membership.imr_multiaddr.s_addr = groupIp;
+    m_membership.imr_interface.s_addr = localIp;
+    if (setsockopt(m_socketDesc, IPPROTO_IP, IP_ADD_MEMBERSHIP, &m_membership, sizeof(m_membership)) < 0)
+    {
+        close(m_socketDesc);
+        throw std::runtime_error("Could not join multicast group, does the interface of the local address support multicast?");
+    }
+}
+
+int UdpMcastRxSocket::enableTimestamps()
+{
+    int ret = enableSocketOption(m_socketDesc, SO_TIMESTAMPNS);
+    m_hasControlMessages = m_hasControlMessages || (ret == 0);
+    return ret;
+}
+
+int UdpMcastRxSocket::enableDropCounts()
+{
+    int ret = enableSocketOption(m_socketDesc, SO_RXQ_OVFL);
+    m_hasControlMessages = m_hasControlMessages || (ret == 0);
     return ret;
 }
 
+UdpMcastRxSocket::~UdpMcastRxSocket()
+{
+    setsockopt(m_socketDesc, IPPROTO_IP, IP_DROP_MEMBERSHIP, &m_membership, sizeof(m_membership));
+    close(m_socketDesc);
+}
 
-UdpTxSocket::UdpTxSocket(peer_t const &peer, int socketDesc) : m_peerId(peer.peerId), m_socketDesc(socketDesc)
+TransmitStatus UdpMcastRxSocket::receive(rx_buffer_t &buf, struct sockaddr_in &remoteAddr) const
+{
+    return receiveDatagram(m_socketDesc, m_hasControlMessages, buf, remoteAddr);
+}
+
+UdpTxSocket::UdpTxSocket(peer_t const &peer, int socketDesc, bool isTimestamped) :
+    m_peerId(peer.peerId),
+    m_socketDesc(socketDesc),
+    m_isTimestamped(isTimestamped)
 {
     std::memset(&m_remoteSockAddr, 0, sizeof(m_remoteSockAddr));
     m_remoteSockAddr.sin_family = AF_INET;
@@ -89,15 +275,76 @@ TransmitStatus UdpTxSocket::send(payload_t const &payload) const
 
     if (sentBytes < 0)
     {
-        if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+        // incl. EAGAIN and ENOBUFS: the send buffer is full, the datagram is lost
+        ret.status = errno;
+    }
+    else
+    {
+        ret.transmitBytes = static_cast<size_t>(sentBytes);
+        if (m_isTimestamped)
         {
-            ret.status = errno;
+            ret.timestamp = system_clock::now();
         }
     }
+
+    return ret;
+}
+
+UdpChannelTxSocket::UdpChannelTxSocket(peer_t const &peer, int socketDesc, uint8_t channelId, bool isTimestamped) :
+    UdpTxSocket(peer, socketDesc, isTimestamped),
+    m_channelId(channelId)
+{
+}
+
+UdpChannelTxSocket::~UdpChannelTxSocket()
+{
+}
+
+TransmitStatus UdpChannelTxSocket::send(payload_t const &payload) const
+{
+    struct ::iovec iov[2] = { { const_cast<uint8_t *>(&m_channelId), sizeof(m_channelId) },
+        { const_cast<uint8_t *>(payload.data()), payload.size() } };
+    struct ::msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = const_cast<struct ::sockaddr_in *>(&getRemoteSocketAddr());
+    msg.msg_namelen = sizeof(struct ::sockaddr_in);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    TransmitStatus ret = { 0, 0 };
+    ssize_t sentBytes = sendmsg(getSocketDescriptor(), &msg, 0);
+    if (sentBytes < 0)
+    {
+        ret.status = errno;
+    }
     else
     {
-        ret.transmitBytes = static_cast<size_t>(sentBytes);
+        // the middleware only sees its frame
+        ret.transmitBytes = static_cast<size_t>(sentBytes) - sizeof(m_channelId);
+        if (isTimestamped())
+        {
+            ret.timestamp = system_clock::now();
+        }
     }
 
     return ret;
 }
+
+UdpMcastTxSocket::UdpMcastTxSocket(peer_t const &group, in_addr_t localIp, uint8_t ttl, int socketDesc) : UdpTxSocket(group, socketDesc)
+{
+    struct ::in_addr localAddr;
+    localAddr.s_addr = localIp;
+    // Multicast loop: peers on the same host, including ourselves, receive our datagrams
+    unsigned char loop = 1;
+
+    if ((setsockopt(socketDesc, IPPROTO_IP, IP_MULTICAST_IF, &localAddr, sizeof(localAddr)) < 0) ||
+        (setsockopt(socketDesc, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0) ||
+        (setsockopt(socketDesc, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0))
+    {
+        throw std::runtime_error("Could not configure Udp socket for sending to multicast group.");
+    }
+}
+
+UdpMcastTxSocket::~UdpMcastTxSocket()
+{
+}
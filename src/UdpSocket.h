@@ -5,28 +5,69 @@
 
 namespace rgc {
 
+// Takes the SO_TIMESTAMPNS time and the SO_RXQ_OVFL drop count of a datagram received with recvmsg() into status
+extern void parseControlMessages(struct ::msghdr const &msg, TransmitStatus &status);
+
 class UdpRxSocket : public IRxSocket
 {
 public:
     UdpRxSocket(in_addr_t localIp, uint16_t localPort);
     virtual ~UdpRxSocket();
     virtual TransmitStatus receive(rx_buffer_t &buf, struct sockaddr_in &remoteAddr) const;
+    // Receives a datagram of a ChannelEndpoint: channel byte, then the frame. transmitBytes counts the channel byte.
+    TransmitStatus receive(uint8_t &channelId, rx_buffer_t &buf, struct sockaddr_in &remoteAddr) const;
 
-    int getSocketDescriptor() const
+    // SO_BUSY_POLL: receiving polls the device queue for up to busyPollUs instead of waiting for its interrupt.
+    // Returns 0 or the errno, e.g. EPERM above net.core.busy_read without CAP_NET_ADMIN.
+    int setBusyPoll(uint32_t busyPollUs);
+    // SO_TIMESTAMPNS: received datagrams carry their kernel arrival time. Returns 0 or the errno.
+    int enableTimestamps();
+    // SO_RXQ_OVFL: received datagrams carry the number of datagrams the kernel dropped for a full receive buffer
+    int enableDropCounts();
+    // Kernel buffers of the socket, which sends as well; SO_RCVBUFFORCE/SO_SNDBUFFORCE exceed the system maximum
+    // if privileged. 0 keeps a size. Returns 0 or the errno.
+    int setBufferSizes(size_t rcvBufBytes, size_t sndBufBytes);
+    // Effective size of SO_RCVBUF or SO_SNDBUF, the kernel doubles the requested size for its bookkeeping
+    size_t getBufferBytes(int option) const;
+
+    virtual int getSocketDescriptor() const
     {
         return m_socketDesc;
     }
 
 private:
     int m_socketDesc;
+    bool m_hasControlMessages;
     struct ::sockaddr_in m_localSockAddr;
 };
 
 
+// Receives the datagrams sent to a multicast group on the interface of the local IP address
+class UdpMcastRxSocket : public IRxSocket
+{
+public:
+    UdpMcastRxSocket(in_addr_t localIp, in_addr_t groupIp, uint16_t groupPort);
+    virtual ~UdpMcastRxSocket();
+    virtual TransmitStatus receive(rx_buffer_t &buf, struct sockaddr_in &remoteAddr) const;
+    int enableTimestamps();
+    int enableDropCounts();
+
+    virtual int getSocketDescriptor() const
+    {
+        return m_socketDesc;
+    }
+
+private:
+    int m_socketDesc;
+    bool m_hasControlMessages;
+    struct ::ip_mreq m_membership;
+};
+
 class UdpTxSocket : public ITxSocket
 {
 public:
-    UdpTxSocket(peer_t const &peer, int socketDesc);
+    // A timestamped socket takes the time after each send, which must then be the time of the middleware's clock
+    UdpTxSocket(peer_t const &peer, int socketDesc, bool isTimestamped = false);
     virtual ~UdpTxSocket();
     virtual TransmitStatus send(payload_t const &payload) const;
 
@@ -40,10 +81,43 @@ public:
         return m_peerId;
     }
 
+protected:
+    int getSocketDescriptor() const
+    {
+        return m_socketDesc;
+    }
+
+    bool isTimestamped() const
+    {
+        return m_isTimestamped;
+    }
+
 private:
     peerId_t m_peerId;
     int m_socketDesc;
+    bool m_isTimestamped;
     struct ::sockaddr_in m_remoteSockAddr;
 };
 
-} // namespace rgc
+// Sends the frames of one channel of a ChannelEndpoint, prefixed by the channel byte
+class UdpChannelTxSocket : public UdpTxSocket
+{
+public:
+    UdpChannelTxSocket(peer_t const &peer, int socketDesc, uint8_t channelId, bool isTimestamped = false);
+    virtual ~UdpChannelTxSocket();
+    virtual TransmitStatus send(payload_t const &payload) const;
+
+private:
+    uint8_t m_channelId;
+};
+
+// Sends to a multicast group via the socket descriptor of the Udp Rx socket, so that the receivers
+// see the unicast address of the sending peer as the source address
+class UdpMcastTxSocket : public UdpTxSocket
+{
+public:
+    UdpMcastTxSocket(peer_t const &group, in_addr_t localIp, uint8_t ttl, int socketDesc);
+    virtual ~UdpMcastTxSocket();
+};
+
+} // namespace rgc
\ No newline at end of file
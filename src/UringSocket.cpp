@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fmt/core.h>
+
+#include "UringSocket.h"
+#include "UdpSocket.h"
+
+using namespace std;
+
+// Buffer group of the provided rx buffers
+static constexpr uint16_t RX_BUFFER_GROUP = 0;
+// Space for the SO_TIMESTAMPNS and SO_RXQ_OVFL control messages, if the socket has them enabled
+static constexpr size_t RX_CONTROL_SIZE = CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t));
+// Each provided buffer holds the recvmsg header, the source address, the control messages and the datagram
+static constexpr size_t RX_BUFFER_SIZE = sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in) + RX_CONTROL_SIZE + rgc::BUFFER_SIZE;
+static constexpr uint64_t RX_USER_DATA = UINT64_MAX;
+static constexpr size_t NUM_TX_SLOTS = 256;
+
+namespace rgc
+{
+
+static int uringSetup(unsigned entries, struct io_uring_params *pParams)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, pParams));
+}
+
+static int uringEnter(int ringDesc, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, ringDesc, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+static int uringRegister(int ringDesc, unsigned opcode, void *arg, unsigned numArgs)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, ringDesc, opcode, arg, numArgs));
+}
+
+UringContext::UringContext(int socketDesc, unsigned numEntries, unsigned numRxBuffers) :
+    m_socketDesc(socketDesc),
+    m_ringDesc(-1),
+    m_pRing(MAP_FAILED),
+    m_ringSize(0),
+    m_pSqes(static_cast<struct io_uring_sqe *>(MAP_FAILED)),
+    m_sqesSize(0),
+    m_sqTail(0),
+    m_pBufRing(static_cast<struct io_uring_buf_ring *>(MAP_FAILED)),
+    m_bufRingSize(0),
+    m_numRxBuffers(numRxBuffers),
+    m_bufRingTail(0),
+    m_rxBuffers(numRxBuffers * RX_BUFFER_SIZE),
+    m_isRxArmed(false),
+    m_txSlots(NUM_TX_SLOTS),
+    m_numTxErrors(0)
+{
+    if ((numRxBuffers == 0) || (numRxBuffers > 32768) || ((numRxBuffers & (numRxBuffers - 1)) != 0))
+    {
+        throw std::runtime_error("Number of io_uring rx buffers must be a power of two up to 32768.");
+    }
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    m_ringDesc = uringSetup(numEntries, &params);
+    if (m_ringDesc < 0)
+    {
+        throw std::runtime_error(fmt::format("io_uring_setup failed: {}.", strerror(errno)));
+    }
+
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0)
+    {
+        release();
+        throw std::runtime_error("io_uring lacks IORING_FEAT_SINGLE_MMAP.");
+    }
+
+    // Submission and completion queue share one mapping
+    m_ringSize = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned), params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+    m_pRing = mmap(nullptr, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringDesc, IORING_OFF_SQ_RING);
+    m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    m_pSqes = static_cast<struct io_uring_sqe *>(mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringDesc, IORING_OFF_SQES));
+    if ((m_pRing == MAP_FAILED) || (m_pSqes == MAP_FAILED))
+    {
+        release();
+        throw std::runtime_error(fmt::format("Could not map io_uring queues: {}.", strerror(errno)));
+    }
+
+    uint8_t *pRing = static_cast<uint8_t *>(m_pRing);
+    m_pSqHead = reinterpret_cast<unsigned *>(pRing + params.sq_off.head);
+    m_pSqTail = reinterpret_cast<unsigned *>(pRing + params.sq_off.tail);
+    m_pSqArray = reinterpret_cast<unsigned *>(pRing + params.sq_off.array);
+    m_sqMask = *reinterpret_cast<unsigned *>(pRing + params.sq_off.ring_mask);
+    m_sqEntries = params.sq_entries;
+    m_sqTail = *m_pSqTail;
+    m_pCqHead = reinterpret_cast<unsigned *>(pRing + params.cq_off.head);
+    m_pCqTail = reinterpret_cast<unsigned *>(pRing + params.cq_off.tail);
+    m_pCqes = reinterpret_cast<struct io_uring_cqe *>(pRing + params.cq_off.cqes);
+    m_cqMask = *reinterpret_cast<unsigned *>(pRing + params.cq_off.ring_mask);
+
+    // Register the ring of provided rx buffers, the kernel picks one for each received datagram
+    m_bufRingSize = numRxBuffers * sizeof(struct io_uring_buf);
+    m_pBufRing = static_cast<struct io_uring_buf_ring *>(mmap(nullptr, m_bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (m_pBufRing == MAP_FAILED)
+    {
+        release();
+        throw std::runtime_error(fmt::format("Could not allocate io_uring buffer ring: {}.", strerror(errno)));
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(m_pBufRing);
+    reg.ring_entries = numRxBuffers;
+    reg.bgid = RX_BUFFER_GROUP;
+    if (uringRegister(m_ringDesc, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        release();
+        throw std::runtime_error(fmt::format("Could not register io_uring buffer ring: {}.", strerror(errno)));
+    }
+
+    for (uint16_t bufferId = 0; bufferId < numRxBuffers; bufferId++)
+    {
+        recycleRxBuffer(bufferId);
+    }
+
+    for (uint16_t slot = 0; slot < NUM_TX_SLOTS; slot++)
+    {
+        m_freeTxSlots.push_back(slot);
+    }
+
+    memset(&m_rxMsgHdr, 0, sizeof(m_rxMsgHdr));
+    m_rxMsgHdr.msg_namelen = sizeof(struct sockaddr_in);
+    m_rxMsgHdr.msg_controllen = RX_CONTROL_SIZE;
+
+    // Kernels without multishot recvmsg reject the request right away
+    armReceive();
+    submit();
+    reapCompletions();
+    if (!m_rxCompletions.empty() && (m_rxCompletions.front().res == -EINVAL))
+    {
+        release();
+        throw std::runtime_error("io_uring does not support multishot recvmsg.");
+    }
+}
+
+UringContext::~UringContext()
+{
+    release();
+}
+
+void UringContext::release()
+{
+    if (m_pBufRing != MAP_FAILED)
+    {
+        munmap(m_pBufRing, m_bufRingSize);
+        m_pBufRing = static_cast<struct io_uring_buf_ring *>(MAP_FAILED);
+    }
+    if (m_pSqes != MAP_FAILED)
+    {
+        munmap(m_pSqes, m_sqesSize);
+        m_pSqes = static_cast<struct io_uring_sqe *>(MAP_FAILED);
+    }
+    if (m_pRing != MAP_FAILED)
+    {
+        munmap(m_pRing, m_ringSize);
+        m_pRing = MAP_FAILED;
+    }
+    if (m_ringDesc >= 0)
+    {
+        // cancels the pending requests
+        close(m_ringDesc);
+        m_ringDesc = -1;
+    }
+}
+
+struct io_uring_sqe *UringContext::getSqe()
+{
+    if (m_sqTail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+    {
+        submit();
+        if (m_sqTail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+        {
+            return nullptr;
+        }
+    }
+
+    unsigned idx = m_sqTail & m_sqMask;
+    struct io_uring_sqe *pSqe = &m_pSqes[idx];
+    memset(pSqe, 0, sizeof(*pSqe));
+    m_pSqArray[idx] = idx;
+    m_sqTail++;
+    return pSqe;
+}
+
+void UringContext::submit()
+{
+    if (!m_isRxArmed)
+    {
+        armReceive();
+    }
+
+    __atomic_store_n(m_pSqTail, m_sqTail, __ATOMIC_RELEASE);
+    unsigned toSubmit = m_sqTail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE);
+    if (toSubmit > 0)
+    {
+        uringEnter(m_ringDesc, toSubmit, 0, 0);
+    }
+}
+
+void UringContext::armReceive()
+{
+    struct io_uring_sqe *pSqe = getSqe();
+    if (pSqe != nullptr)
+    {
+        pSqe->opcode = IORING_OP_RECVMSG;
+        pSqe->fd = m_socketDesc;
+        pSqe->addr = reinterpret_cast<uint64_t>(&m_rxMsgHdr);
+        pSqe->ioprio = IORING_RECV_MULTISHOT;
+        pSqe->flags = IOSQE_BUFFER_SELECT;
+        pSqe->buf_group = RX_BUFFER_GROUP;
+        pSqe->user_data = RX_USER_DATA;
+        m_isRxArmed = true;
+    }
+}
+
+void UringContext::reapCompletions()
+{
+    unsigned head = *m_pCqHead;
+    unsigned tail = __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++)
+    {
+        struct io_uring_cqe const &cqe = m_pCqes[head & m_cqMask];
+        if (cqe.user_data == RX_USER_DATA)
+        {
+            m_rxCompletions.push_back({ cqe.res, cqe.flags });
+            // e.g. after running out of rx buffers
+            if ((cqe.flags & IORING_CQE_F_MORE) == 0)
+            {
+                m_isRxArmed = false;
+            }
+        }
+        else
+        {
+            if (cqe.res < 0)
+            {
+                m_numTxErrors++;
+            }
+            m_freeTxSlots.push_back(static_cast<uint16_t>(cqe.user_data));
+        }
+    }
+
+    __atomic_store_n(m_pCqHead, head, __ATOMIC_RELEASE);
+}
+
+void UringContext::waitForCompletion()
+{
+    submit();
+    uringEnter(m_ringDesc, 0, 1, IORING_ENTER_GETEVENTS);
+    reapCompletions();
+}
+
+void UringContext::recycleRxBuffer(uint16_t bufferId)
+{
+    // Not via m_pBufRing->bufs: in C++, its empty placeholder struct moves the array to offset 8
+    struct io_uring_buf &buf = reinterpret_cast<struct io_uring_buf *>(m_pBufRing)[m_bufRingTail & (m_numRxBuffers - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(&m_rxBuffers[bufferId * RX_BUFFER_SIZE]);
+    buf.len = RX_BUFFER_SIZE;
+    buf.bid = bufferId;
+    m_bufRingTail++;
+    __atomic_store_n(&m_pBufRing->tail, m_bufRingTail, __ATOMIC_RELEASE);
+}
+
+TransmitStatus UringContext::receive(rx_buffer_t &buf, struct sockaddr_in &remoteAddr)
+{
+    TransmitStatus ret = { 0, 0 };
+    if (m_rxCompletions.empty())
+    {
+        reapCompletions();
+    }
+
+    while (!m_rxCompletions.empty())
+    {
+        rxCompletion_t completion = m_rxCompletions.front();
+        m_rxCompletions.pop_front();
+
+        if (completion.res < 0)
+        {
+            // Out of buffers: the datagrams wait in the socket until submit() re-arms receiving
+            if (completion.res != -ENOBUFS)
+            {
+                ret.status = static_cast<uint8_t>(-completion.res);
+                return ret;
+            }
+            continue;
+        }
+
+        if ((completion.flags & IORING_CQE_F_BUFFER) == 0)
+        {
+            continue;
+        }
+
+        uint16_t bufferId = static_cast<uint16_t>(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+        uint8_t const *pBuf = &m_rxBuffers[bufferId * RX_BUFFER_SIZE];
+        struct io_uring_recvmsg_out out;
+        memcpy(&out, pBuf, sizeof(out));
+
+        memset(&remoteAddr, 0, sizeof(remoteAddr));
+        memcpy(&remoteAddr, pBuf + sizeof(out), std::min(static_cast<size_t>(out.namelen), sizeof(remoteAddr)));
+
+        // the control messages as if received by recvmsg()
+        struct ::msghdr control;
+        memset(&control, 0, sizeof(control));
+        control.msg_control = const_cast<uint8_t *>(pBuf + sizeof(out) + m_rxMsgHdr.msg_namelen);
+        control.msg_controllen = out.controllen;
+        parseControlMessages(control, ret);
+
+        size_t payloadOffset = sizeof(out) + m_rxMsgHdr.msg_namelen + m_rxMsgHdr.msg_controllen;
+        size_t size = std::min({ static_cast<size_t>(out.payloadlen), static_cast<size_t>(completion.res) - payloadOffset, buf.size() });
+        memcpy(buf.data(), pBuf + payloadOffset, size);
+        recycleRxBuffer(bufferId);
+
+        ret.transmitBytes = size;
+        return ret;
+    }
+
+    return ret;
+}
+
+TransmitStatus UringContext::queueSend(struct sockaddr_in const &remoteAddr, payload_t const &payload)
+{
+    // All slots are in flight: let the kernel complete some of them
+    for (size_t attempt = 0; m_freeTxSlots.empty() && (attempt < 2); attempt++)
+    {
+        if (attempt == 0)
+        {
+            submit();
+            reapCompletions();
+        }
+        else
+        {
+            waitForCompletion();
+        }
+    }
+
+    if (m_freeTxSlots.empty())
+    {
+        return { 0, ENOBUFS };
+    }
+
+    uint16_t slot = m_freeTxSlots.back();
+    struct io_uring_sqe *pSqe = getSqe();
+    if (pSqe == nullptr)
+    {
+        return { 0, EBUSY };
+    }
+    m_freeTxSlots.pop_back();
+
+    txSlot_t &txSlot = m_txSlots[slot];
+    txSlot.data.assign(begin(payload), end(payload));
+    txSlot.remoteAddr = remoteAddr;
+    txSlot.iov = { txSlot.data.data(), txSlot.data.size() };
+    memset(&txSlot.msg, 0, sizeof(txSlot.msg));
+    txSlot.msg.msg_name = &txSlot.remoteAddr;
+    txSlot.msg.msg_namelen = sizeof(txSlot.remoteAddr);
+    txSlot.msg.msg_iov = &txSlot.iov;
+    txSlot.msg.msg_iovlen = 1;
+
+    pSqe->opcode = IORING_OP_SENDMSG;
+    pSqe->fd = m_socketDesc;
+    pSqe->addr = reinterpret_cast<uint64_t>(&txSlot.msg);
+    pSqe->len = 1;
+    pSqe->user_data = slot;
+
+    return { payload.size(), 0 };
+}
+
+UringTxSocket::UringTxSocket(peer_t const &peer, UringContext &context) :
+    m_peerId(peer.peerId),
+    m_context(context)
+{
+    memset(&m_remoteSockAddr, 0, sizeof(m_remoteSockAddr));
+    m_remoteSockAddr.sin_family = AF_INET;
+    m_remoteSockAddr.sin_addr.s_addr = peer.peerIpAddress;
+    m_remoteSockAddr.sin_port = htons(peer.peerUdpPort);
+}
+
+} // namespace rgc
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include <linux/io_uring.h>
+
+#include "ISocket.h"
+
+namespace rgc {
+
+// io_uring on top of the bound Udp socket of a peer, via the raw system calls. Datagrams are received by one
+// multishot recvmsg request into a ring of provided buffers registered with the kernel, so that receiving costs no
+// system call per datagram. Sent datagrams are queued as sendmsg requests and handed to the kernel in one system
+// call per iteration by submit(). Throws if the kernel does not support any of it.
+class UringContext final
+{
+public:
+    explicit UringContext(int socketDesc, unsigned numEntries = 256, unsigned numRxBuffers = 256);
+    ~UringContext();
+
+    TransmitStatus receive(rx_buffer_t &buf, struct sockaddr_in &remoteAddr);
+    // The payload is copied, the datagram is sent with the next submit()
+    TransmitStatus queueSend(struct sockaddr_in const &remoteAddr, payload_t const &payload);
+    // Hands all queued requests to the kernel, re-arms receiving if the kernel stopped it
+    void submit();
+
+    // Becomes readable when completions are pending
+    int getDescriptor() const
+    {
+        return m_ringDesc;
+    }
+
+    size_t getNumTxErrors() const
+    {
+        return m_numTxErrors;
+    }
+
+private:
+    typedef struct
+    {
+        int32_t res;
+        uint32_t flags;
+    } rxCompletion_t;
+
+    // A datagram in flight, the kernel reads it until the completion arrives
+    typedef struct
+    {
+        struct ::msghdr msg;
+        struct ::iovec iov;
+        struct ::sockaddr_in remoteAddr;
+        payload_t data;
+    } txSlot_t;
+
+    struct io_uring_sqe *getSqe();
+    void armReceive();
+    void reapCompletions();
+    void waitForCompletion();
+    void recycleRxBuffer(uint16_t bufferId);
+    void release();
+
+    int m_socketDesc;
+    int m_ringDesc;
+    void *m_pRing;
+    size_t m_ringSize;
+    struct io_uring_sqe *m_pSqes;
+    size_t m_sqesSize;
+    unsigned *m_pSqHead;
+    unsigned *m_pSqTail;
+    unsigned *m_pSqArray;
+    unsigned m_sqMask;
+    unsigned m_sqEntries;
+    unsigned m_sqTail; // local tail, published to the kernel by submit()
+    unsigned *m_pCqHead;
+    unsigned *m_pCqTail;
+    struct io_uring_cqe *m_pCqes;
+    unsigned m_cqMask;
+
+    struct io_uring_buf_ring *m_pBufRing;
+    size_t m_bufRingSize;
+    unsigned m_numRxBuffers;
+    uint16_t m_bufRingTail;
+    std::vector<uint8_t> m_rxBuffers;
+    struct ::msghdr m_rxMsgHdr;
+    bool m_isRxArmed;
+    std::deque<rxCompletion_t> m_rxCompletions;
+
+    std::vector<txSlot_t> m_txSlots;
+    std::vector<uint16_t> m_freeTxSlots;
+    size_t m_numTxErrors;
+};
+
+class UringRxSocket : public IRxSocket
+{
+public:
+    explicit UringRxSocket(UringContext &context) : m_context(context) {}
+    virtual ~UringRxSocket() {}
+
+    virtual TransmitStatus receive(rx_buffer_t &buf, struct sockaddr_in &remoteAddr) const
+    {
+        return m_context.receive(buf, remoteAddr);
+    }
+
+    virtual int getSocketDescriptor() const
+    {
+        return m_context.getDescriptor();
+    }
+
+private:
+    UringContext &m_context;
+};
+
+class UringTxSocket : public ITxSocket
+{
+public:
+    UringTxSocket(peer_t const &peer, UringContext &context);
+    virtual ~UringTxSocket() {}
+
+    virtual TransmitStatus send(payload_t const &payload) const
+    {
+        return m_context.queueSend(m_remoteSockAddr, payload);
+    }
+
+    virtual struct ::sockaddr_in const &getRemoteSocketAddr() const
+    {
+        return m_remoteSockAddr;
+    }
+
+    virtual peerId_t getPeerId() const
+    {
+        return m_peerId;
+    }
+
+private:
+    peerId_t m_peerId;
+    UringContext &m_context;
+    struct ::sockaddr_in m_remoteSockAddr;
+};
+
+} // namespace rgc
@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "Crc32c.h"
+#include "WriteAheadLog.h"
+
+using namespace std;
+using namespace std::filesystem;
+
+namespace rgc
+{
+
+// Record: 4 Bytes CRC32C of the rest, 4 Bytes body size, 1 Byte RecordType, body; in host byte order
+static constexpr size_t RECORD_CRC_SIZE = 4;
+static constexpr size_t RECORD_HEADER_SIZE = RECORD_CRC_SIZE + 4 + 1;
+static constexpr size_t RECORD_ID_SIZE = sizeof(peerId_t) + sizeof(seqNr_t);
+
+WriteAheadLog::WriteAheadLog(string const &pathPrefix, size_t segmentBytes) :
+    m_pathPrefix(pathPrefix),
+    m_segmentBytes(segmentBytes),
+    m_fd(-1),
+    m_pSegment(nullptr),
+    m_size(0),
+    m_offset(0),
+    m_syncedOffset(0),
+    m_isRolling(false)
+{
+    path prefix(pathPrefix);
+    path dir = prefix.has_parent_path() ? prefix.parent_path() : path(".");
+    string base = prefix.filename().string() + ".";
+
+    error_code ec;
+    for (auto const &entry : directory_iterator(dir, ec))
+    {
+        string name = entry.path().filename().string();
+        if ((name.size() > base.size()) && (name.compare(0, base.size(), base) == 0) &&
+            all_of(begin(name) + base.size(), end(name), [](char c) { return isdigit(static_cast<unsigned char>(c)); }))
+        {
+            m_segmentIds.push_back(static_cast<uint32_t>(stoul(name.substr(base.size()))));
+        }
+    }
+
+    if (ec)
+    {
+        throw runtime_error(fmt::format("Could not read the write-ahead log directory {}: {}.", dir.string(), ec.message()));
+    }
+
+    sort(begin(m_segmentIds), end(m_segmentIds));
+
+    messageMap_t messages;
+    watermarkMap_t watermarks;
+    for (uint32_t segmentId : m_segmentIds)
+    {
+        replaySegment(getSegmentPath(segmentId), messages, watermarks);
+    }
+
+    for (auto const &watermark : watermarks)
+    {
+        m_recoveredState.watermarks.push_back({ watermark.first, watermark.second });
+    }
+    for (auto &message : messages)
+    {
+        m_recoveredState.messages.push_back({ MessageId(message.first.first, message.first.second), std::move(message.second) });
+    }
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    (void)commit();
+    closeSegment();
+}
+
+void WriteAheadLog::replaySegment(string const &segmentPath, messageMap_t &messages, watermarkMap_t &watermarks)
+{
+    int fd = open(segmentPath.c_str(), O_RDONLY);
+    struct stat st;
+    if ((fd < 0) || (fstat(fd, &st) != 0))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        throw runtime_error(fmt::format("Could not read the write-ahead log segment {}.", segmentPath));
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void *pMap = (size > 0) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    if (pMap == MAP_FAILED)
+    {
+        throw runtime_error(fmt::format("Could not map the write-ahead log segment {}.", segmentPath));
+    }
+
+    // The records end at the first one which is torn or not written at all
+    uint8_t const *pSegment = static_cast<uint8_t const *>(pMap);
+    for (size_t pos = 0; pos + RECORD_HEADER_SIZE <= size;)
+    {
+        uint8_t const *pRecord = pSegment + pos;
+        uint32_t crc;
+        uint32_t bodySize;
+        memcpy(&crc, pRecord, sizeof(crc));
+        memcpy(&bodySize, pRecord + RECORD_CRC_SIZE, sizeof(bodySize));
+        if ((bodySize < RECORD_ID_SIZE) || (bodySize > size - pos - RECORD_HEADER_SIZE) ||
+            (crc32c(pRecord + RECORD_CRC_SIZE, RECORD_HEADER_SIZE - RECORD_CRC_SIZE + bodySize) != crc))
+        {
+            break;
+        }
+
+        RecordType type = static_cast<RecordType>(pRecord[RECORD_HEADER_SIZE - 1]);
+        uint8_t const *pBody = pRecord + RECORD_HEADER_SIZE;
+        peerId_t peerId;
+        seqNr_t seqNr;
+        memcpy(&peerId, pBody, sizeof(peerId));
+        memcpy(&seqNr, pBody + sizeof(peerId), sizeof(seqNr));
+
+        switch (type)
+        {
+            case RecordType::MESSAGE:
+                messages[{ peerId, seqNr }] = payload_t(pBody + RECORD_ID_SIZE, pBody + bodySize);
+                watermarks[peerId] = max(watermarks[peerId], seqNr + 1);
+                break;
+            case RecordType::DONE:
+                messages.erase({ peerId, seqNr });
+                break;
+            case RecordType::WATERMARK:
+                watermarks[peerId] = max(watermarks[peerId], seqNr);
+                break;
+            default:
+                break;
+        }
+
+        pos += RECORD_HEADER_SIZE + bodySize;
+    }
+
+    if (pMap != nullptr)
+    {
+        munmap(pMap, size);
+    }
+}
+
+int WriteAheadLog::logMessage(MessageId const &msgId, payload_t const &frame)
+{
+    return append(RecordType::MESSAGE, msgId, frame.data(), frame.size());
+}
+
+int WriteAheadLog::logDone(MessageId const &msgId)
+{
+    return append(RecordType::DONE, msgId, nullptr, 0);
+}
+
+int WriteAheadLog::logWatermark(peerId_t peerId, seqNr_t nextSeqNr)
+{
+    return append(RecordType::WATERMARK, MessageId(peerId, nextSeqNr), nullptr, 0);
+}
+
+int WriteAheadLog::append(RecordType type, MessageId const &msgId, uint8_t const *data, size_t size)
+{
+    size_t recordSize = RECORD_HEADER_SIZE + RECORD_ID_SIZE + size;
+    if ((m_pSegment == nullptr) && !m_isRolling)
+    {
+        int error = roll();
+        if (error != 0)
+        {
+            return error;
+        }
+    }
+
+    if (m_offset + recordSize > m_size)
+    {
+        // A snapshot must fit into its segment, as must a single large record
+        int error = m_isRolling ? 0 : roll();
+        if ((error == 0) && (m_offset + recordSize > m_size))
+        {
+            error = growSegment(max(2 * m_size, m_offset + recordSize));
+        }
+        if (error != 0)
+        {
+            return error;
+        }
+    }
+
+    uint8_t *pRecord = m_pSegment + m_offset;
+    uint32_t bodySize = static_cast<uint32_t>(RECORD_ID_SIZE + size);
+    peerId_t peerId = msgId.getPeerId();
+    seqNr_t seqNr = msgId.getSeqNr();
+    memcpy(pRecord + RECORD_CRC_SIZE, &bodySize, sizeof(bodySize));
+    pRecord[RECORD_HEADER_SIZE - 1] = static_cast<uint8_t>(type);
+    memcpy(pRecord + RECORD_HEADER_SIZE, &peerId, sizeof(peerId));
+    memcpy(pRecord + RECORD_HEADER_SIZE + sizeof(peerId), &seqNr, sizeof(seqNr));
+    if (size > 0)
+    {
+        memcpy(pRecord + RECORD_HEADER_SIZE + RECORD_ID_SIZE, data, size);
+    }
+    uint32_t crc = crc32c(pRecord + RECORD_CRC_SIZE, recordSize - RECORD_CRC_SIZE);
+    memcpy(pRecord, &crc, sizeof(crc));
+
+    m_offset += recordSize;
+    return 0;
+}
+
+int WriteAheadLog::commit()
+{
+    if ((m_pSegment == nullptr) || (m_offset == m_syncedOffset))
+    {
+        return 0;
+    }
+
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t start = m_syncedOffset & ~(pageSize - 1);
+    if (msync(m_pSegment + start, m_offset - start, MS_SYNC) != 0)
+    {
+        return errno;
+    }
+
+    m_syncedOffset = m_offset;
+    return 0;
+}
+
+int WriteAheadLog::roll()
+{
+    uint32_t segmentId = m_segmentIds.empty() ? 0 : m_segmentIds.back() + 1;
+    int error = commit();
+    closeSegment();
+    if (error == 0)
+    {
+        error = openSegment(segmentId);
+    }
+    if (error != 0)
+    {
+        return error;
+    }
+    m_segmentIds.push_back(segmentId);
+
+    m_isRolling = true;
+    if (m_snapshotWriter)
+    {
+        m_snapshotWriter();
+    }
+    m_isRolling = false;
+
+    error = commit();
+    if (error != 0)
+    {
+        return error;
+    }
+
+    // The snapshot holds all records of the previous segments which are still needed
+    for (size_t i = 0; i + 1 < m_segmentIds.size(); i++)
+    {
+        unlink(getSegmentPath(m_segmentIds[i]).c_str());
+    }
+    m_segmentIds = { segmentId };
+    return 0;
+}
+
+int WriteAheadLog::openSegment(uint32_t segmentId)
+{
+    m_fd = open(getSegmentPath(segmentId).c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0)
+    {
+        return errno;
+    }
+
+    m_offset = 0;
+    m_syncedOffset = 0;
+    int error = growSegment(m_segmentBytes);
+    if (error != 0)
+    {
+        closeSegment();
+        unlink(getSegmentPath(segmentId).c_str());
+    }
+    return error;
+}
+
+int WriteAheadLog::growSegment(size_t minBytes)
+{
+    // Allocated up front, so that a full disk fails here instead of faulting on a write to the mapping
+    int error = posix_fallocate(m_fd, 0, static_cast<off_t>(minBytes));
+    if (error != 0)
+    {
+        return error;
+    }
+
+    void *pMap = (m_pSegment == nullptr) ?
+        mmap(nullptr, minBytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0) :
+        mremap(m_pSegment, m_size, minBytes, MREMAP_MAYMOVE);
+    if (pMap == MAP_FAILED)
+    {
+        return errno;
+    }
+
+    m_pSegment = static_cast<uint8_t *>(pMap);
+    m_size = minBytes;
+    return 0;
+}
+
+void WriteAheadLog::closeSegment()
+{
+    if (m_pSegment != nullptr)
+    {
+        munmap(m_pSegment, m_size);
+        m_pSegment = nullptr;
+    }
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_size = 0;
+}
+
+string WriteAheadLog::getSegmentPath(uint32_t segmentId) const
+{
+    return fmt::format("{}.{}", m_pathPrefix, segmentId);
+}
+
+} // namespace rgc
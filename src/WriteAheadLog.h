@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CommonTypes.h"
+
+namespace rgc {
+
+// Extended sequence number expected next from an origin peer
+typedef struct
+{
+    peerId_t peerId;
+    seqNr_t nextSeqNr;
+} walWatermark_t;
+
+// Message which was not finished when the log was written last
+typedef struct
+{
+    MessageId msgId;
+    payload_t frame;
+} walMessage_t;
+
+typedef struct
+{
+    std::vector<walWatermark_t> watermarks;
+    std::vector<walMessage_t> messages; // ordered by origin peer and sequence number
+} walState_t;
+
+// Append-only log of the in-flight messages and the per-origin watermarks of a peer, so that a restarted peer resumes
+// where it stopped. Records are appended to memory mapped segment files <pathPrefix>.<n> and made durable together by
+// commit(). When a segment is full, the next one starts with a snapshot of the live state written by the snapshot
+// writer, and the older segments are deleted, which drops the records of all finished messages.
+class WriteAheadLog final
+{
+public:
+    static constexpr size_t DEFAULT_SEGMENT_BYTES = 4 * 1024 * 1024;
+
+    // Replays the segments left by a previous process. Throws if they can't be read or the directory is not writable.
+    explicit WriteAheadLog(std::string const &pathPrefix, size_t segmentBytes = DEFAULT_SEGMENT_BYTES);
+    ~WriteAheadLog();
+
+    WriteAheadLog(WriteAheadLog const &) = delete;
+    WriteAheadLog &operator=(WriteAheadLog const &) = delete;
+
+    // Hands over the state left by the previous process, as read by the constructor
+    walState_t takeRecoveredState()
+    {
+        return std::move(m_recoveredState);
+    }
+
+    // Appends all live state via the log*() functions, called when a new segment starts
+    void setSnapshotWriter(std::function<void()> snapshotWriter)
+    {
+        m_snapshotWriter = std::move(snapshotWriter);
+    }
+
+    // All return 0 or the errno of a failed file operation.
+    // A message submitted by this peer or relayed for another one; the origin's watermark follows its sequence number
+    int logMessage(MessageId const &msgId, payload_t const &frame);
+    // The message was delivered or given up
+    int logDone(MessageId const &msgId);
+    int logWatermark(peerId_t peerId, seqNr_t nextSeqNr);
+
+    // Makes the records appended since the last commit durable with one msync(), i.e. once per iteration
+    int commit();
+    // Starts a new segment with a snapshot and deletes the previous ones
+    int roll();
+
+    size_t getNumSegments() const
+    {
+        return m_segmentIds.size();
+    }
+
+    // Bytes of the records appended since the last commit
+    size_t getNumUncommittedBytes() const
+    {
+        return m_offset - m_syncedOffset;
+    }
+
+private:
+    enum class RecordType : uint8_t
+    {
+        MESSAGE = 1,   // 2 Bytes Peer-Id, 4 Bytes extended sequence number, frame
+        DONE = 2,      // 2 Bytes Peer-Id, 4 Bytes extended sequence number
+        WATERMARK = 3, // 2 Bytes Peer-Id, 4 Bytes next extended sequence number
+    };
+
+    int append(RecordType type, MessageId const &msgId, uint8_t const *data, size_t size);
+    int openSegment(uint32_t segmentId);
+    int growSegment(size_t minBytes);
+    void closeSegment();
+    std::string getSegmentPath(uint32_t segmentId) const;
+
+    typedef std::map<std::pair<peerId_t, seqNr_t>, payload_t> messageMap_t;
+    typedef std::map<peerId_t, seqNr_t> watermarkMap_t;
+
+    void replaySegment(std::string const &segmentPath, messageMap_t &messages, watermarkMap_t &watermarks);
+
+    std::string m_pathPrefix;
+    size_t m_segmentBytes;
+    walState_t m_recoveredState;
+    std::function<void()> m_snapshotWriter;
+    std::vector<uint32_t> m_segmentIds; // ascending, the last one is written
+    int m_fd;
+    uint8_t *m_pSegment;
+    size_t m_size;
+    size_t m_offset;       // end of the last record
+    size_t m_syncedOffset; // end of the last committed record
+    bool m_isRolling;
+};
+
+} // namespace rgc
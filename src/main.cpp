@@ -9,7 +9,6 @@
 
 #include "App.h"
 #include "ConfigParser.h"
-#include "UdpSocket.h"
 
 using namespace std;
 using namespace rgc; // reliable group comm
@@ -25,25 +24,12 @@ int main(int argc, char *argv[])
             return 1;
         }
 
-        // Named pipe for receiving user commands
+        // Named pipe for receiving user commands, binary command socket, and shared memory submission ring
         string pipe_path = fmt::format("/tmp/peer_pipe_{}", (*optConfig).Id);
-        // Rx Socket for receiving messages from other peers
-        auto udpRxSocket = make_unique<UdpRxSocket>((*optConfig).ipaddr, (*optConfig).udpPort);
-        vector<unique_ptr<UdpTxSocket>> udpTxSockets;
-        vector<ITxSocket *> txSockets;
-#if defined (PEER_SENDS_TO_ITSELF)
-        peer_t self { (*optConfig).Id, (*optConfig).udpPort, (*optConfig).ipaddr };
-        udpTxSockets.push_back(std::make_unique<UdpTxSocket>(self, udpRxSocket->getSocketDescriptor()));
-        txSockets.push_back(udpTxSockets.back().get());
-#endif
-        // Tx Sockets for each remote peer for sending messages
-        for (auto const &peer : (*optConfig).peers)
-        {
-            udpTxSockets.push_back(std::make_unique<UdpTxSocket>(peer, udpRxSocket->getSocketDescriptor()));
-            txSockets.push_back(udpTxSockets.back().get());
-        }    
+        string socket_path = fmt::format("/tmp/peer_sock_{}", (*optConfig).Id);
+        string ring_name = fmt::format("/peer_ring_{}", (*optConfig).Id);
+        App myApp(*optConfig, pipe_path, socket_path, ring_name);
 
-        App myApp((*optConfig).Id, udpRxSocket.get(), txSockets, (*optConfig).logFile, pipe_path, (*optConfig).bitFlipInfo);
         myApp.log(IApp::LOG_TYPE::MSG, fmt::format("Starting peer {} on {}:{}", (*optConfig).Id, (*optConfig).ipaddr_string, (*optConfig).udpPort));
         myApp.run();
         myApp.log(IApp::LOG_TYPE::MSG, fmt::format("Shutting down peer {}", (*optConfig).Id));
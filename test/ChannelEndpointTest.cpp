@@ -0,0 +1,136 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "ChannelEndpoint.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace rgc;
+
+static deliveryCallback_t collectInto(vector<string> &delivered)
+{
+    return [&delivered](delivery_t const *deliveries, size_t numDeliveries) {
+        for (size_t i = 0; i < numDeliveries; i++)
+        {
+            delivered.push_back(string(reinterpret_cast<char const *>(deliveries[i].data), deliveries[i].size));
+        }
+    };
+}
+
+TEST_CASE( "Channels of two ChannelEndpoints form independent groups on one socket each" )
+{
+    in_addr_t localhost = inet_addr("127.0.0.1");
+    vector<string> deliveredA1, deliveredA2, deliveredB1, deliveredB2;
+
+    // Peer-Ids are per channel, so the same Id may be used in both
+    vector<channelConfig_t> channelsA = {
+        { 1, 1, { { 2, 47431, localhost } }, mwConfig_t(), collectInto(deliveredA1) },
+        { 7, 5, { { 6, 47431, localhost } }, mwConfig_t(), collectInto(deliveredA2) },
+    };
+    vector<channelConfig_t> channelsB = {
+        { 1, 2, { { 1, 47430, localhost } }, mwConfig_t(), collectInto(deliveredB1) },
+        { 7, 6, { { 5, 47430, localhost } }, mwConfig_t(), collectInto(deliveredB2) },
+    };
+
+    ManualClock clock(system_clock::now());
+    ChannelEndpoint endpointA(localhost, 47430, channelsA, 2, logCallback_t(), clock);
+    ChannelEndpoint endpointB(localhost, 47431, channelsB, 2, logCallback_t(), clock);
+    REQUIRE(endpointA.getNumWorkers() == 2);
+
+    REQUIRE(endpointA.send(1, "Hello", clock.now()) == SendStatus::OK);
+    REQUIRE(endpointA.send(7, "World", clock.now()) == SendStatus::OK);
+    REQUIRE(endpointB.send(7, "Again", clock.now()) == SendStatus::OK);
+    REQUIRE_THROWS_AS(endpointA.send(2, "Nowhere", clock.now()), std::invalid_argument);
+
+    for (size_t i = 0; (i < 300) && ((deliveredB1.size() < 1) || (deliveredA2.size() < 2) || (deliveredB2.size() < 2)); i++)
+    {
+        clock.advance(milliseconds(10));
+        endpointA.poll(clock.now());
+        endpointB.poll(clock.now());
+        usleep(1000);
+    }
+
+    REQUIRE(deliveredA1 == vector<string>{ "Hello" });
+    REQUIRE(deliveredB1 == vector<string>{ "Hello" });
+    REQUIRE(deliveredA2.size() == 2);
+    REQUIRE(deliveredB2.size() == 2);
+
+    // Each channel keeps its own stats
+    REQUIRE(endpointA.getUsage(1).numTxDatagrams < endpointA.getUsage(7).numTxDatagrams);
+    REQUIRE(endpointA.getNumUnknownChannelDatagrams() == 0);
+
+    // A datagram for a channel which is not configured
+    UdpChannelTxSocket stray({ 1, 47430, localhost }, endpointB.getDescriptor(), 3);
+    REQUIRE(stray.send({ 0x00, 0x01, 0x00, 0x00, 'x', 0x00, 0x00 }).status == 0);
+    for (size_t i = 0; (i < 50) && (endpointA.getNumUnknownChannelDatagrams() == 0); i++)
+    {
+        endpointA.poll(clock.now());
+        usleep(1000);
+    }
+    REQUIRE(endpointA.getNumUnknownChannelDatagrams() == 1);
+}
+
+TEST_CASE( "ChannelEndpoint runs its channels on a worker pool" )
+{
+    in_addr_t localhost = inet_addr("127.0.0.1");
+    atomic<size_t> numDelivered[3] = { 0, 0, 0 };
+    vector<channelConfig_t> channels;
+    for (channelId_t channelId = 0; channelId < 3; channelId++)
+    {
+        channels.push_back({ channelId, 1, {}, mwConfig_t(), [&numDelivered, channelId](delivery_t const *, size_t numDeliveries) {
+            numDelivered[channelId] += numDeliveries;
+        } });
+    }
+
+    ChannelEndpoint endpoint(localhost, 47432, channels, 2);
+    thread runner([&endpoint]() { endpoint.run(); });
+
+    for (size_t i = 0; i < 10; i++)
+    {
+        REQUIRE(endpoint.send(static_cast<channelId_t>(i % 3), "Hello", system_clock::now()) == SendStatus::OK);
+    }
+    for (size_t i = 0; (i < 100) && (numDelivered[0] + numDelivered[1] + numDelivered[2] < 10); i++)
+    {
+        usleep(10000);
+    }
+
+    endpoint.stop();
+    runner.join();
+
+    REQUIRE(numDelivered[0] == 4);
+    REQUIRE(numDelivered[1] == 3);
+    REQUIRE(numDelivered[2] == 3);
+    REQUIRE(endpoint.getUsage(0).numMessages == 0);
+}
+
+TEST_CASE( "Datagrams beyond the queue limit of a channel are dropped and counted" )
+{
+    in_addr_t localhost = inet_addr("127.0.0.1");
+    vector<string> delivered;
+    vector<channelConfig_t> channels = {
+        { 1, 1, { { 2, 47434, localhost } }, mwConfig_t(), collectInto(delivered), 4 },
+        { 2, 1, { { 2, 47434, localhost } }, mwConfig_t(), collectInto(delivered) },
+    };
+    ChannelEndpoint endpoint(localhost, 47433, channels, 0);
+
+    // All datagrams are demultiplexed in one poll, before the channel runs
+    UdpChannelTxSocket remote({ 1, 47433, localhost }, endpoint.getDescriptor(), 1);
+    for (size_t i = 0; i < 10; i++)
+    {
+        REQUIRE(remote.send({ 0x00, 0x02, 0x00, 0x00, 'x', 0x00, 0x00 }).status == 0);
+    }
+    usleep(10000);
+    REQUIRE(endpoint.poll(system_clock::now()) == 10);
+
+    REQUIRE(endpoint.getNumChannelQueueDrops(1) == 6);
+    REQUIRE(endpoint.getNumChannelQueueDrops(2) == 0);
+    REQUIRE_THROWS_AS(endpoint.getNumChannelQueueDrops(3), std::invalid_argument);
+}
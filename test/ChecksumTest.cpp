@@ -1,4 +1,5 @@
 #include <catch2/catch_test_macros.hpp>
+#include "Crc32c.h"
 #include "MiddleWare.h"
 
 using namespace rgc;
@@ -56,4 +57,80 @@ TEST_CASE( "rfc1071" )
     checksum = MiddleWare::rfc1071Checksum(oddBuf, sizeof(oddBuf));
     REQUIRE(checksum == static_cast<checksum_t>(~0xf0eb));
 
-}
\ No newline at end of file
+}
+
+TEST_CASE( "The epoch of an extended sequence number is covered by the checksum" )
+{
+    uint8_t myBuf[] = { 0x00, 0x01, 0x00, 0x05, 0x41, 0x42 };
+
+    // Epoch 0 yields the checksum of a frame without extended sequence numbers
+    REQUIRE(MiddleWare::rfc1071Checksum(myBuf, sizeof(myBuf), 0) == MiddleWare::rfc1071Checksum(myBuf, sizeof(myBuf)));
+    REQUIRE(MiddleWare::rfc1071Checksum(myBuf, sizeof(myBuf), 1) != MiddleWare::rfc1071Checksum(myBuf, sizeof(myBuf)));
+
+    uint8_t frame[] = { 0x00, 0x01, 0x00, 0x05, 0x41, 0x42, 0x00, 0x00 };
+    checksum_t checksum = MiddleWare::rfc1071Checksum(frame, sizeof(frame) - 2, 2);
+    frame[6] = checksum >> 8;
+    frame[7] = checksum & 0xff;
+
+    REQUIRE(MiddleWare::verifyChecksum(frame, sizeof(frame), 2));
+    REQUIRE(MiddleWare::verifyChecksum(frame, sizeof(frame), 1) == false);
+    REQUIRE(MiddleWare::verifyChecksum(frame, sizeof(frame), 3) == false);
+}
+
+TEST_CASE( "crc32c" )
+{
+    // Check value of CRC-32C (iSCSI), RFC 3720 B.4 also has 32 Bytes of zeroes
+    uint8_t const check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    REQUIRE(crc32cTable(check, sizeof(check)) == 0xe3069283);
+    REQUIRE(crc32c(check, sizeof(check)) == 0xe3069283);
+    uint8_t const zeroes[32] = {};
+    REQUIRE(crc32c(zeroes, sizeof(zeroes)) == 0x8a9136aa);
+
+    // Hardware and table yield the same for all lengths and alignments, also in pieces
+    uint8_t buf[67];
+    for (size_t i = 0; i < sizeof(buf); i++)
+    {
+        buf[i] = static_cast<uint8_t>(i * 37 + 11);
+    }
+    for (size_t offset = 0; offset < 8; offset++)
+    {
+        for (size_t size = 0; offset + size <= sizeof(buf); size++)
+        {
+            REQUIRE(crc32c(buf + offset, size) == crc32cTable(buf + offset, size));
+        }
+    }
+    REQUIRE(crc32c(buf + 5, sizeof(buf) - 5, crc32c(buf, 5)) == crc32c(buf, sizeof(buf)));
+}
+
+TEST_CASE( "CRC32C frames detect errors the RFC 1071 checksum misses" )
+{
+    payload_t frame = { 0x00, 0x01, 0x00, 0x05, 0x41, 0x42, 0x43, 0x44 };
+    payload_t rfc1071Frame = frame;
+    MiddleWare::appendChecksum(ChecksumType::CRC32C, frame, 2);
+    MiddleWare::appendChecksum(ChecksumType::RFC1071, rfc1071Frame, 2);
+    REQUIRE(frame.size() == 8 + MiddleWare::getChecksumSize(ChecksumType::CRC32C));
+    REQUIRE(rfc1071Frame.size() == 8 + MiddleWare::getChecksumSize(ChecksumType::RFC1071));
+
+    REQUIRE(MiddleWare::verifyChecksum(ChecksumType::CRC32C, frame.data(), frame.size(), 2));
+    REQUIRE(MiddleWare::verifyChecksum(ChecksumType::CRC32C, frame.data(), frame.size(), 1) == false);
+    REQUIRE(MiddleWare::verifyChecksum(ChecksumType::RFC1071, rfc1071Frame.data(), rfc1071Frame.size(), 2));
+
+    // Swapped 16-bit words of the payload
+    std::swap(frame[4], frame[6]);
+    std::swap(frame[5], frame[7]);
+    std::swap(rfc1071Frame[4], rfc1071Frame[6]);
+    std::swap(rfc1071Frame[5], rfc1071Frame[7]);
+    REQUIRE(MiddleWare::verifyChecksum(ChecksumType::RFC1071, rfc1071Frame.data(), rfc1071Frame.size(), 2));
+    REQUIRE(MiddleWare::verifyChecksum(ChecksumType::CRC32C, frame.data(), frame.size(), 2) == false);
+}
+
+TEST_CASE( "Wire sequence numbers are extended relative to the expected sequence number" )
+{
+    REQUIRE(MiddleWare::extendSeqNr(0x00000010, 0x0012) == 0x00000012);
+    REQUIRE(MiddleWare::extendSeqNr(0x00000012, 0x0010) == 0x00000010);
+    // wrap-around of the wire sequence number into the next epoch...
+    REQUIRE(MiddleWare::extendSeqNr(0x0001fff0, 0x0005) == 0x00020005);
+    // ...and a late frame of the previous epoch
+    REQUIRE(MiddleWare::extendSeqNr(0x00020005, 0xfff0) == 0x0001fff0);
+    REQUIRE(MiddleWare::getEpoch(0x0001fff0) == 1);
+}
@@ -0,0 +1,112 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "CommandSocket.h"
+
+using namespace std;
+using namespace rgc;
+
+static const string TEST_SOCKET_PATH = "/tmp/peer_sock_test";
+
+static int connectClient(string const &path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int desc = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    REQUIRE(desc >= 0);
+    REQUIRE(connect(desc, reinterpret_cast<struct sockaddr const *>(&addr), sizeof(addr)) == 0);
+    return desc;
+}
+
+static void appendFrame(vector<uint8_t> &record, CommandType type, string const &content)
+{
+    record.push_back(static_cast<uint8_t>(type));
+    record.push_back(content.size() >> 8);
+    record.push_back(content.size() & 0xff);
+    record.insert(end(record), begin(content), end(content));
+}
+
+typedef struct
+{
+    CommandType type;
+    string content;
+    int clientDesc;
+} receivedCommand_t;
+
+TEST_CASE( "Command socket accepts several clients which batch frames into records" )
+{
+    CommandSocket commandSocket(TEST_SOCKET_PATH);
+    vector<receivedCommand_t> received;
+    auto handler = [&](command_t const &command) {
+        received.push_back({ command.type, string(reinterpret_cast<char const *>(command.data), command.size), command.clientDesc });
+    };
+
+    int client1 = connectClient(TEST_SOCKET_PATH);
+    int client2 = connectClient(TEST_SOCKET_PATH);
+
+    vector<uint8_t> record;
+    appendFrame(record, CommandType::SEND, "foo bar");
+    appendFrame(record, CommandType::SEND, string("\x00\x01\xff", 3));
+    appendFrame(record, CommandType::STATS, "");
+    REQUIRE(send(client1, record.data(), record.size(), 0) == static_cast<ssize_t>(record.size()));
+
+    record.clear();
+    appendFrame(record, CommandType::STOP, "");
+    REQUIRE(send(client2, record.data(), record.size(), 0) == static_cast<ssize_t>(record.size()));
+
+    REQUIRE(commandSocket.receive(handler) == 0);
+    REQUIRE(commandSocket.getDescriptors().size() == 3);
+    REQUIRE(received.size() == 4);
+    REQUIRE(received[0].type == CommandType::SEND);
+    REQUIRE(received[0].content == "foo bar");
+    REQUIRE(received[1].content == string("\x00\x01\xff", 3));
+    REQUIRE(received[2].type == CommandType::STATS);
+    REQUIRE(received[3].type == CommandType::STOP);
+    REQUIRE(received[0].clientDesc != received[3].clientDesc);
+
+    // A reply reaches the client which sent the command
+    uint8_t replyContent[] = { 0x01, 0x02 };
+    REQUIRE(commandSocket.reply(received[2].clientDesc, CommandType::STATS, replyContent, sizeof(replyContent)));
+    uint8_t replyBuf[16];
+    REQUIRE(recv(client1, replyBuf, sizeof(replyBuf), 0) == 5);
+    REQUIRE(replyBuf[0] == static_cast<uint8_t>(CommandType::STATS));
+    REQUIRE(replyBuf[2] == 2);
+
+    // Closed clients are dropped
+    close(client2);
+    received.clear();
+    REQUIRE(commandSocket.receive(handler) == 0);
+    REQUIRE(commandSocket.getDescriptors().size() == 2);
+
+    close(client1);
+}
+
+TEST_CASE( "Command socket drops records with broken framing completely" )
+{
+    CommandSocket commandSocket(TEST_SOCKET_PATH);
+    vector<CommandType> received;
+    auto handler = [&](command_t const &command) { received.push_back(command.type); };
+
+    int client = connectClient(TEST_SOCKET_PATH);
+
+    vector<uint8_t> record;
+    appendFrame(record, CommandType::SEND, "valid");
+    // announces 16 Bytes of content, but has only one
+    record.insert(end(record), { static_cast<uint8_t>(CommandType::SEND), 0x00, 0x10, 'x' });
+    REQUIRE(send(client, record.data(), record.size(), 0) == static_cast<ssize_t>(record.size()));
+
+    REQUIRE(commandSocket.receive(handler) == 1);
+    REQUIRE(received.empty());
+
+    close(client);
+}
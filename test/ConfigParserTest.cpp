@@ -0,0 +1,104 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+
+#include "ConfigParser.h"
+
+using namespace std;
+using namespace rgc;
+
+static constexpr char const *CONFIG_PATH = "/tmp/peer_config_test.cfg";
+
+static optional<config_t> loadConfig(string const &content)
+{
+    {
+        ofstream ofs(CONFIG_PATH);
+        ofs << content;
+    }
+    char const *args[] = { "PeerTest", "-c", CONFIG_PATH };
+    optind = 1;
+    optional<config_t> ret = getConfigFromOptions(3, const_cast<char **>(args));
+    unlink(CONFIG_PATH);
+    return ret;
+}
+
+TEST_CASE( "Config file with comments, blanks and options is loaded" )
+{
+    auto optConfig = loadConfig(
+        "# peer Id, peer IP address, peer Udp port\n"
+        "\n"
+        "2,127.0.0.1,4202\n"
+        " 3 , 127.0.0.1 , 4203\r\n"
+        "dissemination = gossip\n"
+        "heartbeat_interval_ms=100\n"
+        "socket_rcvbuf_bytes=4194304\n"
+        "checksum=crc32c\n"
+        "reliability=nack\n"
+        "fec_block_size=8\n"
+        "priority_lanes=on\n"
+        "pace_peer_packets_per_sec=1000\n"
+        "pace_burst_ms=5\n"
+        "4,127.0.0.2,4202");
+
+    REQUIRE(optConfig.has_value());
+    REQUIRE(optConfig->peers.size() == 3);
+    REQUIRE(optConfig->peers[1].peerId == 3);
+    REQUIRE(optConfig->peers[1].peerIpAddress == inet_addr("127.0.0.1"));
+    REQUIRE(optConfig->peers[1].peerUdpPort == 4203);
+    REQUIRE(optConfig->peers[2].peerIpAddress == inet_addr("127.0.0.2"));
+    REQUIRE(optConfig->mwConfig.dissemination == Dissemination::GOSSIP);
+    REQUIRE(optConfig->mwConfig.heartbeatInterval.count() == 100);
+    REQUIRE(optConfig->mwConfig.socketRcvBufBytes == 4194304);
+    REQUIRE(optConfig->mwConfig.socketSndBufBytes == 0);
+    REQUIRE(optConfig->mwConfig.checksumType == ChecksumType::CRC32C);
+    REQUIRE(optConfig->mwConfig.reliability == Reliability::NACK);
+    REQUIRE(optConfig->mwConfig.statusInterval.count() == 100);
+    REQUIRE(optConfig->mwConfig.fecBlockSize == 8);
+    REQUIRE(optConfig->mwConfig.priorityLanes);
+    REQUIRE(optConfig->mwConfig.pacePeerPacketsPerSec == 1000);
+    REQUIRE(optConfig->mwConfig.paceBytesPerSec == 0);
+    REQUIRE(optConfig->mwConfig.paceBurst.count() == 5);
+}
+
+TEST_CASE( "Config file with duplicate peers is rejected" )
+{
+    REQUIRE_FALSE(loadConfig("2,127.0.0.1,4202\n3,127.0.0.1,4203\n2,127.0.0.1,4204\n").has_value());
+    REQUIRE_FALSE(loadConfig("2,127.0.0.1,4202\n3,127.0.0.1,4202\n").has_value());
+}
+
+TEST_CASE( "Config file with malformed lines is rejected" )
+{
+    REQUIRE(loadConfig("2,127.0.0.1,4202\n").has_value());
+    REQUIRE_FALSE(loadConfig("2,127.0.0.1\n").has_value());
+    REQUIRE_FALSE(loadConfig("2,127.0.0.1,4202,1\n").has_value());
+    REQUIRE_FALSE(loadConfig("x,127.0.0.1,4202\n").has_value());
+    REQUIRE_FALSE(loadConfig("2,127.0.0.256,4202\n").has_value());
+    REQUIRE_FALSE(loadConfig("2,127.0.0.1,80\n").has_value());
+    REQUIRE_FALSE(loadConfig("2,127.0.0.1,70000\n").has_value());
+    REQUIRE_FALSE(loadConfig("no_such_option=1\n").has_value());
+    REQUIRE_FALSE(loadConfig("heartbeat_interval_ms=abc\n").has_value());
+    REQUIRE_FALSE(loadConfig("reliability=maybe\n").has_value());
+    REQUIRE_FALSE(loadConfig("fec_block_size=1\n").has_value());
+    REQUIRE_FALSE(loadConfig("fec_block_size=256\n").has_value());
+    REQUIRE_FALSE(loadConfig("priority_lanes=yes\n").has_value());
+    REQUIRE_FALSE(loadConfig("pace_burst_ms=0\n").has_value());
+}
+
+TEST_CASE( "Config file with ten thousand peers is loaded" )
+{
+    string content;
+    for (uint16_t i = 0; i < 10000; i++)
+    {
+        content += to_string(i + 2) + ",10.0.0." + to_string(i % 200 + 1) + "," + to_string(2000 + i) + "\n";
+    }
+
+    auto optConfig = loadConfig(content);
+    REQUIRE(optConfig.has_value());
+    REQUIRE(optConfig->peers.size() == 10000);
+    REQUIRE(optConfig->peers.back().peerId == 10001);
+    REQUIRE(optConfig->peers.back().peerUdpPort == 11999);
+}
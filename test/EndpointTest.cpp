@@ -0,0 +1,166 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "Endpoint.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace rgc;
+
+static config_t makeLoopbackConfig(uint16_t udpPort)
+{
+    config_t config { 1, "127.0.0.1", inet_addr("127.0.0.1"), udpPort, "", "", "", {}, {}, {}, std::nullopt, IoBackend::SOCKET, { false, 0, -1, 0 }, "", false };
+    return config;
+}
+
+TEST_CASE( "Endpoint delivers a batch of payload views without header and checksum" )
+{
+    vector<pair<MessageId, string>> delivered;
+    size_t numBatches = 0;
+    Endpoint endpoint(makeLoopbackConfig(47391), [&](delivery_t const *deliveries, size_t numDeliveries) {
+        numBatches++;
+        for (size_t i = 0; i < numDeliveries; i++)
+        {
+            delivered.push_back({ deliveries[i].msgId, string(reinterpret_cast<char const *>(deliveries[i].data), deliveries[i].size) });
+        }
+    });
+
+    REQUIRE(endpoint.getDescriptors().size() == 1);
+    REQUIRE(endpoint.getNextTimeout() == system_clock::time_point::max());
+
+    auto now = system_clock::now();
+    REQUIRE(endpoint.send("Hello", now) == SendStatus::OK);
+    REQUIRE(endpoint.send("World", now) == SendStatus::OK);
+    // New messages are due immediately
+    REQUIRE(endpoint.getNextTimeout() <= now);
+
+    for (size_t i = 0; (i < 50) && delivered.empty(); i++)
+    {
+        endpoint.poll(system_clock::now());
+        usleep(10000);
+    }
+
+    // Without remote peers, the ACKs of our own messages arrive in the same iteration
+    REQUIRE(numBatches == 1);
+    REQUIRE(delivered.size() == 2);
+    REQUIRE(delivered[0].first == MessageId(1, 0));
+    REQUIRE(delivered[0].second == "Hello");
+    REQUIRE(delivered[1].first == MessageId(1, 1));
+    REQUIRE(delivered[1].second == "World");
+    REQUIRE(endpoint.getMiddleWare().getNumPendingTxMessages() == 0);
+}
+
+TEST_CASE( "Endpoints exchange messages in CRC32C frames" )
+{
+    vector<string> delivered2;
+    config_t config1 = makeLoopbackConfig(47404);
+    config1.mwConfig.checksumType = ChecksumType::CRC32C;
+    config1.peers = { { 2, 47405, inet_addr("127.0.0.1") } };
+    config_t config2 = config1;
+    config2.Id = 2;
+    config2.udpPort = 47405;
+    config2.peers = { { 1, 47404, inet_addr("127.0.0.1") } };
+
+    Endpoint endpoint1(config1, [](delivery_t const *, size_t) {});
+    Endpoint endpoint2(config2, [&](delivery_t const *deliveries, size_t numDeliveries) {
+        for (size_t i = 0; i < numDeliveries; i++)
+        {
+            delivered2.push_back(string(reinterpret_cast<char const *>(deliveries[i].data), deliveries[i].size));
+        }
+    });
+
+    // The remote peer gets the message after the one second stagger
+    ManualClock clock(system_clock::now());
+    REQUIRE(endpoint1.send("Hello", clock.now()) == SendStatus::OK);
+    for (size_t i = 0; (i < 300) && delivered2.empty(); i++)
+    {
+        clock.advance(milliseconds(10));
+        endpoint1.poll(clock.now());
+        endpoint2.poll(clock.now());
+        usleep(1000);
+    }
+
+    REQUIRE(delivered2 == vector<string>{ "Hello" });
+}
+
+TEST_CASE( "Endpoint applies a new peer list in place" )
+{
+    config_t config = makeLoopbackConfig(47395);
+    config.peers = { { 2, 47396, inet_addr("127.0.0.1") }, { 3, 47397, inet_addr("127.0.0.1") } };
+    Endpoint endpoint(config, [](delivery_t const *, size_t) {});
+
+    auto now = system_clock::now();
+    REQUIRE(endpoint.send("Hello", now) == SendStatus::OK);
+    endpoint.poll(now);
+    REQUIRE(endpoint.getUsage().numMessages == 1);
+
+    // Unchanged list
+    REQUIRE(endpoint.updatePeers(config.peers) == 0);
+    // Peer 3 leaves, peer 4 joins, peer 2 moves to another port
+    REQUIRE(endpoint.updatePeers({ { 2, 47398, inet_addr("127.0.0.1") }, { 4, 47399, inet_addr("127.0.0.1") } }) == 4);
+    REQUIRE(endpoint.updatePeers({ { 2, 47398, inet_addr("127.0.0.1") }, { 4, 47399, inet_addr("127.0.0.1") } }) == 0);
+
+    // The message no longer waits for the departed peers, only for ourselves
+    for (size_t i = 0; (i < 20) && (endpoint.getUsage().numMessages > 0); i++)
+    {
+        usleep(10000);
+        endpoint.poll(system_clock::now());
+    }
+    REQUIRE(endpoint.getUsage().numMessages == 0);
+}
+
+TEST_CASE( "Endpoint measures the round trip time with kernel timestamps" )
+{
+    size_t numDelivered = 0;
+    Endpoint endpoint(makeLoopbackConfig(47401), [&](delivery_t const *, size_t numDeliveries) { numDelivered += numDeliveries; });
+    REQUIRE_FALSE(endpoint.getRtt(1).has_value());
+
+    REQUIRE(endpoint.send("Hello", system_clock::now()) == SendStatus::OK);
+    for (size_t i = 0; (i < 50) && (numDelivered == 0); i++)
+    {
+        endpoint.poll(system_clock::now());
+        usleep(10000);
+    }
+    REQUIRE(numDelivered == 1);
+
+    // The message to ourselves and its ACK were received with timestamps
+    mwUsage_t usage = endpoint.getUsage();
+    REQUIRE(usage.numRxTimestamps >= 2);
+    REQUIRE(usage.rxDelayNsMax >= usage.rxDelayNsSum / usage.numRxTimestamps);
+
+    auto optRtt = endpoint.getRtt(1);
+    REQUIRE(optRtt.has_value());
+    REQUIRE(optRtt->numSamples == 1);
+    REQUIRE(optRtt->srtt > nanoseconds(0));
+    REQUIRE(optRtt->srtt < milliseconds(100));
+    REQUIRE(optRtt->rttVar == optRtt->srtt / 2);
+}
+
+TEST_CASE( "Endpoint counts the datagrams the kernel dropped for a full receive buffer" )
+{
+    config_t config = makeLoopbackConfig(47402);
+    config.mwConfig.socketRcvBufBytes = 4096;
+    Endpoint endpoint(config, [](delivery_t const *, size_t) {});
+
+    // Flood the small buffer while the endpoint does not poll
+    UdpRxSocket sender(inet_addr("127.0.0.1"), 47403);
+    UdpTxSocket txSocket({ 2, 47402, inet_addr("127.0.0.1") }, sender.getSocketDescriptor());
+    for (size_t i = 0; i < 200; i++)
+    {
+        (void)txSocket.send(payload_t(100, 0x55));
+    }
+
+    REQUIRE(endpoint.poll(system_clock::now()) > 0);
+    while (endpoint.poll(system_clock::now()) > 0) {}
+
+    // The kernel reports drops with the first datagram queued after them
+    (void)txSocket.send(payload_t(100, 0x55));
+    REQUIRE(endpoint.poll(system_clock::now()) == 1);
+    REQUIRE(endpoint.getUsage().numRxQueueDrops > 0);
+    REQUIRE(endpoint.getUsage().numRxQueueDrops < 200);
+}
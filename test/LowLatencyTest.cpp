@@ -0,0 +1,45 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <sched.h>
+
+#include "LowLatency.h"
+
+using namespace rgc;
+
+TEST_CASE( "Backoff spins, then pauses, then yields until it is reset" )
+{
+    Backoff backoff;
+    for (uint32_t i = 0; i < Backoff::SPIN_LIMIT; i++)
+    {
+        backoff.idle();
+    }
+    REQUIRE(backoff.getNumIdle() == Backoff::SPIN_LIMIT);
+
+    for (uint32_t i = 0; i < 2 * Backoff::PAUSE_LIMIT; i++)
+    {
+        backoff.idle();
+    }
+    // yielding from here on
+    REQUIRE(backoff.getNumIdle() == Backoff::PAUSE_LIMIT);
+
+    backoff.reset();
+    REQUIRE(backoff.getNumIdle() == 0);
+}
+
+TEST_CASE( "Thread is pinned to a CPU" )
+{
+    cpu_set_t allowed;
+    REQUIRE(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+    int cpu = 0;
+    while (!CPU_ISSET(cpu, &allowed))
+    {
+        cpu++;
+    }
+
+    REQUIRE(pinToCpu(cpu) == 0);
+    REQUIRE(sched_getcpu() == cpu);
+    REQUIRE(pinToCpu(CPU_SETSIZE - 1) != 0);
+
+    // other tests may run anywhere again
+    REQUIRE(sched_setaffinity(0, sizeof(allowed), &allowed) == 0);
+}
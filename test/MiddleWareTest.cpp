@@ -2,6 +2,7 @@
 #include <memory>
 #include <vector>
 #include "CommonTypes.h"
+#include "Compression.h"
 #include "TestEnvironment.h"
 
 using namespace std;
@@ -49,16 +50,33 @@ namespace rgc
         return ret;
     }
 
+    static sender_payload_t mkRxDeflatedPayload(peer_t const &sender, seqNr_t seqNr, payload_t const &deflated, size_t inflatedSize)
+    {
+        sender_payload_t ret;
+        ret.payload.push_back(sender.peerId >> 8 );
+        ret.payload.push_back(sender.peerId & 0xff );
+        ret.payload.push_back(seqNr >> 8 );
+        ret.payload.push_back(seqNr & 0xff );
+        ret.payload.push_back(FRAME_FLAG_DEFLATED);
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            ret.payload.push_back((inflatedSize >> shift) & 0xff);
+        }
+        ret.payload.insert(end(ret.payload), begin(deflated), end(deflated));
+        MiddleWare::appendChecksum(ChecksumType::RFC1071, ret.payload);
 
+        ret.peer = sender;
+        return ret;
+    }
 
     class Peers
     {
     public:
-        Peers(std::vector<peer_t> peers) : 
+        Peers(std::vector<peer_t> peers, mwConfig_t const &mwConfig = mwConfig_t()) : 
             txSocks(mkTxSocks(peers)),
             rxSocket(),
             txISocks(mkITxSocks(txSocks)),
-            app(&rxSocket, txISocks)
+            app(&rxSocket, txISocks, 10, mwConfig)
         {}
         
         vector<TestTxSocket> txSocks;
@@ -336,4 +354,844 @@ namespace rgc
         REQUIRE(p.txSocks[0].m_sentPayloads.size() == 3);
         REQUIRE(p.app.deliveredMsgs.size() == 1);
     }
-}
\ No newline at end of file
+
+    TEST_CASE( "A message of a different sequence number epoch must be discarded", "MiddleWare" )
+    {
+        // One peer
+        Peers p({PEER_1});
+
+        // Checksum calculated for epoch 1, i.e. the message is 2^16 messages ahead of what we expect
+        sender_payload_t futureEpoch = mkRxPayload(PEER_1, 1, "test");
+        futureEpoch.payload.resize(futureEpoch.payload.size() - 2);
+        checksum_t checksum = MiddleWare::rfc1071Checksum(futureEpoch.payload.data(), futureEpoch.payload.size(), 1);
+        futureEpoch.payload.push_back(checksum >> 8);
+        futureEpoch.payload.push_back(checksum & 0xff);
+
+        p.rxSocket.m_receivedPayloads.push_back(futureEpoch);
+        p.app.numLoops(100).run();
+        // Neither acknowledged nor relayed nor delivered
+        REQUIRE(p.txSocks[0].m_sentPayloads.empty());
+        REQUIRE(p.app.deliveredMsgs.empty());
+    }
+
+    static sender_payload_t mkRxDigestPayload(peer_t const &sender, peerId_t originPeerId, seqNr_t nextSeqNr)
+    {
+        sender_payload_t ret;
+        ret.payload = { 0xff, 0xff, static_cast<uint8_t>(ControlType::DIGEST), 
+            static_cast<uint8_t>(originPeerId >> 8), static_cast<uint8_t>(originPeerId & 0xff),
+            static_cast<uint8_t>(nextSeqNr >> 24), static_cast<uint8_t>((nextSeqNr >> 16) & 0xff),
+            static_cast<uint8_t>((nextSeqNr >> 8) & 0xff), static_cast<uint8_t>(nextSeqNr & 0xff) };
+        checksum_t checksum = MiddleWare::rfc1071Checksum(ret.payload.data(), ret.payload.size());
+        ret.payload.push_back(checksum >> 8);
+        ret.payload.push_back(checksum & 0xff);
+        ret.peer = sender;
+        return ret;
+    }
+
+    TEST_CASE( "In gossip mode, a message is relayed to fan-out peers only", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.dissemination = Dissemination::GOSSIP;
+        mwConfig.gossipFanOut = 1;
+        mwConfig.antiEntropyInterval = std::chrono::milliseconds(100000);
+        Peers p({PEER_1, PEER_2, PEER_3}, mwConfig);
+
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0, "test"));
+        p.app.numLoops(1).run();
+        // The digest of the first loop goes to one of the peers
+        size_t numSent = p.txSocks[0].m_sentPayloads.size() + p.txSocks[1].m_sentPayloads.size() + p.txSocks[2].m_sentPayloads.size();
+        // ACK to peer 1, relay to peer 2 or 3, digest to one of the peers
+        REQUIRE(numSent == 3);
+
+        // Sender of the message is excluded from relaying
+        p.app.numLoops(20).run();
+        REQUIRE(p.txSocks[1].m_sentPayloads.size() + p.txSocks[2].m_sentPayloads.size() >= 1);
+        size_t numRelayedToPeer1 = std::count(begin(p.txSocks[0].m_sentPayloads), end(p.txSocks[0].m_sentPayloads), mkRxPayload(PEER_1, 0, "test").payload);
+        REQUIRE(numRelayedToPeer1 == 0);
+    }
+
+    TEST_CASE( "In gossip mode, messages missing in a digest are pushed to its sender", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.dissemination = Dissemination::GOSSIP;
+        mwConfig.antiEntropyInterval = std::chrono::milliseconds(100000);
+        Peers gossip({PEER_1, PEER_2}, mwConfig);
+        gossip.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0, "test"));
+        gossip.app.numLoops(1).run();
+        gossip.txSocks[1].m_sentPayloads.clear();
+
+        // Peer 2 did not get anything from peer 1 yet
+        gossip.rxSocket.m_receivedPayloads.push_back(mkRxDigestPayload(PEER_2, PEER_1.peerId, 0));
+        gossip.app.numLoops(1).run();
+        REQUIRE(gossip.txSocks[1].m_sentPayloads.size() == 1);
+        REQUIRE(gossip.txSocks[1].m_sentPayloads[0] == mkRxPayload(PEER_1, 0, "test").payload);
+
+        // Peer 2 already has the message
+        gossip.rxSocket.m_receivedPayloads.push_back(mkRxDigestPayload(PEER_2, PEER_1.peerId, 1));
+        gossip.app.numLoops(1).run();
+        REQUIRE(gossip.txSocks[1].m_sentPayloads.size() == 1);
+    }
+
+    TEST_CASE( "In gossip mode, retained messages evicted before all digests covered them are counted", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.dissemination = Dissemination::GOSSIP;
+        mwConfig.antiEntropyInterval = std::chrono::milliseconds(100000);
+        mwConfig.gossipRetention = 2;
+        Peers gossip({PEER_1, PEER_2}, mwConfig);
+
+        // Peer 2 sent no digest yet, so it may still miss message 0
+        for (seqNr_t seqNr = 0; seqNr < 3; seqNr++)
+        {
+            gossip.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, seqNr, "test"));
+            gossip.app.numLoops(1).run();
+        }
+        REQUIRE(gossip.app.getMiddleWare().getUsage().numUnconfirmedEvictions == 1);
+
+        // The digest of peer 2 covers message 1, the origin of the messages is not asked
+        gossip.rxSocket.m_receivedPayloads.push_back(mkRxDigestPayload(PEER_2, PEER_1.peerId, 2));
+        gossip.app.numLoops(1).run();
+        gossip.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 3, "test"));
+        gossip.app.numLoops(1).run();
+        REQUIRE(gossip.app.getMiddleWare().getUsage().numUnconfirmedEvictions == 1);
+
+        gossip.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 4, "test"));
+        gossip.app.numLoops(1).run();
+        REQUIRE(gossip.app.getMiddleWare().getUsage().numUnconfirmedEvictions == 2);
+    }
+
+    TEST_CASE( "With a multicast group, the first transmission is multicast and retransmissions are unicast", "MiddleWare" )
+    {
+        static const peer_t GROUP = { CONTROL_PEER_ID, 4300, inet_addr("239.255.42.1") };
+        Peers p({PEER_1, PEER_2, PEER_3});
+        TestRxSocket mcastRxSocket;
+        TestTxSocket mcastTxSocket(GROUP);
+        p.app.getMiddleWare().setMulticastSockets(&mcastRxSocket, &mcastTxSocket);
+
+        // Relayed messages arrive via the group as well
+        mcastRxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0, "test"));
+        p.app.numLoops(1).run();
+        // One multicast relay, and the ACK to peer 1 via unicast
+        REQUIRE(mcastTxSocket.m_sentPayloads.size() == 1);
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 1);
+        REQUIRE(p.txSocks[1].m_sentPayloads.size() == 0);
+        REQUIRE(p.txSocks[2].m_sentPayloads.size() == 0);
+
+        // Peers 1 and 2 acknowledge
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0));
+        p.rxSocket.m_receivedPayloads.push_back(mkRxResendPayload(PEER_2, PEER_1, 0));
+        p.app.numLoops(10).run();
+        // Only peer 3 gets a unicast retransmission
+        REQUIRE(mcastTxSocket.m_sentPayloads.size() == 1);
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 1);
+        REQUIRE(p.txSocks[1].m_sentPayloads.size() == 0);
+        REQUIRE(p.txSocks[2].m_sentPayloads.size() == 1);
+        REQUIRE(p.app.deliveredMsgs.empty());
+
+        p.rxSocket.m_receivedPayloads.push_back(mkRxResendPayload(PEER_3, PEER_1, 0));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.deliveredMsgs.size() == 1);
+    }
+
+    TEST_CASE( "Sending is blocked while the in-flight budget of our own messages is exhausted", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.maxInFlightPerOrigin = 1;
+        Peers p({PEER_1}, mwConfig);
+
+        REQUIRE(p.app.getMiddleWare().sendMessage("first", std::chrono::system_clock::time_point()) == SendStatus::OK);
+        REQUIRE(p.app.getMiddleWare().sendMessage("second", std::chrono::system_clock::time_point()) == SendStatus::WOULD_BLOCK);
+
+        mwUsage_t usage = p.app.getMiddleWare().getUsage();
+        REQUIRE(usage.numMessages == 1);
+        REQUIRE(usage.payloadBytes == 5 + 6);
+        REQUIRE(usage.stateBytes >= usage.payloadBytes);
+        REQUIRE(usage.maxInFlightOfOrigin == 1);
+        REQUIRE(usage.numBlockedSends == 1);
+
+        // Once the first message is acknowledged, the budget is available again
+        p.app.numLoops(1).run();
+        p.rxSocket.m_receivedPayloads.push_back(mkRxResendPayload(PEER_1, { OWN_PEER_ID, 0, 0 }, 0));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.getMiddleWare().getUsage().numMessages == 0);
+        REQUIRE(p.app.getMiddleWare().getUsage().payloadBytes == 0);
+        REQUIRE(p.app.getMiddleWare().getUsage().stateBytes == 0);
+        REQUIRE(p.app.getMiddleWare().sendMessage("second", std::chrono::system_clock::time_point()) == SendStatus::OK);
+    }
+
+    TEST_CASE( "With relay policy defer, messages of other peers exceeding the budget are not acknowledged", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.maxPayloadBytes = 12;
+        mwConfig.relayPolicy = RelayPolicy::DEFER;
+        Peers p({PEER_1}, mwConfig);
+
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0, "first"));
+        p.app.numLoops(1).run();
+        // ACK and relay
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 2);
+
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 1, "second"));
+        p.app.numLoops(1).run();
+        // Neither ACK nor relay
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 2);
+        REQUIRE(p.app.getMiddleWare().getUsage().numDeferredRelays == 1);
+
+        // Once the first message is delivered, the retransmitted second one gets accepted
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.deliveredMsgs.size() == 1);
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 1, "second"));
+        p.app.numLoops(1).run();
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 4);
+    }
+
+    static sender_payload_t mkRxHeartbeatPayload(peer_t const &sender)
+    {
+        sender_payload_t ret;
+        ret.payload = { 0xff, 0xff, static_cast<uint8_t>(ControlType::HEARTBEAT) };
+        checksum_t checksum = MiddleWare::rfc1071Checksum(ret.payload.data(), ret.payload.size());
+        ret.payload.push_back(checksum >> 8);
+        ret.payload.push_back(checksum & 0xff);
+        ret.peer = sender;
+        return ret;
+    }
+
+    static size_t numDataMessages(vector<payload_t> const &sentPayloads)
+    {
+        return std::count_if(begin(sentPayloads), end(sentPayloads), 
+            [](auto const &payload) { return (payload[0] != 0xff) && (payload.size() > 6); });
+    }
+
+    TEST_CASE( "Suspected peers are excluded from relaying and rejoin once heard from", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.heartbeatInterval = std::chrono::milliseconds(100);
+        mwConfig.suspectTimeout = std::chrono::milliseconds(500);
+        Peers p({PEER_1, PEER_2}, mwConfig);
+
+        // Both peers get our heartbeats, only peer 1 sends its ones
+        for (size_t i = 0; i < 10; i++)
+        {
+            p.rxSocket.m_receivedPayloads.push_back(mkRxHeartbeatPayload(PEER_1));
+            p.app.numLoops(1).run();
+        }
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 10);
+        REQUIRE(p.txSocks[1].m_sentPayloads.size() == 10);
+        REQUIRE(p.txSocks[1].m_sentPayloads[0] == mkRxHeartbeatPayload(PEER_2).payload);
+
+        // Peer 2 is suspected: the message goes to peer 1 only, and gets delivered after its ACK
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0, "test"));
+        p.app.numLoops(1).run();
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0));
+        p.app.numLoops(20).run();
+        REQUIRE(numDataMessages(p.txSocks[0].m_sentPayloads) == 1);
+        REQUIRE(numDataMessages(p.txSocks[1].m_sentPayloads) == 0);
+        REQUIRE(p.app.deliveredMsgs.size() == 1);
+
+        // Peer 2 is back
+        p.rxSocket.m_receivedPayloads.push_back(mkRxHeartbeatPayload(PEER_2));
+        p.app.numLoops(1).run();
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 1, "test2"));
+        for (size_t i = 0; i < 11; i++)
+        {
+            p.rxSocket.m_receivedPayloads.push_back(mkRxHeartbeatPayload(PEER_1));
+            p.rxSocket.m_receivedPayloads.push_back(mkRxHeartbeatPayload(PEER_2));
+            p.app.numLoops(1).run();
+            // deferred by one second
+            REQUIRE(numDataMessages(p.txSocks[1].m_sentPayloads) == ((i < 10) ? 0 : 1));
+        }
+    }
+
+    TEST_CASE( "Suspecting a peer stops waiting for its ACKs", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.heartbeatInterval = std::chrono::milliseconds(100);
+        mwConfig.suspectTimeout = std::chrono::milliseconds(500);
+        Peers p({PEER_1, PEER_2}, mwConfig);
+
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0, "test"));
+        p.app.numLoops(1).run();
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.deliveredMsgs.empty());
+
+        // Peer 1 keeps sending heartbeats, peer 2 is silent
+        for (size_t i = 0; i < 5; i++)
+        {
+            p.rxSocket.m_receivedPayloads.push_back(mkRxHeartbeatPayload(PEER_1));
+            p.app.numLoops(1).run();
+        }
+        // Way before the four retransmissions to peer 2 would be over
+        REQUIRE(p.app.deliveredMsgs.size() == 1);
+    }
+
+    TEST_CASE( "Peers join and leave the group at runtime", "MiddleWare" )
+    {
+        TestTxSocket txSock3(PEER_3);
+        Peers p({PEER_1, PEER_2});
+
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0, "test"));
+        p.app.numLoops(1).run();
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.deliveredMsgs.empty());
+
+        // Waiting for the ACK of peer 2 ends right away when it leaves
+        p.app.getMiddleWare().removePeer(PEER_2.peerId);
+        REQUIRE(p.txISocks.size() == 1);
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.deliveredMsgs.size() == 1);
+        REQUIRE(p.app.getMiddleWare().getUsage().numMessages == 0);
+
+        // Messages of departed peers are ignored
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_2, 0, "gone"));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.getMiddleWare().getNumPendingTxMessages() == 0);
+
+        // A joining peer takes part in new messages
+        p.app.getMiddleWare().addPeer(&txSock3);
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_3, 0, "new"));
+        p.app.numLoops(12).run();
+        REQUIRE(numDataMessages(txSock3.m_sentPayloads) > 0);
+        REQUIRE(numDataMessages(p.txSocks[0].m_sentPayloads) > 0);
+    }
+
+    TEST_CASE( "A joining peer takes the first sequence number of each member as its base", "MiddleWare" )
+    {
+        // We start while peer 1 is past sequence number 10 already
+        TestTxSocket txSock3(PEER_3);
+        Peers p({PEER_1});
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 25, "late"));
+        p.app.numLoops(1).run();
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 25));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.deliveredMsgs.size() == 1);
+        REQUIRE(p.app.deliveredMsgs[0].msgId == MessageId(PEER_1.peerId, 25));
+
+        // Only the first message sets the base, later ones outside the window are still discarded
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 50, "far"));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.getMiddleWare().getNumPendingTxMessages() == 0);
+
+        // A peer joining at runtime, or re-added with a new address, may be past sequence number 10 as well
+        p.app.getMiddleWare().addPeer(&txSock3);
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_3, 12, "joined"));
+        // the transmissions to the peers are one second apart
+        p.app.numLoops(11).run();
+        REQUIRE(numDataMessages(txSock3.m_sentPayloads) == 1);
+        p.rxSocket.m_receivedPayloads.push_back(mkRxResendPayload(PEER_1, PEER_3, 12));
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_3, 12));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.deliveredMsgs.size() == 2);
+        REQUIRE(p.app.deliveredMsgs[1].msgId == MessageId(PEER_3.peerId, 12));
+    }
+
+    TEST_CASE( "Deflated messages are inflated once and relayed as they are", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.compressionThresholdBytes = 256;
+        Peers p({PEER_1, PEER_2}, mwConfig);
+
+        string json;
+        for (size_t i = 0; i < 100; i++)
+        {
+            json += fmt::format("{{\"id\":{},\"state\":\"ok\"}},", i);
+        }
+        payload_t deflated = deflateData(reinterpret_cast<uint8_t const *>(json.data()), json.size());
+        REQUIRE(!deflated.empty());
+        REQUIRE(deflated.size() * 5 < json.size());
+
+        // The frame goes on to both peers byte by byte, the message is delivered inflated
+        sender_payload_t frame = mkRxDeflatedPayload(PEER_1, 0, deflated, json.size());
+        p.rxSocket.m_receivedPayloads.push_back(frame);
+        p.app.numLoops(1).run();
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 2);
+        REQUIRE(p.txSocks[0].m_sentPayloads[1] == frame.payload);
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0));
+        p.app.numLoops(10).run();
+        REQUIRE(p.txSocks[1].m_sentPayloads.size() == 1);
+        REQUIRE(p.txSocks[1].m_sentPayloads[0] == frame.payload);
+        p.rxSocket.m_receivedPayloads.push_back(mkRxResendPayload(PEER_2, PEER_1, 0));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.deliveredMsgs.size() == 1);
+        REQUIRE(p.app.deliveredMsgs[0].payload == payload_t(begin(json), end(json)));
+
+        // A frame which does not inflate is not acknowledged
+        p.rxSocket.m_receivedPayloads.push_back(mkRxDeflatedPayload(PEER_1, 1, payload_t(deflated.size(), 0x5a), json.size()));
+        p.app.numLoops(1).run();
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 2);
+
+        // Our own messages carry the flags byte, only those above the threshold are deflated
+        REQUIRE(p.app.getMiddleWare().sendMessage(json, std::chrono::system_clock::time_point()) == SendStatus::OK);
+        REQUIRE(p.app.getMiddleWare().sendMessage("small", std::chrono::system_clock::time_point()) == SendStatus::OK);
+        p.app.numLoops(1).run();
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 4);
+        REQUIRE(p.txSocks[0].m_sentPayloads[2][4] == FRAME_FLAG_DEFLATED);
+        REQUIRE(p.txSocks[0].m_sentPayloads[2].size() < json.size() / 5);
+        REQUIRE(p.txSocks[0].m_sentPayloads[3].size() == 4 + 1 + 5 + 2);
+        REQUIRE(p.txSocks[0].m_sentPayloads[3][4] == 0);
+    }
+    TEST_CASE( "Messages whose datagram exceeds the receive buffer are rejected", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.compressionThresholdBytes = 256;
+        Peers p({PEER_1}, mwConfig);
+
+        string incompressible;
+        std::minstd_rand rng(1);
+        for (size_t i = 0; i < 4096; i++)
+        {
+            incompressible.push_back(static_cast<char>(rng() & 0xff));
+        }
+        // header with flags byte and checksum take 7 Bytes
+        REQUIRE(p.app.getMiddleWare().sendMessage(incompressible.substr(0, BUFFER_SIZE - 7), std::chrono::system_clock::time_point()) == SendStatus::OK);
+        REQUIRE(p.app.getMiddleWare().sendMessage(incompressible.substr(0, BUFFER_SIZE - 6), std::chrono::system_clock::time_point()) == SendStatus::TOO_LARGE);
+        REQUIRE(p.app.getMiddleWare().sendMessage(incompressible, std::chrono::system_clock::time_point()) == SendStatus::TOO_LARGE);
+        // fits once deflated
+        REQUIRE(p.app.getMiddleWare().sendMessage(string(8192, 'x'), std::chrono::system_clock::time_point()) == SendStatus::OK);
+        REQUIRE(p.app.getMiddleWare().getUsage().numMessages == 2);
+
+        Peers uncompressed({PEER_1});
+        REQUIRE(uncompressed.app.getMiddleWare().sendMessage(string(BUFFER_SIZE - 5, 'x'), std::chrono::system_clock::time_point()) == SendStatus::TOO_LARGE);
+        REQUIRE(uncompressed.app.getMiddleWare().getUsage().numMessages == 0);
+        uncompressed.app.numLoops(1).run();
+        REQUIRE(uncompressed.txSocks[0].m_sentPayloads.empty());
+    }
+
+    static payload_t mkSeqNrEntry(peerId_t peerId, seqNr_t seqNr, uint16_t count = 0)
+    {
+        payload_t ret = { static_cast<uint8_t>(peerId >> 8), static_cast<uint8_t>(peerId & 0xff),
+            static_cast<uint8_t>(seqNr >> 24), static_cast<uint8_t>((seqNr >> 16) & 0xff),
+            static_cast<uint8_t>((seqNr >> 8) & 0xff), static_cast<uint8_t>(seqNr & 0xff) };
+        if (count > 0)
+        {
+            // NACK entry
+            ret.push_back(count >> 8);
+            ret.push_back(count & 0xff);
+        }
+        return ret;
+    }
+
+    static sender_payload_t mkRxControlPayload(peer_t const &sender, ControlType type, std::vector<payload_t> const &entries)
+    {
+        sender_payload_t ret;
+        ret.payload = { 0xff, 0xff, static_cast<uint8_t>(type) };
+        for (auto const &entry : entries)
+        {
+            ret.payload.insert(end(ret.payload), begin(entry), end(entry));
+        }
+        MiddleWare::appendChecksum(ChecksumType::RFC1071, ret.payload);
+        ret.peer = sender;
+        return ret;
+    }
+
+    TEST_CASE( "In NACK mode, missing messages are requested and delivered in the order of their origin", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.reliability = Reliability::NACK;
+        Peers p({PEER_1, PEER_2}, mwConfig);
+
+        // Not acknowledged, but confirmed in the status of the same loop
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0, "a"));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.deliveredMsgs.size() == 1);
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 1);
+        REQUIRE(p.txSocks[0].m_sentPayloads[0] == 
+            mkRxControlPayload(PEER_1, ControlType::STATUS, { mkSeqNrEntry(OWN_PEER_ID, 0), mkSeqNrEntry(PEER_1.peerId, 1) }).payload);
+        REQUIRE(p.txSocks[1].m_sentPayloads.empty());
+        p.txSocks[0].m_sentPayloads.clear();
+
+        // The gap is requested at once and again in the status round
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 3, "d"));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.deliveredMsgs.size() == 1);
+        payload_t nack = mkRxControlPayload(PEER_1, ControlType::NACK, { mkSeqNrEntry(PEER_1.peerId, 1, 2) }).payload;
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 2);
+        REQUIRE(p.txSocks[0].m_sentPayloads[0] == nack);
+        REQUIRE(p.txSocks[0].m_sentPayloads[1] == nack);
+        p.txSocks[0].m_sentPayloads.clear();
+
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 2, "c"));
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 1, "b"));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.deliveredMsgs.size() == 4);
+        for (seqNr_t seqNr = 0; seqNr < 4; seqNr++)
+        {
+            REQUIRE(p.app.deliveredMsgs[seqNr].msgId == MessageId(PEER_1.peerId, seqNr));
+            REQUIRE(p.app.deliveredMsgs[seqNr].payload == payload_t{ static_cast<uint8_t>('a' + seqNr) });
+        }
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 1);
+        p.txSocks[0].m_sentPayloads.clear();
+
+        // The messages lost after the last received one show up in the status of their origin
+        p.rxSocket.m_receivedPayloads.push_back(
+            mkRxControlPayload(PEER_1, ControlType::STATUS_REQUEST, { mkSeqNrEntry(PEER_1.peerId, 6), mkSeqNrEntry(OWN_PEER_ID, 0) }));
+        p.app.numLoops(1).run();
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 2);
+        REQUIRE(p.txSocks[0].m_sentPayloads[0] == mkRxControlPayload(PEER_1, ControlType::NACK, { mkSeqNrEntry(PEER_1.peerId, 4, 2) }).payload);
+        REQUIRE(p.txSocks[0].m_sentPayloads[1] == 
+            mkRxControlPayload(PEER_1, ControlType::STATUS, { mkSeqNrEntry(OWN_PEER_ID, 0), mkSeqNrEntry(PEER_1.peerId, 4) }).payload);
+    }
+
+    TEST_CASE( "In NACK mode, own messages are kept for retransmissions until all peers confirmed them", "MiddleWare" )
+    {
+        static const peer_t OWN_PEER = { OWN_PEER_ID, 45, inet_addr("192.168.1.42") };
+        mwConfig_t mwConfig;
+        mwConfig.reliability = Reliability::NACK;
+        Peers p({PEER_1, PEER_2}, mwConfig);
+
+        // Sent once to every peer right away
+        REQUIRE(p.app.getMiddleWare().sendMessage("x", std::chrono::system_clock::time_point()) == SendStatus::OK);
+        payload_t frame = mkRxPayload(OWN_PEER, 0, "x").payload;
+        REQUIRE(p.txSocks[0].m_sentPayloads == std::vector<payload_t>{ frame });
+        REQUIRE(p.txSocks[1].m_sentPayloads == std::vector<payload_t>{ frame });
+        REQUIRE(p.app.getMiddleWare().getNumPendingTxMessages() == 1);
+
+        // The peers are asked for their status until they confirm the message
+        p.app.numLoops(1).run();
+        REQUIRE(p.txSocks[1].m_sentPayloads.size() == 2);
+        REQUIRE(p.txSocks[1].m_sentPayloads[1] == 
+            mkRxControlPayload(PEER_2, ControlType::STATUS_REQUEST, { mkSeqNrEntry(OWN_PEER_ID, 1), mkSeqNrEntry(PEER_2.peerId, 0) }).payload);
+
+        // Retransmitted to the requesting peer only
+        p.rxSocket.m_receivedPayloads.push_back(mkRxControlPayload(PEER_2, ControlType::NACK, { mkSeqNrEntry(OWN_PEER_ID, 0, 1) }));
+        p.app.numLoops(1).run();
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 3);
+        REQUIRE(p.txSocks[1].m_sentPayloads.size() == 4);
+        REQUIRE(p.txSocks[1].m_sentPayloads[2] == frame);
+
+        p.rxSocket.m_receivedPayloads.push_back(
+            mkRxControlPayload(PEER_1, ControlType::STATUS, { mkSeqNrEntry(PEER_1.peerId, 0), mkSeqNrEntry(OWN_PEER_ID, 1) }));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.getMiddleWare().getNumPendingTxMessages() == 1);
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 3);
+        REQUIRE(p.txSocks[1].m_sentPayloads.size() == 5);
+
+        p.rxSocket.m_receivedPayloads.push_back(
+            mkRxControlPayload(PEER_2, ControlType::STATUS, { mkSeqNrEntry(PEER_2.peerId, 0), mkSeqNrEntry(OWN_PEER_ID, 1) }));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.getMiddleWare().getNumPendingTxMessages() == 0);
+        REQUIRE(p.app.getMiddleWare().getUsage().numMessages == 0);
+
+        // Nothing left to confirm
+        p.app.numLoops(10).run();
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 3);
+        REQUIRE(p.txSocks[1].m_sentPayloads.size() == 5);
+    }
+
+    static sender_payload_t mkRxFecParityPayload(peer_t const &sender, seqNr_t blockStart, std::vector<payload_t> const &frames)
+    {
+        payload_t xorFrames;
+        uint16_t xorSize = 0;
+        for (auto const &frame : frames)
+        {
+            xorFrames.resize(std::max(xorFrames.size(), frame.size()), 0);
+            for (size_t i = 0; i < frame.size(); i++)
+            {
+                xorFrames[i] ^= frame[i];
+            }
+            xorSize ^= static_cast<uint16_t>(frame.size());
+        }
+
+        payload_t header = mkSeqNrEntry(sender.peerId, blockStart);
+        header.push_back(static_cast<uint8_t>(frames.size()));
+        header.push_back(xorSize >> 8);
+        header.push_back(xorSize & 0xff);
+        return mkRxControlPayload(sender, ControlType::FEC_PARITY, { header, xorFrames });
+    }
+
+    TEST_CASE( "A single lost message of a block is rebuilt from the parity frame", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.fecBlockSize = 3;
+        Peers p({PEER_1, PEER_2}, mwConfig);
+        payload_t frame0 = mkRxPayload(PEER_1, 0, "first").payload;
+        payload_t frame1 = mkRxPayload(PEER_1, 1, "2nd").payload;
+        payload_t frame2 = mkRxPayload(PEER_1, 2, "third one").payload;
+        sender_payload_t parity = mkRxFecParityPayload(PEER_1, 0, { frame0, frame1, frame2 });
+
+        // Message 1 is lost, the parity arrives in its place
+        p.rxSocket.m_receivedPayloads.push_back(parity);
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 2, "third one"));
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0, "first"));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.getMiddleWare().getUsage().numFecRecovered == 1);
+        REQUIRE(p.app.getMiddleWare().getNumPendingTxMessages() == 3);
+        // acknowledged right away, as if it had been received from the origin
+        auto const &sentToPeer1 = p.txSocks[0].m_sentPayloads;
+        REQUIRE(std::count(begin(sentToPeer1), end(sentToPeer1), mkRxPayload(PEER_1, 1).payload) == 1);
+
+        // Nothing to rebuild with two messages missing
+        p.rxSocket.m_receivedPayloads.push_back(mkRxFecParityPayload(PEER_1, 3, { mkRxPayload(PEER_1, 3, "a").payload,
+            mkRxPayload(PEER_1, 4, "b").payload, mkRxPayload(PEER_1, 5, "c").payload }));
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 5, "c"));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.getMiddleWare().getUsage().numFecRecovered == 1);
+    }
+
+    TEST_CASE( "A parity rebuilds skipped messages only while their block is kept", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.fecBlockSize = 3;
+        Peers p({PEER_1, PEER_2}, mwConfig);
+        auto const &sentToPeer1 = p.txSocks[0].m_sentPayloads;
+        sender_payload_t parity = mkRxFecParityPayload(PEER_1, 0, { mkRxPayload(PEER_1, 0, "a").payload,
+            mkRxPayload(PEER_1, 1, "b").payload, mkRxPayload(PEER_1, 2, "c").payload });
+
+        // Message 1 is skipped by the accepted sequence number before the parity arrives
+        p.rxSocket.m_receivedPayloads.push_back(parity);
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 2, "c"));
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 0, "a"));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.getMiddleWare().getUsage().numFecRecovered == 1);
+        REQUIRE(p.app.getMiddleWare().getNumPendingTxMessages() == 3);
+        REQUIRE(std::count(begin(sentToPeer1), end(sentToPeer1), mkRxPayload(PEER_1, 1).payload) == 1);
+
+        // A repeated parity and the message itself are not accepted again
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 1, "b"));
+        p.rxSocket.m_receivedPayloads.push_back(parity);
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.getMiddleWare().getUsage().numFecRecovered == 1);
+        REQUIRE(p.app.getMiddleWare().getNumPendingTxMessages() == 3);
+
+        // Messages 3..16 in order: The frames of block 3 are trimmed together, not only the first one of them
+        std::vector<payload_t> block;
+        for (seqNr_t seqNr = 3; seqNr < 17; seqNr++)
+        {
+            p.rxSocket.m_receivedPayloads.insert(begin(p.rxSocket.m_receivedPayloads), mkRxPayload(PEER_1, seqNr, "x"));
+            if (seqNr < 6)
+            {
+                block.push_back(mkRxPayload(PEER_1, seqNr, "x").payload);
+            }
+        }
+        p.app.numLoops(1).run();
+        p.rxSocket.m_receivedPayloads.push_back(mkRxFecParityPayload(PEER_1, 3, block));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.getMiddleWare().getUsage().numFecRecovered == 1);
+        REQUIRE(std::count(begin(sentToPeer1), end(sentToPeer1), mkRxPayload(PEER_1, 3).payload) == 1);
+
+        // Message 18 is skipped, its block is trimmed before the parity and the message arrive
+        for (seqNr_t seqNr = 17; seqNr < 35; seqNr++)
+        {
+            if (seqNr != 18)
+            {
+                p.rxSocket.m_receivedPayloads.insert(begin(p.rxSocket.m_receivedPayloads), mkRxPayload(PEER_1, seqNr, "x"));
+            }
+        }
+        p.app.numLoops(1).run();
+        size_t numPending = p.app.getMiddleWare().getNumPendingTxMessages();
+        p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, 18, "y"));
+        p.rxSocket.m_receivedPayloads.push_back(mkRxFecParityPayload(PEER_1, 18, { mkRxPayload(PEER_1, 18, "y").payload,
+            mkRxPayload(PEER_1, 19, "x").payload, mkRxPayload(PEER_1, 20, "x").payload }));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.getMiddleWare().getUsage().numFecRecovered == 1);
+        REQUIRE(p.app.getMiddleWare().getNumPendingTxMessages() == numPending);
+    }
+
+    TEST_CASE( "The parity frame follows the first transmission of the last message of a block", "MiddleWare" )
+    {
+        static const peer_t OWN_PEER = { OWN_PEER_ID, 45, inet_addr("192.168.1.42") };
+        mwConfig_t mwConfig;
+        mwConfig.fecBlockSize = 2;
+        Peers p({PEER_1, PEER_2}, mwConfig);
+
+        REQUIRE(p.app.getMiddleWare().sendMessage("ab", std::chrono::system_clock::time_point()) == SendStatus::OK);
+        REQUIRE(p.app.getMiddleWare().sendMessage("cde", std::chrono::system_clock::time_point()) == SendStatus::OK);
+        REQUIRE(p.app.getMiddleWare().sendMessage("f", std::chrono::system_clock::time_point()) == SendStatus::OK);
+        p.app.numLoops(1).run();
+
+        auto const &sent = p.txSocks[0].m_sentPayloads;
+        REQUIRE(sent.size() == 4);
+        REQUIRE(sent[0] == mkRxPayload(OWN_PEER, 0, "ab").payload);
+        REQUIRE(sent[1] == mkRxPayload(OWN_PEER, 1, "cde").payload);
+        REQUIRE(sent[2] == mkRxFecParityPayload(OWN_PEER, 0, { sent[0], sent[1] }).payload);
+        REQUIRE(sent[3] == mkRxPayload(OWN_PEER, 2, "f").payload);
+
+        // Retransmissions come without parity
+        p.app.numLoops(10).run();
+        REQUIRE(std::count_if(begin(sent), end(sent), [](auto const &frame) { return (frame[2] == static_cast<uint8_t>(ControlType::FEC_PARITY)); }) == 1);
+    }
+
+    static sender_payload_t mkRxLanePayload(peer_t const &sender, seqNr_t seqNr, Priority priority, uint16_t ttlMs, string s)
+    {
+        sender_payload_t ret;
+        ret.payload = { static_cast<uint8_t>(sender.peerId >> 8), static_cast<uint8_t>(sender.peerId & 0xff),
+            static_cast<uint8_t>(seqNr >> 8), static_cast<uint8_t>(seqNr & 0xff),
+            static_cast<uint8_t>(static_cast<uint8_t>(priority) << FRAME_PRIORITY_SHIFT),
+            static_cast<uint8_t>(ttlMs >> 8), static_cast<uint8_t>(ttlMs & 0xff) };
+        ret.payload.insert(end(ret.payload), begin(s), end(s));
+        MiddleWare::appendChecksum(ChecksumType::RFC1071, ret.payload);
+        ret.peer = sender;
+        return ret;
+    }
+
+    TEST_CASE( "Messages of a higher lane are transmitted and retransmitted first", "MiddleWare" )
+    {
+        static const peer_t OWN_PEER = { OWN_PEER_ID, 45, inet_addr("192.168.1.42") };
+        mwConfig_t mwConfig;
+        mwConfig.priorityLanes = true;
+        Peers p({PEER_1}, mwConfig);
+
+        auto now = std::chrono::system_clock::time_point();
+        REQUIRE(p.app.getMiddleWare().sendMessage("a", now, Priority::BULK) == SendStatus::OK);
+        REQUIRE(p.app.getMiddleWare().sendMessage("b", now) == SendStatus::OK);
+        REQUIRE(p.app.getMiddleWare().sendMessage("u", now, Priority::URGENT, std::chrono::milliseconds(5000)) == SendStatus::OK);
+        p.app.numLoops(1).run();
+
+        auto const &sent = p.txSocks[0].m_sentPayloads;
+        REQUIRE(sent.size() == 3);
+        REQUIRE(sent[0] == mkRxLanePayload(OWN_PEER, 2, Priority::URGENT, 5000, "u").payload);
+        REQUIRE(sent[1] == mkRxLanePayload(OWN_PEER, 1, Priority::NORMAL, 0, "b").payload);
+        REQUIRE(sent[2] == mkRxLanePayload(OWN_PEER, 0, Priority::BULK, 0, "a").payload);
+
+        // Retransmissions in the same order, with the remaining time to live
+        p.app.numLoops(10).run();
+        REQUIRE(sent.size() == 6);
+        REQUIRE(sent[3] == mkRxLanePayload(OWN_PEER, 2, Priority::URGENT, 4000, "u").payload);
+        REQUIRE(sent[5] == sent[2]);
+    }
+
+    TEST_CASE( "Expired messages are dropped instead of retransmitted, by the origin and by relays", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.priorityLanes = true;
+        Peers p({PEER_1, PEER_2}, mwConfig);
+
+        // Our own message, no peer acknowledges it
+        REQUIRE(p.app.getMiddleWare().sendMessage("stale", std::chrono::system_clock::time_point(), Priority::NORMAL,
+            std::chrono::milliseconds(1500)) == SendStatus::OK);
+        p.app.numLoops(30).run();
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 2);
+        REQUIRE(p.txSocks[1].m_sentPayloads.size() == 1);
+        REQUIRE(p.app.getMiddleWare().getNumPendingTxMessages() == 0);
+        REQUIRE(p.app.getMiddleWare().getUsage().numExpired == 1);
+
+        // A relayed message expires before its turn to go to the second peer
+        p.rxSocket.m_receivedPayloads.push_back(mkRxLanePayload(PEER_1, 0, Priority::BULK, 500, "late"));
+        p.app.numLoops(30).run();
+        REQUIRE(p.txSocks[1].m_sentPayloads.size() == 1);
+        REQUIRE(p.app.getMiddleWare().getNumPendingTxMessages() == 0);
+        REQUIRE(p.app.getMiddleWare().getUsage().numExpired == 2);
+        REQUIRE(p.app.deliveredMsgs.empty());
+    }
+
+    TEST_CASE( "Relays forward the remaining time to live of a message", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.priorityLanes = true;
+        Peers p({PEER_1, PEER_2}, mwConfig);
+
+        p.rxSocket.m_receivedPayloads.push_back(mkRxLanePayload(PEER_1, 0, Priority::URGENT, 3000, "hop"));
+        p.app.numLoops(30).run();
+        auto const &sentToPeer2 = p.txSocks[1].m_sentPayloads;
+        REQUIRE(sentToPeer2.size() == 2);
+        REQUIRE(sentToPeer2[0] == mkRxLanePayload(PEER_1, 0, Priority::URGENT, 2000, "hop").payload);
+        REQUIRE(sentToPeer2[1] == mkRxLanePayload(PEER_1, 0, Priority::URGENT, 1000, "hop").payload);
+    }
+
+    TEST_CASE( "The parity rebuilds a frame whose neighbours were relayed with less time to live", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.priorityLanes = true;
+        mwConfig.fecBlockSize = 3;
+        Peers p({PEER_1, PEER_2}, mwConfig);
+        // The origin's parity covers the frames with a time to live of 0
+        sender_payload_t parity = mkRxFecParityPayload(PEER_1, 0, { mkRxLanePayload(PEER_1, 0, Priority::NORMAL, 0, "a").payload,
+            mkRxLanePayload(PEER_1, 1, Priority::NORMAL, 0, "bb").payload, mkRxLanePayload(PEER_1, 2, Priority::NORMAL, 0, "c").payload });
+
+        p.rxSocket.m_receivedPayloads.push_back(parity);
+        p.rxSocket.m_receivedPayloads.push_back(mkRxLanePayload(PEER_1, 2, Priority::NORMAL, 3000, "c"));
+        p.rxSocket.m_receivedPayloads.push_back(mkRxLanePayload(PEER_1, 0, Priority::NORMAL, 4000, "a"));
+        p.app.numLoops(1).run();
+        REQUIRE(p.app.getMiddleWare().getUsage().numFecRecovered == 1);
+        auto const &sentToPeer1 = p.txSocks[0].m_sentPayloads;
+        REQUIRE(std::count(begin(sentToPeer1), end(sentToPeer1), mkRxPayload(PEER_1, 1).payload) == 1);
+        // relayed with the time to live of the first frame of its lane
+        REQUIRE(std::count(begin(sentToPeer1), end(sentToPeer1), mkRxLanePayload(PEER_1, 1, Priority::NORMAL, 4000, "bb").payload) == 1);
+    }
+
+    TEST_CASE( "Transmissions exceeding the pacing rate are deferred to their slot", "MiddleWare" )
+    {
+        mwConfig_t mwConfig;
+        mwConfig.pacePeerPacketsPerSec = 10;
+        mwConfig.paceBurst = std::chrono::milliseconds(100);
+        Peers p({PEER_1}, mwConfig);
+
+        for (size_t i = 0; i < 5; i++)
+        {
+            REQUIRE(p.app.getMiddleWare().sendMessage(fmt::format("m{}", i), std::chrono::system_clock::time_point()) == SendStatus::OK);
+        }
+
+        // One datagram per 100 ms, none is dropped or loses a transmission attempt
+        p.app.numLoops(1).run();
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 1);
+        p.app.numLoops(4).run();
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 5);
+        REQUIRE(p.txSocks[0].m_sentPayloads[4] == mkRxPayload({ OWN_PEER_ID, 45, inet_addr("192.168.1.42") }, 4, "m4").payload);
+
+        mwUsage_t usage = p.app.getMiddleWare().getUsage();
+        REQUIRE(usage.numPacedDatagrams == 4);
+        REQUIRE(usage.pacingDelayNsMax == 400000000);
+        REQUIRE(usage.pacingDelayNsSum == 1000000000);
+
+        // ACKs are never deferred, unlike the relay of the new message
+        for (seqNr_t seqNr = 0; seqNr < 5; seqNr++)
+        {
+            p.rxSocket.m_receivedPayloads.push_back(mkRxPayload(PEER_1, seqNr, "x"));
+        }
+        p.app.numLoops(1).run();
+        REQUIRE(p.txSocks[0].m_sentPayloads.size() == 10);
+    }
+
+    TEST_CASE( "In NACK mode, transmissions exceeding the pacing rate wait in a queue of their own", "MiddleWare" )
+    {
+        static const peer_t OWN_PEER = { OWN_PEER_ID, 45, inet_addr("192.168.1.42") };
+        mwConfig_t mwConfig;
+        mwConfig.reliability = Reliability::NACK;
+        mwConfig.pacePeerPacketsPerSec = 10;
+        mwConfig.paceBurst = std::chrono::milliseconds(100);
+        mwConfig.statusInterval = std::chrono::seconds(10);
+        Peers p({PEER_1}, mwConfig);
+
+        auto getSentFrames = [&p]()
+        {
+            std::vector<payload_t> ret;
+            for (auto const &payload : p.txSocks[0].m_sentPayloads)
+            {
+                if ((payload[0] == (OWN_PEER_ID >> 8)) && (payload[1] == (OWN_PEER_ID & 0xff)))
+                {
+                    ret.push_back(payload);
+                }
+            }
+            return ret;
+        };
+
+        for (size_t i = 0; i < 4; i++)
+        {
+            REQUIRE(p.app.getMiddleWare().sendMessage(fmt::format("m{}", i), std::chrono::system_clock::time_point()) == SendStatus::OK);
+        }
+        REQUIRE(getSentFrames().size() == 1);
+
+        // One datagram per 100 ms, in the order of sending; the first status request took the token of the second loop
+        p.app.numLoops(2).run();
+        REQUIRE(getSentFrames().size() == 1);
+        p.app.numLoops(3).run();
+        std::vector<payload_t> frames = getSentFrames();
+        REQUIRE(frames.size() == 4);
+        for (seqNr_t seqNr = 0; seqNr < 4; seqNr++)
+        {
+            REQUIRE(frames[seqNr] == mkRxPayload(OWN_PEER, seqNr, fmt::format("m{}", seqNr)).payload);
+        }
+        REQUIRE(p.app.getMiddleWare().getUsage().numPacedDatagrams == 3);
+
+        // Retransmissions queue up behind the pacing rate as well
+        p.rxSocket.m_receivedPayloads.push_back(mkRxControlPayload(PEER_1, ControlType::NACK, { mkSeqNrEntry(OWN_PEER_ID, 0, 3) }));
+        p.app.numLoops(1).run();
+        REQUIRE(getSentFrames().size() == 5);
+        p.app.numLoops(2).run();
+        frames = getSentFrames();
+        REQUIRE(frames.size() == 7);
+        REQUIRE(frames[6] == mkRxPayload(OWN_PEER, 2, "m2").payload);
+    }
+}
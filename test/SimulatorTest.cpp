@@ -0,0 +1,109 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+#include "NetworkSimulator.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace rgc;
+
+static simConfig_t makeSimConfig(size_t numPeers, uint32_t seed)
+{
+    simConfig_t config;
+    config.numPeers = numPeers;
+    config.mwConfig.maxInFlightPerOrigin = 8;
+    config.linkModel = { milliseconds(1), microseconds(0), 0.0, 0.0, 0.0, milliseconds(5) };
+    config.seed = seed;
+    return config;
+}
+
+// Sends numMessages round robin, retrying while the in-flight budget of the sender is exhausted
+static bool runGroup(NetworkSimulator &sim, size_t numPeers, size_t numMessages, seconds limit)
+{
+    auto end = sim.now() + limit;
+    for (size_t i = 0; i < numMessages; i++)
+    {
+        string message = "message " + to_string(i);
+        while (sim.send(i % numPeers, message) != SendStatus::OK)
+        {
+            sim.runUntil(sim.now() + milliseconds(10));
+        }
+        sim.runUntil(sim.now() + milliseconds(10));
+    }
+    return sim.runUntilIdle(end);
+}
+
+TEST_CASE( "Simulated group delivers all messages to all peers" )
+{
+    NetworkSimulator sim(makeSimConfig(4, 1));
+    REQUIRE(runGroup(sim, 4, 20, seconds(600)));
+
+    simStats_t const &stats = sim.getStats();
+    REQUIRE(stats.numSent == 20);
+    REQUIRE(stats.numFullyDelivered == 20);
+    REQUIRE(stats.numDeliveries == 4 * 20);
+    for (size_t i = 0; i < 4; i++)
+    {
+        REQUIRE(sim.getNumDelivered(i) == 20);
+    }
+    REQUIRE(stats.numDropped == 0);
+    REQUIRE(stats.numAck > 0);
+}
+
+TEST_CASE( "Simulation runs are reproducible with the same seed" )
+{
+    simConfig_t config = makeSimConfig(5, 42);
+    config.linkModel = { milliseconds(2), milliseconds(3), 0.1, 0.05, 0.05, milliseconds(20) };
+
+    NetworkSimulator sim1(config);
+    NetworkSimulator sim2(config);
+    REQUIRE(runGroup(sim1, 5, 30, seconds(600)));
+    REQUIRE(runGroup(sim2, 5, 30, seconds(600)));
+
+    simStats_t const &stats1 = sim1.getStats();
+    simStats_t const &stats2 = sim2.getStats();
+    REQUIRE(sim1.now() == sim2.now());
+    REQUIRE(stats1.numEvents == stats2.numEvents);
+    REQUIRE(stats1.numData == stats2.numData);
+    REQUIRE(stats1.numAck == stats2.numAck);
+    REQUIRE(stats1.numBytes == stats2.numBytes);
+    REQUIRE(stats1.numDropped == stats2.numDropped);
+    REQUIRE(stats1.numDuplicated == stats2.numDuplicated);
+    REQUIRE(stats1.numReordered == stats2.numReordered);
+}
+
+TEST_CASE( "Simulated group tolerates lossy, duplicating and reordering links" )
+{
+    simConfig_t config = makeSimConfig(4, 7);
+    config.linkModel = { milliseconds(1), milliseconds(2), 0.1, 0.1, 0.1, milliseconds(50) };
+    // a receiver skips the gap if a later message of the same origin overtakes a lost one
+    config.mwConfig.maxInFlightPerOrigin = 1;
+    NetworkSimulator sim(config);
+    REQUIRE(runGroup(sim, 4, 20, seconds(600)));
+
+    simStats_t const &stats = sim.getStats();
+    REQUIRE(stats.numDropped > 0);
+    REQUIRE(stats.numDuplicated > 0);
+    REQUIRE(stats.numReordered > 0);
+    // no message is delivered twice
+    REQUIRE(stats.numFullyDelivered == 20);
+    REQUIRE(stats.numDeliveries == 4 * 20);
+}
+
+TEST_CASE( "Simulated time passes without waiting for it" )
+{
+    simConfig_t config = makeSimConfig(8, 3);
+    config.mwConfig.heartbeatInterval = milliseconds(100);
+    NetworkSimulator sim(config);
+    auto wallStart = steady_clock::now();
+    auto start = sim.now();
+
+    REQUIRE(runGroup(sim, 8, 32, seconds(3600)));
+    sim.runUntil(sim.now() + seconds(60));
+
+    REQUIRE(sim.now() - start > seconds(60));
+    REQUIRE(steady_clock::now() - wallStart < seconds(10));
+    REQUIRE(sim.getStats().numFullyDelivered == 32);
+    REQUIRE(sim.getStats().numControl > 0);
+}
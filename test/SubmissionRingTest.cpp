@@ -0,0 +1,150 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "CommandSocket.h"
+#include "SubmissionRing.h"
+
+using namespace std;
+using namespace rgc;
+
+static const string TEST_RING_NAME = "/peer_ring_test";
+static const string TEST_SOCKET_PATH = "/tmp/peer_sock_ring_test";
+
+static bool isReadable(int desc)
+{
+    struct pollfd pollFd { desc, POLLIN, 0 };
+    return (::poll(&pollFd, 1, 0) == 1);
+}
+
+static bool push(SubmissionRingProducer &producer, string const &msg)
+{
+    return producer.tryPush(reinterpret_cast<uint8_t const *>(msg.data()), msg.size());
+}
+
+TEST_CASE( "Submission ring passes messages in order and pushes back when full" )
+{
+    SubmissionRing ring(TEST_RING_NAME, 4, 16);
+    SubmissionRingProducer producer(TEST_RING_NAME, dup(ring.getEventDescriptor()));
+    vector<string> consumed;
+    auto consumer = [&](uint8_t const *data, size_t size) {
+        consumed.push_back(string(reinterpret_cast<char const *>(data), size));
+        return true;
+    };
+
+    REQUIRE(ring.consume(consumer, 10) == 0);
+    REQUIRE(!isReadable(ring.getEventDescriptor()));
+
+    REQUIRE(push(producer, "one"));
+    REQUIRE(push(producer, "two"));
+    producer.notify();
+    REQUIRE(isReadable(ring.getEventDescriptor()));
+    ring.clearEvent();
+    REQUIRE(!isReadable(ring.getEventDescriptor()));
+
+    REQUIRE(ring.consume(consumer, 10) == 2);
+    REQUIRE(consumed == vector<string>{ "one", "two" });
+
+    // four slots, the fifth message does not fit until the consumer frees a slot
+    REQUIRE(push(producer, "3"));
+    REQUIRE(push(producer, "4"));
+    REQUIRE(push(producer, "5"));
+    REQUIRE(push(producer, "6"));
+    REQUIRE(!push(producer, "7"));
+    REQUIRE(!push(producer, string(17, 'x')));
+
+    consumed.clear();
+    REQUIRE(ring.consume(consumer, 1) == 1);
+    REQUIRE(push(producer, "7"));
+
+    // A message the consumer rejects stays in the ring
+    size_t numCalls = 0;
+    REQUIRE(ring.consume([&](uint8_t const *, size_t) { numCalls++; return false; }, 10) == 0);
+    REQUIRE(numCalls == 1);
+
+    // Writing in place into a claimed slot
+    REQUIRE(ring.consume(consumer, 2) == 2);
+    uint8_t *pSlot = producer.claim();
+    REQUIRE(pSlot != nullptr);
+    memcpy(pSlot, "in place", 8);
+    producer.publish(8);
+
+    REQUIRE(ring.consume(consumer, 10) == 3);
+    REQUIRE(consumed == vector<string>{ "3", "4", "5", "6", "7", "in place" });
+}
+
+TEST_CASE( "Submission ring requires a power of two number of slots" )
+{
+    REQUIRE_THROWS(SubmissionRing(TEST_RING_NAME, 3, 16));
+}
+
+TEST_CASE( "Submission ring keeps its geometry when the producer overwrites the header" )
+{
+    SubmissionRing ring(TEST_RING_NAME, 4, 16);
+    SubmissionRingProducer producer(TEST_RING_NAME, dup(ring.getEventDescriptor()));
+    REQUIRE(push(producer, "one"));
+    // a length beyond the slot, which is skipped
+    REQUIRE(producer.claim() != nullptr);
+    producer.publish(4096);
+    REQUIRE(push(producer, "three"));
+
+    int shmDesc = shm_open(TEST_RING_NAME.c_str(), O_RDWR, 0);
+    REQUIRE(shmDesc >= 0);
+    void *pMap = mmap(nullptr, sizeof(ringHeader_t), PROT_READ | PROT_WRITE, MAP_SHARED, shmDesc, 0);
+    close(shmDesc);
+    REQUIRE(pMap != MAP_FAILED);
+    ringHeader_t *pHeader = reinterpret_cast<ringHeader_t *>(pMap);
+    pHeader->numSlots = 0;
+    pHeader->slotSize = 1u << 30;
+    pHeader->slotStride = 1u << 30;
+
+    vector<string> consumed;
+    REQUIRE(ring.consume([&](uint8_t const *data, size_t size) {
+        consumed.push_back(string(reinterpret_cast<char const *>(data), size));
+        return true;
+    }, 10) == 3);
+    REQUIRE(consumed == vector<string>{ "one", "three" });
+    munmap(pMap, sizeof(ringHeader_t));
+}
+
+TEST_CASE( "Submission ring eventfd is passed via the command socket" )
+{
+    SubmissionRing ring(TEST_RING_NAME, 4, 16);
+    CommandSocket commandSocket(TEST_SOCKET_PATH);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, TEST_SOCKET_PATH.c_str(), sizeof(addr.sun_path) - 1);
+    int client = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    REQUIRE(connect(client, reinterpret_cast<struct sockaddr const *>(&addr), sizeof(addr)) == 0);
+
+    uint8_t request[] = { static_cast<uint8_t>(CommandType::RING), 0, 0 };
+    REQUIRE(send(client, request, sizeof(request), 0) == sizeof(request));
+    commandSocket.receive([&](command_t const &command) {
+        REQUIRE(command.type == CommandType::RING);
+        string const &name = ring.getName();
+        REQUIRE(commandSocket.reply(command.clientDesc, CommandType::RING, reinterpret_cast<uint8_t const *>(name.data()), name.size(), ring.getEventDescriptor()));
+    });
+
+    int eventDesc = -1;
+    string name = CommandSocket::receiveReply(client, CommandType::RING, eventDesc);
+    close(client);
+    REQUIRE(name == TEST_RING_NAME);
+    REQUIRE(eventDesc >= 0);
+
+    SubmissionRingProducer producer(name, eventDesc);
+    REQUIRE(push(producer, "hello"));
+    producer.notify();
+    REQUIRE(isReadable(ring.getEventDescriptor()));
+    REQUIRE(ring.consume([](uint8_t const *, size_t size) { return size == 5; }, 10) == 1);
+}
@@ -7,6 +7,7 @@
 
 #include "ISocket.h"
 #include "IApp.h"
+#include "IClock.h"
 #include "MiddleWare.h"
 #include "Logger.h"
 
@@ -97,11 +98,11 @@ private:
 class TestApp : public IApp
 {
 public:
-    TestApp(IRxSocket *pRxSocket, std::vector<ITxSocket *> &txSockets, size_t numLoops = 10) : 
-        m_middleWare(this, OWN_PEER_ID, pRxSocket, txSockets, std::nullopt),
+    TestApp(IRxSocket *pRxSocket, std::vector<ITxSocket *> &txSockets, size_t numLoops = 10, mwConfig_t const &mwConfig = mwConfig_t()) : 
+        m_middleWare(this, OWN_PEER_ID, pRxSocket, txSockets, std::nullopt, mwConfig),
         m_logger(),
         m_numLoops(numLoops),
-        m_now() 
+        m_clock() 
     {
         log(IApp::LOG_TYPE::DEBUG, "Starting TestApp...");
     }
@@ -109,19 +110,22 @@ public:
     {
         log(IApp::LOG_TYPE::DEBUG, "Terminating TestApp...");
     }
-    virtual void deliverMessage(MessageId msgId, payload_t const &payload) const 
+    virtual void deliverMessages(delivery_t const *deliveries, size_t numDeliveries) const 
     {
-        log(IApp::LOG_TYPE::DEBUG, fmt::format("Delivered Message {}", MiddleWare::toString(payload)));
-        msgId_payload_t entry { msgId, payload };
-        deliveredMsgs.push_back(entry); 
+        for (size_t i = 0; i < numDeliveries; i++)
+        {
+            log(IApp::LOG_TYPE::DEBUG, fmt::format("Delivered Message {}", MiddleWare::toString(deliveries[i])));
+            msgId_payload_t entry { deliveries[i].msgId, payload_t(deliveries[i].data, deliveries[i].data + deliveries[i].size) };
+            deliveredMsgs.push_back(entry); 
+        }
     }
 
     virtual void run()
     {
         for (size_t i = 0; i < m_numLoops; i++)
         {
-            m_middleWare.rxTxLoop(m_now);
-            m_now += LOOP_TIME_100_MS; // simulate that time passes
+            m_middleWare.rxTxLoop(m_clock.now());
+            m_clock.advance(LOOP_TIME_100_MS); // simulate that time passes
         } 
     }
 
@@ -131,23 +135,28 @@ public:
         return *this;
     }
 
+    MiddleWare &getMiddleWare()
+    {
+        return m_middleWare;
+    }
+
     void log(LOG_TYPE type, std::string const &msg) const
     {
         switch(type)
         {
             case LOG_TYPE::DEBUG:
 #ifndef NDEBUG
-                m_logger.logDebug(msg, m_now);
+                m_logger.logDebug(msg, m_clock.now());
 #endif
                 break;
             case LOG_TYPE::ERR:
-                m_logger.logErr(msg, m_now);
+                m_logger.logErr(msg, m_clock.now());
                 break;
             case LOG_TYPE::WARN:
-                m_logger.logWarn(msg, m_now);
+                m_logger.logWarn(msg, m_clock.now());
                 break;
             case LOG_TYPE::MSG:
-                m_logger.logMsg(msg, m_now);
+                m_logger.logMsg(msg, m_clock.now());
                 break;
             default:
                 assert(false);
@@ -166,7 +175,7 @@ private:
     MiddleWare m_middleWare;
     Logger m_logger;
     size_t m_numLoops;
-    std::chrono::system_clock::time_point m_now;
+    ManualClock m_clock;
 };
 
 }
@@ -0,0 +1,112 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "Tracer.h"
+#include "TestEnvironment.h"
+
+using namespace std;
+using namespace rgc;
+
+static size_t countOccurrences(string const &s, string const &pattern)
+{
+    size_t ret = 0;
+    for (size_t pos = s.find(pattern); pos != string::npos; pos = s.find(pattern, pos + 1))
+    {
+        ret++;
+    }
+    return ret;
+}
+
+TEST_CASE( "Trace scopes are recorded per thread only while tracing is enabled" )
+{
+    Tracer::clear();
+    {
+        TraceScope trace("disabled");
+    }
+    stringstream empty;
+    REQUIRE(Tracer::writeChromeTrace(empty) == 0);
+    REQUIRE(empty.str() == "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n]}\n");
+
+    Tracer::enable(true);
+    {
+        TraceScope outer("outer");
+        TraceScope inner("inner");
+    }
+    thread other([]() { TraceScope trace("other"); });
+    other.join();
+    Tracer::enable(false);
+    {
+        TraceScope trace("disabled");
+    }
+
+    stringstream out;
+    REQUIRE(Tracer::writeChromeTrace(out) == 3);
+    string json = out.str();
+    REQUIRE(countOccurrences(json, "\"ph\":\"X\"") == 3);
+    REQUIRE(countOccurrences(json, "\"name\":\"inner\"") == 1);
+    REQUIRE(countOccurrences(json, "\"name\":\"disabled\"") == 0);
+    // the inner scope ends first
+    REQUIRE(json.find("\"name\":\"inner\"") < json.find("\"name\":\"outer\""));
+
+    set<string> tids;
+    for (size_t pos = json.find("\"tid\":"); pos != string::npos; pos = json.find("\"tid\":", pos + 1))
+    {
+        tids.insert(json.substr(pos, json.find(',', pos) - pos));
+    }
+    REQUIRE(tids.size() == 2);
+
+    Tracer::clear();
+}
+
+TEST_CASE( "Each thread keeps its latest trace events" )
+{
+    Tracer::clear();
+    Tracer::enable(true);
+    Tracer::record("old", 0, 1000);
+    for (size_t i = 0; i < Tracer::EVENTS_PER_THREAD; i++)
+    {
+        Tracer::record("new", 1000, 2500);
+    }
+    Tracer::enable(false);
+
+    stringstream out;
+    REQUIRE(Tracer::writeChromeTrace(out) == Tracer::EVENTS_PER_THREAD);
+    string json = out.str();
+    REQUIRE(countOccurrences(json, "\"name\":\"old\"") == 0);
+    REQUIRE(json.find("\"ts\":1.000,\"dur\":1.500}") != string::npos);
+
+    Tracer::clear();
+}
+
+TEST_CASE( "The phases of the event loop are traced" )
+{
+    static const peer_t PEER_1 = { 1, 42, inet_addr("192.168.1.1") };
+    TestRxSocket rxSocket;
+    TestTxSocket txSocket(PEER_1);
+    vector<ITxSocket *> txSockets = { &txSocket };
+    TestApp app(&rxSocket, txSockets, 1);
+
+    sender_payload_t data = { PEER_1, { 0x00, 0x01, 0x00, 0x00, 't', 'e', 's', 't' } };
+    checksum_t checksum = MiddleWare::rfc1071Checksum(data.payload.data(), data.payload.size());
+    data.payload.push_back(checksum >> 8);
+    data.payload.push_back(checksum & 0xff);
+    rxSocket.m_receivedPayloads.push_back(data);
+
+    Tracer::clear();
+    Tracer::enable(true);
+    app.run();
+    Tracer::enable(false);
+
+    stringstream out;
+    Tracer::writeChromeTrace(out);
+    string json = out.str();
+    REQUIRE(countOccurrences(json, "\"name\":\"listenRxSocket\"") == 1);
+    REQUIRE(countOccurrences(json, "\"name\":\"processRxMessage DATA\"") == 1);
+    REQUIRE(countOccurrences(json, "\"name\":\"checkPendingTxMessages\"") == 1);
+
+    Tracer::clear();
+}
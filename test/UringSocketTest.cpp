@@ -0,0 +1,145 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "Endpoint.h"
+#include "UringSocket.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace rgc;
+
+// Null if the kernel does not support io_uring, e.g. in a restricted container
+static unique_ptr<UringContext> makeContext(int socketDesc, unsigned numRxBuffers)
+{
+    try
+    {
+        return make_unique<UringContext>(socketDesc, 64, numRxBuffers);
+    }
+    catch (std::runtime_error const &e)
+    {
+        WARN("io_uring not available: " << e.what());
+        return nullptr;
+    }
+}
+
+TEST_CASE( "io_uring backend receives timestamped datagrams beyond its buffers and sends batches" )
+{
+    UdpRxSocket uringSocket(inet_addr("127.0.0.1"), 47411);
+    UdpRxSocket plainSocket(inet_addr("127.0.0.1"), 47412);
+    REQUIRE(uringSocket.enableTimestamps() == 0);
+    auto pContext = makeContext(uringSocket.getSocketDescriptor(), 8);
+    if (!pContext)
+    {
+        return;
+    }
+
+    // Peer side sends 32 datagrams, the context has only 8 buffers to receive them
+    peer_t uringPeer { 2, 47411, inet_addr("127.0.0.1") };
+    UdpTxSocket plainTx(uringPeer, plainSocket.getSocketDescriptor());
+    for (uint8_t i = 0; i < 32; i++)
+    {
+        REQUIRE(plainTx.send({ i, 0x42 }).status == 0);
+    }
+
+    rx_buffer_t buf;
+    struct sockaddr_in remoteAddr;
+    vector<uint8_t> received;
+    for (size_t iteration = 0; (iteration < 100) && (received.size() < 32); iteration++)
+    {
+        struct pollfd pfd { pContext->getDescriptor(), POLLIN, 0 };
+        ::poll(&pfd, 1, 10);
+        for (TransmitStatus status = pContext->receive(buf, remoteAddr); status.transmitBytes > 0; status = pContext->receive(buf, remoteAddr))
+        {
+            REQUIRE(status.transmitBytes == 2);
+            REQUIRE(buf[1] == 0x42);
+            REQUIRE(remoteAddr.sin_port == htons(47412));
+            REQUIRE(status.timestamp.time_since_epoch().count() != 0);
+            received.push_back(buf[0]);
+        }
+        pContext->submit();
+    }
+
+    REQUIRE(received.size() == 32);
+    for (uint8_t i = 0; i < 32; i++)
+    {
+        REQUIRE(received[i] == i);
+    }
+
+    // Queued datagrams go out with one submit()
+    peer_t plainPeer { 3, 47412, inet_addr("127.0.0.1") };
+    UringTxSocket uringTx(plainPeer, *pContext);
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        REQUIRE(uringTx.send({ i }).status == 0);
+    }
+    pContext->submit();
+
+    size_t numSent = 0;
+    for (size_t iteration = 0; (iteration < 100) && (numSent < 16); iteration++)
+    {
+        TransmitStatus status = plainSocket.receive(buf, remoteAddr);
+        if (status.transmitBytes > 0)
+        {
+            REQUIRE(buf[0] == numSent);
+            REQUIRE(remoteAddr.sin_port == htons(47411));
+            numSent++;
+        }
+        else
+        {
+            usleep(1000);
+        }
+    }
+    REQUIRE(numSent == 16);
+    REQUIRE(pContext->getNumTxErrors() == 0);
+}
+
+TEST_CASE( "Endpoint on the io_uring backend delivers messages to a remote peer" )
+{
+    vector<string> delivered1;
+    vector<string> delivered2;
+    config_t config1 { 1, "127.0.0.1", inet_addr("127.0.0.1"), 47413, "", "", "", {}, {}, {}, std::nullopt, IoBackend::URING, { false, 0, -1, 0 }, "", false };
+    config1.peers = { { 2, 47414, inet_addr("127.0.0.1") } };
+    config_t config2 = config1;
+    config2.Id = 2;
+    config2.udpPort = 47414;
+    config2.peers = { { 1, 47413, inet_addr("127.0.0.1") } };
+
+    auto collect = [](vector<string> &delivered) {
+        return [&delivered](delivery_t const *deliveries, size_t numDeliveries) {
+            for (size_t i = 0; i < numDeliveries; i++)
+            {
+                delivered.push_back(string(reinterpret_cast<char const *>(deliveries[i].data), deliveries[i].size));
+            }
+        };
+    };
+    Endpoint endpoint1(config1, collect(delivered1));
+    Endpoint endpoint2(config2, collect(delivered2));
+    if (!endpoint1.isUringActive())
+    {
+        // fell back to the socket backend
+        REQUIRE(endpoint1.getDescriptors().size() == 1);
+        return;
+    }
+
+    // Peers receive their own messages first, remote peers after the one second stagger
+    ManualClock clock(system_clock::now());
+    REQUIRE(endpoint1.send("Hello", clock.now()) == SendStatus::OK);
+    for (size_t i = 0; (i < 300) && (delivered1.empty() || delivered2.empty()); i++)
+    {
+        clock.advance(milliseconds(10));
+        endpoint1.poll(clock.now());
+        endpoint2.poll(clock.now());
+        usleep(1000);
+    }
+
+    REQUIRE(delivered1 == vector<string>{ "Hello" });
+    REQUIRE(delivered2 == vector<string>{ "Hello" });
+}
@@ -0,0 +1,182 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fmt/core.h>
+
+#include "Endpoint.h"
+#include "WriteAheadLog.h"
+#include "TestEnvironment.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace std::filesystem;
+using namespace rgc;
+
+// Fresh directory for the segments of one test case
+static string makeWalDir(string const &name)
+{
+    path dir = temp_directory_path() / fmt::format("peer_wal_{}_{}", name, getpid());
+    remove_all(dir);
+    create_directories(dir);
+    return dir.string();
+}
+
+TEST_CASE( "Write-ahead log replays unfinished messages and watermarks up to a torn record" )
+{
+    string dir = makeWalDir("replay");
+    string walPath = dir + "/peer1.wal";
+    {
+        WriteAheadLog wal(walPath);
+        REQUIRE(wal.takeRecoveredState().messages.empty());
+        REQUIRE(wal.logMessage(MessageId(1, 0), { 0x00, 0x01, 0x00, 0x00, 'a' }) == 0);
+        REQUIRE(wal.logMessage(MessageId(2, 7), { 0x00, 0x02, 0x00, 0x07, 'b' }) == 0);
+        REQUIRE(wal.logMessage(MessageId(1, 1), { 0x00, 0x01, 0x00, 0x01, 'c' }) == 0);
+        REQUIRE(wal.logDone(MessageId(1, 0)) == 0);
+        REQUIRE(wal.logWatermark(3, 42) == 0);
+        REQUIRE(wal.logMessage(MessageId(1, 2), { 0x00, 0x01, 0x00, 0x02, 'X', 'Y', 'Z' }) == 0);
+        REQUIRE(wal.commit() == 0);
+    }
+
+    // the last record was not written completely
+    {
+        fstream segment(walPath + ".0", ios::in | ios::out | ios::binary);
+        string content((istreambuf_iterator<char>(segment)), istreambuf_iterator<char>());
+        size_t pos = content.find("XYZ");
+        REQUIRE(pos != string::npos);
+        segment.seekp(pos + 2);
+        segment.put('\0');
+    }
+
+    WriteAheadLog wal(walPath);
+    walState_t state = wal.takeRecoveredState();
+    REQUIRE(state.messages.size() == 2);
+    REQUIRE(state.messages[0].msgId == MessageId(1, 1));
+    REQUIRE(state.messages[0].frame == payload_t{ 0x00, 0x01, 0x00, 0x01, 'c' });
+    REQUIRE(state.messages[1].msgId == MessageId(2, 7));
+    REQUIRE(state.watermarks.size() == 3);
+    REQUIRE(state.watermarks[0].peerId == 1);
+    REQUIRE(state.watermarks[0].nextSeqNr == 2);
+    REQUIRE(state.watermarks[1].nextSeqNr == 8);
+    REQUIRE(state.watermarks[2].nextSeqNr == 42);
+
+    remove_all(dir);
+}
+
+TEST_CASE( "Write-ahead log drops finished messages when it starts a new segment" )
+{
+    string dir = makeWalDir("compact");
+    string walPath = dir + "/peer1.wal";
+    {
+        WriteAheadLog wal(walPath, 4096);
+        seqNr_t nextSeqNr = 0;
+        wal.setSnapshotWriter([&]() {
+            // only the last message is unfinished
+            (void)wal.logWatermark(1, nextSeqNr);
+            (void)wal.logMessage(MessageId(1, nextSeqNr - 1), payload_t(100, 0x42));
+        });
+
+        for (; nextSeqNr < 200; nextSeqNr++)
+        {
+            REQUIRE(wal.logMessage(MessageId(1, nextSeqNr), payload_t(100, 0x42)) == 0);
+            REQUIRE(wal.logDone(MessageId(1, nextSeqNr - 1)) == 0);
+        }
+        REQUIRE(wal.commit() == 0);
+        REQUIRE(wal.getNumSegments() == 1);
+    }
+
+    size_t numSegments = distance(directory_iterator(dir), directory_iterator());
+    REQUIRE(numSegments == 1);
+
+    WriteAheadLog wal(walPath, 4096);
+    walState_t state = wal.takeRecoveredState();
+    REQUIRE(state.messages.size() == 1);
+    REQUIRE(state.messages[0].msgId == MessageId(1, 199));
+    REQUIRE(state.watermarks.size() == 1);
+    REQUIRE(state.watermarks[0].nextSeqNr == 200);
+
+    remove_all(dir);
+}
+
+TEST_CASE( "Restarted Endpoint resumes its unfinished messages and sequence numbers" )
+{
+    string dir = makeWalDir("endpoint");
+    // the remote peer never acknowledges
+    config_t config { 1, "127.0.0.1", inet_addr("127.0.0.1"), 47421, "", "", "", {}, {}, {}, std::nullopt, IoBackend::SOCKET, { false, 0, -1, 0 }, dir + "/peer1.wal", false };
+    config.peers = { { 2, 47422, inet_addr("127.0.0.1") } };
+    ManualClock clock(system_clock::now());
+    {
+        Endpoint endpoint(config, [](delivery_t const *, size_t) {}, logCallback_t(), clock);
+        REQUIRE(endpoint.send("first", clock.now()) == SendStatus::OK);
+        endpoint.poll(clock.now());
+    }
+    {
+        Endpoint endpoint(config, [](delivery_t const *, size_t) {}, logCallback_t(), clock);
+        REQUIRE(endpoint.getMiddleWare().getNumPendingTxMessages() == 1);
+        REQUIRE(endpoint.send("second", clock.now()) == SendStatus::OK);
+        endpoint.poll(clock.now());
+    }
+
+    WriteAheadLog wal(dir + "/peer1.wal");
+    walState_t state = wal.takeRecoveredState();
+    REQUIRE(state.messages.size() == 2);
+    REQUIRE(state.messages[0].msgId == MessageId(1, 0));
+    REQUIRE(state.messages[1].msgId == MessageId(1, 1));
+
+    remove_all(dir);
+}
+
+// Notes how many bytes of the log were not committed when a datagram was sent
+class CommitCheckingTxSocket : public TestTxSocket
+{
+public:
+    CommitCheckingTxSocket(peer_t const &peer, WriteAheadLog const &wal) : TestTxSocket(peer), m_wal(wal) {}
+
+    virtual TransmitStatus send(payload_t const &payload) const
+    {
+        m_uncommittedBytes.push_back(m_wal.getNumUncommittedBytes());
+        return TestTxSocket::send(payload);
+    }
+
+    mutable vector<size_t> m_uncommittedBytes;
+
+private:
+    WriteAheadLog const &m_wal;
+};
+
+TEST_CASE( "No datagram leaves before the records of the write-ahead log are committed" )
+{
+    string dir = makeWalDir("commit");
+    static const peer_t PEER_1 = { 1, 42, inet_addr("192.168.1.1") };
+    WriteAheadLog wal(dir + "/peer42.wal");
+    TestRxSocket rxSocket;
+    CommitCheckingTxSocket txSocket(PEER_1, wal);
+    vector<ITxSocket *> txSockets = { &txSocket };
+    TestApp app(&rxSocket, txSockets, 1);
+    REQUIRE(app.getMiddleWare().setWriteAheadLog(&wal) == 0);
+
+    // A new message of peer 1 and its ACK, then a message of our own
+    for (seqNr_t seqNr = 0; seqNr < 2; seqNr++)
+    {
+        sender_payload_t data = { PEER_1, { 0x00, 0x01, 0x00, static_cast<uint8_t>(seqNr), 'x' } };
+        checksum_t checksum = MiddleWare::rfc1071Checksum(data.payload.data(), data.payload.size());
+        data.payload.push_back(checksum >> 8);
+        data.payload.push_back(checksum & 0xff);
+        rxSocket.m_receivedPayloads.push_back(data);
+    }
+    app.run();
+    REQUIRE(app.getMiddleWare().sendMessage("mine", system_clock::now()) == SendStatus::OK);
+    app.run();
+
+    REQUIRE(txSocket.m_uncommittedBytes.size() >= 3);
+    for (size_t uncommittedBytes : txSocket.m_uncommittedBytes)
+    {
+        REQUIRE(uncommittedBytes == 0);
+    }
+
+    remove_all(dir);
+}
@@ -0,0 +1,105 @@
+#!/bin/bash
+
+startup_peers() 
+{
+    # Reset logs so we only find the output of this test case in them
+    echo "" >peer1.log
+    echo "" >peer2.log
+    echo "" >peer3.log
+
+    # Peers 1 and 2 use copies of their configs, which are changed during the test
+    cp ./peer1_local.cfg /tmp/peer1_reload.cfg
+    cp ./peer2_local.cfg /tmp/peer2_reload.cfg
+
+    #
+    # Start the Peer processes
+    #
+    echo "Starting Peers..."
+    ${PEER} -i1 -p4201 -c /tmp/peer1_reload.cfg -l ./peer1.log &
+    ${PEER} -i2 -p4202 -c /tmp/peer2_reload.cfg -l ./peer2.log &
+    ${PEER} -i3 -p4203 -c ./peer3_local.cfg -l ./peer3.log &
+    sleep 0.5 # wait for the peers proper startup, creation of named pipes
+    if [ ! -p /tmp/peer_pipe_1 ]; then
+        echo "Test Failed, named pipe \"/tmp/peer_pipe_1\" does not exist!" >&2
+        echo "Is ${PEER} the proper binary?" >&2
+        exit 1
+    fi
+    if [ ! -p /tmp/peer_pipe_2 ]; then
+        echo "Test Failed, named pipe \"/tmp/peer_pipe_2\" does not exist!" >&2
+        exit 1
+    fi
+    if [ ! -p /tmp/peer_pipe_3 ]; then
+        echo "Test Failed, named pipe \"/tmp/peer_pipe_3\" does not exist!" >&2
+        exit 1
+    fi
+}
+
+
+shutdown_peers() 
+{
+    remaining_pipes=$(find /tmp -maxdepth 1 -name "peer_pipe_*" -type p)
+    for remaining_pipe in ${remaining_pipes}; do
+        echo "stop" > ${remaining_pipe}
+    done
+    sleep 0.5 # wait for the peers proper shutdown
+    rm -f /tmp/peer1_reload.cfg /tmp/peer2_reload.cfg
+}
+
+execute()
+{
+    #
+    # Test Execution: Peer 3 leaves the group, peers 1 and 2 reload their configs without it
+    #
+    echo "Executing test12 (Reload Membership)..."
+    echo "stop" >/tmp/peer_pipe_3
+    sleep 0.5
+    grep -v "^3," ./peer1_local.cfg >/tmp/peer1_reload.cfg
+    grep -v "^3," ./peer2_local.cfg >/tmp/peer2_reload.cfg
+    echo "reload" >/tmp/peer_pipe_1
+    echo "reload" >/tmp/peer_pipe_2
+    sleep 0.5
+    echo "send Hello_Smaller_Group!" >/tmp/peer_pipe_1
+    # Peer 2 gets the message after 1s, without retransmissions to peer 3 it is delivered before they would be over
+    sleep 3
+}
+
+verify()
+{
+    echo "Analyzing logs for test12..."
+    for peer in 1 2; do
+        LEFT=$(cat peer${peer}.log | grep "Peer 3 left the group")
+        if [ -z "${LEFT}" ]; then
+            echo "Test failed, peer${peer} did not remove peer3!" >&2
+            exit 1
+        fi
+        DELIVERD_PEER=$(cat peer${peer}.log | grep "Delivered" | grep "Hello_Smaller_Group!" | grep "\[1,0\]")
+        if [ -z "${DELIVERD_PEER}" ]; then
+            echo "Test failed, peer${peer} did not deliver message!" >&2
+            exit 1
+        fi
+    done
+    SENT_TO_PEER3=$(cat peer1.log | grep "Sending message" | grep "Hello_Smaller_Group!" | grep ":4203")
+    if [ ! -z "${SENT_TO_PEER3}" ]; then
+        echo "Test failed, peer1 still sends to peer3!" >&2
+        exit 1
+    fi
+}
+
+if [ "$#" -ne 1 ]; then
+    echo "Usage: $1 <PeerBinary>" >&2
+    exit 1
+fi
+
+if [ ! -f "$1" ]; then
+    echo "PeerBinary $1 does not exist." >&2
+    exit 1
+fi
+
+PEER=$1
+startup_peers
+execute
+shutdown_peers
+verify
+
+# if we arrive here, we are good :-)
+echo "Test passed."
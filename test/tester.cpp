@@ -1,58 +1,580 @@
-#include <iostream>
+// Load generator: Starts (or attaches to) a group of local peers, submits messages via their command sockets, and
+// joins the group itself as an additional peer, so that it sees when each message is delivered.
+#include <algorithm>
+#include <chrono>
 #include <cstring>
-#include <unistd.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
 #include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fmt/core.h>
+
+#include "CommandSocket.h"
+#include "ConfigParser.h"
+#include "Endpoint.h"
 
 using namespace std;
+using namespace std::chrono;
+using namespace rgc;
+
+static constexpr uint16_t DEFAULT_BASE_PORT = 4400;
+static constexpr size_t MIN_MSG_SIZE = sizeof(uint64_t); // every message starts with its index
+static constexpr size_t MAX_FRAMES_PER_RECORD = 64;
+static constexpr size_t OPEN_LOOP_BATCH = 256;          // messages submitted per loop in open loop mode
+static constexpr milliseconds MAX_POLL_WAIT = milliseconds(10);
+static constexpr seconds STARTUP_TIMEOUT = seconds(3);
+static constexpr seconds SETTLE_TIMEOUT = seconds(10);
+static constexpr size_t STATS_IDX_NUM_MESSAGES = 0;
+static constexpr size_t STATS_IDX_TX_DATAGRAMS = 6;
+static constexpr size_t STATS_IDX_DROPPED_DATAGRAMS = 7;
+static constexpr size_t STATS_IDX_RX_QUEUE_DROPS = 8;
+static constexpr size_t STATS_IDX_TX_SOCKET_DROPS = 9;
+static constexpr size_t STATS_IDX_FEC_RECOVERED = 10;
+static constexpr size_t STATS_IDX_PACED_DATAGRAMS = 12;
+static constexpr size_t STATS_IDX_PACING_DELAY_NS_SUM = 13;
+static constexpr size_t STATS_IDX_PACING_DELAY_NS_MAX = 14;
+static constexpr size_t STATS_IDX_UNCONFIRMED_EVICTIONS = 15;
+
+typedef struct
+{
+    size_t numPeers;
+    string peerBinary;
+    string workDir;
+    uint16_t basePort;
+    bool attach;       // peers are already running
+    bool generateOnly; // write the configs and exit
+    size_t numMessages;
+    double rate;       // messages per second, 0 for open loop
+    size_t minSize;
+    size_t maxSize;
+    unsigned lossPercent;
+    vector<string> options; // additional <option>=<value> lines of the group
+    seconds timeout;
+} loadConfig_t;
+
+static void printTesterUsage(char const *argv0)
+{
+    cerr << "Usage: " << argv0 << " [-n <numPeers>] [-b <peerBinary>] [-d <workDir>] [-P <basePort>] [-A] [-G] [-m <numMessages>]\n"
+         << "          [-r <rate>] [-s <minSize>[:<maxSize>]] [-l <lossPercent>] [-o <option>=<value>]... [-t <timeoutSec>]\n"
+         << "   <numPeers>     number of peers, default is 3; the tester joins as peer <numPeers> + 1.\n"
+         << "   <peerBinary>   Peer executable, default is Peer in the folder of the tester.\n"
+         << "   <workDir>      folder for the generated configs and the peer logs, default is /tmp/rgc_load.\n"
+         << "   <basePort>     peer i listens on <basePort> + i, default is " << DEFAULT_BASE_PORT << ".\n"
+         << "   -A             attach to running peers, which were started with the configs generated by -G.\n"
+         << "   -G             generate the configs only.\n"
+         << "   <numMessages>  number of messages to submit, default is 1000.\n"
+         << "   <rate>         messages per second, default is 0: open loop.\n"
+         << "   <minSize>      payload size in Bytes, random in [<minSize>..<maxSize>], at least " << MIN_MSG_SIZE << ", default is 64.\n"
+         << "   <lossPercent>  share of datagrams dropped by each group member, default is 0.\n"
+         << "   <option>       additional group wide option, see README.md.\n"
+         << "   <timeoutSec>   max. duration of submission and delivery, default is 60.\n";
+}
+
+static optional<loadConfig_t> parseOptions(int argc, char *argv[])
+{
+    loadConfig_t ret { 3, (filesystem::path(argv[0]).parent_path() / "Peer").string(), "/tmp/rgc_load", DEFAULT_BASE_PORT,
+        false, false, 1000, 0.0, 64, 64, 0, {}, seconds(60) };
+    int c;
 
-class UdpTxSocket final
+    while ((c = getopt(argc, argv, "n:b:d:P:AGm:r:s:l:o:t:")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            ret.numPeers = strtoul(optarg, nullptr, 10);
+            break;
+        case 'b':
+            ret.peerBinary = optarg;
+            break;
+        case 'd':
+            ret.workDir = optarg;
+            break;
+        case 'P':
+            ret.basePort = static_cast<uint16_t>(strtoul(optarg, nullptr, 10));
+            break;
+        case 'A':
+            ret.attach = true;
+            break;
+        case 'G':
+            ret.generateOnly = true;
+            break;
+        case 'm':
+            ret.numMessages = strtoul(optarg, nullptr, 10);
+            break;
+        case 'r':
+            ret.rate = strtod(optarg, nullptr);
+            break;
+        case 's':
+        {
+            char *pEnd;
+            ret.minSize = strtoul(optarg, &pEnd, 10);
+            ret.maxSize = (*pEnd == ':') ? strtoul(pEnd + 1, nullptr, 10) : ret.minSize;
+            break;
+        }
+        case 'l':
+            ret.lossPercent = strtoul(optarg, nullptr, 10);
+            break;
+        case 'o':
+            ret.options.push_back(optarg);
+            break;
+        case 't':
+            ret.timeout = seconds(strtoul(optarg, nullptr, 10));
+            break;
+        default:
+            return std::nullopt;
+        }
+    }
+
+    if ((ret.numPeers == 0) || (ret.minSize < MIN_MSG_SIZE) || (ret.maxSize < ret.minSize) || (ret.maxSize > 0xffff - COMMAND_HEADER_SIZE) ||
+        (ret.rate < 0.0) || (ret.lossPercent > 100))
+    {
+        return std::nullopt;
+    }
+
+    return ret;
+}
+
+class LoadTester final
 {
 public:
-    UdpTxSocket(string const &remoteIp, uint16_t remotePort)
+    explicit LoadTester(loadConfig_t const &cfg) :
+        m_cfg(cfg),
+        m_submitTimes(cfg.numMessages),
+        m_isDelivered(cfg.numMessages, false),
+        m_numDelivered(0),
+        m_numDuplicates(0)
     {
-        std::memset(&m_remoteSockAddr, 0, sizeof(m_remoteSockAddr));
-        // FIXME: Only IP V4?
-        m_remoteSockAddr.sin_family = AF_INET;
-        m_remoteSockAddr.sin_addr.s_addr = inet_addr(remoteIp.c_str());
-        m_remoteSockAddr.sin_port = htons(remotePort);
-        // FIXME: Throw if we don't get a valid descriptor
-        m_socketDesc = socket(AF_INET, SOCK_DGRAM, 0);
+        generateConfigs();
     }
 
-    ~UdpTxSocket()
+    ~LoadTester()
     {
-        cout << "Closing tx socket.\n";
-        close(m_socketDesc);
+        stopPeers();
     }
 
-    ssize_t send(string const &msg)
+    bool startGroup()
     {
-        ssize_t sentBytes = sendto(
-            m_socketDesc, 
-            msg.c_str(), 
-            msg.length(), 
-            0, 
-            reinterpret_cast<struct sockaddr*>(&m_remoteSockAddr), 
-            sizeof(m_remoteSockAddr));
-        return sentBytes;
+        if (!m_cfg.attach)
+        {
+            for (size_t id = 1; id <= m_cfg.numPeers; id++)
+            {
+                m_peerPids.push_back(spawnPeer(id));
+            }
+        }
+
+        auto deadline = steady_clock::now() + STARTUP_TIMEOUT;
+        for (size_t id = 1; id <= m_cfg.numPeers; id++)
+        {
+            int desc = connectPeer(id, deadline);
+            if (desc < 0)
+            {
+                cerr << "Could not connect to the command socket of peer " << id << ".\n";
+                return false;
+            }
+            m_peerDescs.push_back(desc);
+        }
+
+        // The tester joins the group with its own generated config
+        string id = to_string(getTesterId());
+        string port = to_string(getPort(getTesterId()));
+        string cfgPath = getConfigPath(getTesterId());
+        char const *argv[] = { "tester", "-i", id.c_str(), "-p", port.c_str(), "-c", cfgPath.c_str() };
+        optind = 1;
+        optional<config_t> optConfig = getConfigFromOptions(7, const_cast<char **>(argv));
+        if (!optConfig.has_value())
+        {
+            return false;
+        }
+
+        m_pEndpoint = make_unique<Endpoint>(*optConfig, [this](delivery_t const *deliveries, size_t numDeliveries) {
+            onDelivery(deliveries, numDeliveries);
+        });
+        return true;
+    }
+
+    void run()
+    {
+        minstd_rand rng(42); // fixed seed, runs of different versions submit the same sizes
+        uniform_int_distribution<size_t> sizeDist(m_cfg.minSize, m_cfg.maxSize);
+        vector<uint8_t> msg(m_cfg.maxSize, 'x');
+        vector<vector<uint8_t>> records(m_peerDescs.size());
+        size_t maxRecordSize = MAX_FRAMES_PER_RECORD * (COMMAND_HEADER_SIZE + m_cfg.maxSize);
+
+        auto start = steady_clock::now();
+        auto deadline = start + m_cfg.timeout;
+        size_t numSubmitted = 0;
+
+        while ((m_numDelivered < m_cfg.numMessages) && (steady_clock::now() < deadline))
+        {
+            auto now = steady_clock::now();
+
+            // submit what is due, round robin over the peers
+            size_t numDue = (m_cfg.rate > 0.0) ?
+                static_cast<size_t>(duration<double>(now - start).count() * m_cfg.rate) + 1 :
+                numSubmitted + OPEN_LOOP_BATCH;
+            numDue = std::min(numDue, m_cfg.numMessages);
+
+            for (; numSubmitted < numDue; numSubmitted++)
+            {
+                uint64_t idx = numSubmitted;
+                memcpy(msg.data(), &idx, sizeof(idx));
+                size_t peerIdx = numSubmitted % m_peerDescs.size();
+                appendFrame(records[peerIdx], CommandType::SEND, msg.data(), sizeDist(rng));
+                m_submitTimes[numSubmitted] = now;
+
+                if (records[peerIdx].size() >= maxRecordSize)
+                {
+                    flushRecord(peerIdx, records[peerIdx]);
+                }
+            }
+
+            for (size_t i = 0; i < records.size(); i++)
+            {
+                flushRecord(i, records[i]);
+            }
+
+            pollEndpoint(((m_cfg.rate == 0.0) && (numSubmitted < m_cfg.numMessages)) ? milliseconds(0) : MAX_POLL_WAIT);
+        }
+
+        m_duration = steady_clock::now() - start;
+        m_numSubmitted = numSubmitted;
+    }
+
+    // Keeps the tester in the group until all members finished their retransmissions, so that all datagrams are counted
+    void settle()
+    {
+        auto deadline = steady_clock::now() + SETTLE_TIMEOUT;
+        m_isSettled = false;
+
+        while (!m_isSettled && (steady_clock::now() < deadline))
+        {
+            auto pollEnd = steady_clock::now() + milliseconds(200);
+            while (steady_clock::now() < pollEnd)
+            {
+                pollEndpoint(MAX_POLL_WAIT);
+            }
+
+            m_isSettled = (m_pEndpoint->getMiddleWare().getNumPendingTxMessages() == 0);
+            for (int desc : m_peerDescs)
+            {
+                uint64_t counters[NUM_STATS_COUNTERS];
+                m_isSettled = m_isSettled && queryStats(desc, counters) && (counters[STATS_IDX_NUM_MESSAGES] == 0);
+            }
+        }
+    }
+
+    void report() const
+    {
+        uint64_t numTxDatagrams = m_pEndpoint->getUsage().numTxDatagrams;
+        uint64_t numDroppedDatagrams = m_pEndpoint->getUsage().numDroppedDatagrams;
+        uint64_t numRxQueueDrops = m_pEndpoint->getUsage().numRxQueueDrops;
+        uint64_t numTxSocketDrops = m_pEndpoint->getUsage().numTxSocketDrops;
+        uint64_t numFecRecovered = m_pEndpoint->getUsage().numFecRecovered;
+        uint64_t numPacedDatagrams = m_pEndpoint->getUsage().numPacedDatagrams;
+        uint64_t pacingDelayNsSum = m_pEndpoint->getUsage().pacingDelayNsSum;
+        uint64_t pacingDelayNsMax = m_pEndpoint->getUsage().pacingDelayNsMax;
+        uint64_t numUnconfirmedEvictions = m_pEndpoint->getUsage().numUnconfirmedEvictions;
+        for (int desc : m_peerDescs)
+        {
+            uint64_t counters[NUM_STATS_COUNTERS];
+            if (queryStats(desc, counters))
+            {
+                numTxDatagrams += counters[STATS_IDX_TX_DATAGRAMS];
+                numDroppedDatagrams += counters[STATS_IDX_DROPPED_DATAGRAMS];
+                numRxQueueDrops += counters[STATS_IDX_RX_QUEUE_DROPS];
+                numTxSocketDrops += counters[STATS_IDX_TX_SOCKET_DROPS];
+                numFecRecovered += counters[STATS_IDX_FEC_RECOVERED];
+                numPacedDatagrams += counters[STATS_IDX_PACED_DATAGRAMS];
+                pacingDelayNsSum += counters[STATS_IDX_PACING_DELAY_NS_SUM];
+                pacingDelayNsMax = std::max(pacingDelayNsMax, counters[STATS_IDX_PACING_DELAY_NS_MAX]);
+                numUnconfirmedEvictions += counters[STATS_IDX_UNCONFIRMED_EVICTIONS];
+            }
+        }
+
+        vector<double> latenciesMs = m_latenciesMs;
+        sort(begin(latenciesMs), end(latenciesMs));
+        auto percentile = [&](double p) {
+            return latenciesMs.empty() ? 0.0 : latenciesMs[std::min(latenciesMs.size() - 1, static_cast<size_t>(p * latenciesMs.size()))];
+        };
+        double durationSec = duration<double>(m_duration).count();
+        double numDelivered = static_cast<double>(std::max(m_numDelivered, static_cast<size_t>(1)));
+
+        // one "key value" pair per line, so that reports of different versions can be diffed
+        cout << fmt::format("peers                {}\n", m_cfg.numPeers);
+        cout << fmt::format("messages             {}\n", m_cfg.numMessages);
+        cout << fmt::format("payload_bytes        {}..{}\n", m_cfg.minSize, m_cfg.maxSize);
+        cout << fmt::format("rate_msg_per_s       {}\n", (m_cfg.rate > 0.0) ? fmt::format("{:.1f}", m_cfg.rate) : "open_loop");
+        cout << fmt::format("loss_percent         {}\n", m_cfg.lossPercent);
+        for (auto const &option : m_cfg.options)
+        {
+            cout << fmt::format("option               {}\n", option);
+        }
+        cout << fmt::format("submitted            {}\n", m_numSubmitted);
+        cout << fmt::format("delivered            {}\n", m_numDelivered);
+        cout << fmt::format("duplicates           {}\n", m_numDuplicates);
+        cout << fmt::format("duration_s           {:.3f}\n", durationSec);
+        cout << fmt::format("throughput_msg_per_s {:.1f}\n", (durationSec > 0.0) ? m_numDelivered / durationSec : 0.0);
+        cout << fmt::format("latency_p50_ms       {:.3f}\n", percentile(0.50));
+        cout << fmt::format("latency_p99_ms       {:.3f}\n", percentile(0.99));
+        cout << fmt::format("latency_max_ms       {:.3f}\n", latenciesMs.empty() ? 0.0 : latenciesMs.back());
+        cout << fmt::format("settled              {}\n", m_isSettled ? "yes" : "no");
+        cout << fmt::format("datagrams            {}\n", numTxDatagrams);
+        cout << fmt::format("datagrams_dropped    {}\n", numDroppedDatagrams);
+        cout << fmt::format("kernel_rx_drops      {}\n", numRxQueueDrops);
+        cout << fmt::format("kernel_tx_drops      {}\n", numTxSocketDrops);
+        cout << fmt::format("fec_recovered        {}\n", numFecRecovered);
+        cout << fmt::format("paced_datagrams      {}\n", numPacedDatagrams);
+        cout << fmt::format("pacing_delay_avg_ms  {:.3f}\n", (numPacedDatagrams > 0) ? pacingDelayNsSum / 1e6 / numPacedDatagrams : 0.0);
+        cout << fmt::format("pacing_delay_max_ms  {:.3f}\n", pacingDelayNsMax / 1e6);
+        cout << fmt::format("unconfirmed_evicted  {}\n", numUnconfirmedEvictions);
+        cout << fmt::format("datagrams_per_msg    {:.2f}\n", numTxDatagrams / numDelivered);
+    }
+
+    bool isComplete() const
+    {
+        return (m_numDelivered == m_cfg.numMessages);
     }
 
 private:
-    int m_socketDesc;
-    struct sockaddr_in m_remoteSockAddr;
+    size_t getTesterId() const
+    {
+        return m_cfg.numPeers + 1;
+    }
+
+    string getConfigPath(size_t peerId) const
+    {
+        return fmt::format("{}/peer{}.cfg", m_cfg.workDir, peerId);
+    }
+
+    uint16_t getPort(size_t peerId) const
+    {
+        return static_cast<uint16_t>(m_cfg.basePort + peerId);
+    }
+
+    // One config per group member, listing all other members
+    void generateConfigs() const
+    {
+        filesystem::create_directories(m_cfg.workDir);
+
+        for (size_t id = 1; id <= getTesterId(); id++)
+        {
+            ofstream out(getConfigPath(id));
+            out << "# generated by the load tester\n";
+            for (size_t otherId = 1; otherId <= getTesterId(); otherId++)
+            {
+                if (otherId != id)
+                {
+                    out << otherId << ",127.0.0.1," << getPort(otherId) << "\n";
+                }
+            }
+            out << "tx_loss_percent=" << m_cfg.lossPercent << "\n";
+            for (auto const &option : m_cfg.options)
+            {
+                out << option << "\n";
+            }
+        }
+    }
+
+    pid_t spawnPeer(size_t peerId) const
+    {
+        string id = to_string(peerId);
+        string port = to_string(getPort(peerId));
+        string cfgPath = getConfigPath(peerId);
+        string logPath = fmt::format("{}/peer{}.log", m_cfg.workDir, peerId);
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            execl(m_cfg.peerBinary.c_str(), m_cfg.peerBinary.c_str(), "-i", id.c_str(), "-p", port.c_str(), "-c", cfgPath.c_str(), "-l", logPath.c_str(), nullptr);
+            _exit(127);
+        }
+        return pid;
+    }
+
+    void stopPeers()
+    {
+        uint8_t stop[COMMAND_HEADER_SIZE] = { static_cast<uint8_t>(CommandType::STOP), 0, 0 };
+        for (int desc : m_peerDescs)
+        {
+            if (!m_cfg.attach)
+            {
+                (void)send(desc, stop, sizeof(stop), MSG_NOSIGNAL);
+            }
+            close(desc);
+        }
+        m_peerDescs.clear();
+
+        for (pid_t pid : m_peerPids)
+        {
+            waitpid(pid, nullptr, 0);
+        }
+        m_peerPids.clear();
+    }
+
+    static int connectPeer(size_t peerId, steady_clock::time_point deadline)
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        string path = fmt::format("/tmp/peer_sock_{}", peerId);
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+        // the peer may still be starting up
+        do
+        {
+            int desc = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+            if (connect(desc, reinterpret_cast<struct sockaddr const *>(&addr), sizeof(addr)) == 0)
+            {
+                return desc;
+            }
+            close(desc);
+            usleep(20000);
+        } while (steady_clock::now() < deadline);
+
+        return -1;
+    }
+
+    static void appendFrame(vector<uint8_t> &record, CommandType type, uint8_t const *data, size_t size)
+    {
+        record.push_back(static_cast<uint8_t>(type));
+        record.push_back(size >> 8);
+        record.push_back(size & 0xff);
+        record.insert(end(record), data, data + size);
+    }
+
+    void flushRecord(size_t peerIdx, vector<uint8_t> &record) const
+    {
+        if (!record.empty())
+        {
+            // blocks while the peer is busy, which throttles the open loop mode
+            if (send(m_peerDescs[peerIdx], record.data(), record.size(), MSG_NOSIGNAL) < 0)
+            {
+                cerr << "Could not submit to peer " << (peerIdx + 1) << ".\n";
+            }
+            record.clear();
+        }
+    }
+
+    static bool queryStats(int peerDesc, uint64_t (&counters)[NUM_STATS_COUNTERS])
+    {
+        uint8_t request[COMMAND_HEADER_SIZE] = { static_cast<uint8_t>(CommandType::STATS), 0, 0 };
+        if (send(peerDesc, request, sizeof(request), MSG_NOSIGNAL) != sizeof(request))
+        {
+            return false;
+        }
+
+        int passedDesc;
+        string reply = CommandSocket::receiveReply(peerDesc, CommandType::STATS, passedDesc);
+        if (reply.size() < sizeof(counters))
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < NUM_STATS_COUNTERS; i++)
+        {
+            counters[i] = 0;
+            for (size_t j = 0; j < sizeof(uint64_t); j++)
+            {
+                counters[i] = (counters[i] << 8) + static_cast<uint8_t>(reply[i * sizeof(uint64_t) + j]);
+            }
+        }
+        return true;
+    }
+
+    void pollEndpoint(milliseconds maxWait)
+    {
+        vector<struct pollfd> pollFds;
+        for (int fd : m_pEndpoint->getDescriptors())
+        {
+            pollFds.push_back({ fd, POLLIN, 0 });
+        }
+
+        auto wait = std::clamp(duration_cast<milliseconds>(m_pEndpoint->getNextTimeout() - system_clock::now()), milliseconds(0), maxWait);
+        ::poll(pollFds.data(), pollFds.size(), static_cast<int>(wait.count()));
+        m_pEndpoint->poll(system_clock::now());
+    }
+
+    void onDelivery(delivery_t const *deliveries, size_t numDeliveries)
+    {
+        auto now = steady_clock::now();
+
+        for (size_t i = 0; i < numDeliveries; i++)
+        {
+            uint64_t idx;
+            if (deliveries[i].size < sizeof(idx))
+            {
+                continue;
+            }
+            memcpy(&idx, deliveries[i].data, sizeof(idx));
+
+            if ((idx >= m_cfg.numMessages) || m_isDelivered[idx])
+            {
+                m_numDuplicates++;
+                continue;
+            }
+
+            m_isDelivered[idx] = true;
+            m_numDelivered++;
+            m_latenciesMs.push_back(duration<double, std::milli>(now - m_submitTimes[idx]).count());
+        }
+    }
+
+    loadConfig_t const &m_cfg;
+    vector<pid_t> m_peerPids;
+    vector<int> m_peerDescs;
+    unique_ptr<Endpoint> m_pEndpoint;
+    vector<steady_clock::time_point> m_submitTimes;
+    vector<bool> m_isDelivered;
+    vector<double> m_latenciesMs;
+    size_t m_numDelivered;
+    size_t m_numDuplicates;
+    size_t m_numSubmitted = 0;
+    steady_clock::duration m_duration = steady_clock::duration(0);
+    bool m_isSettled = false;
 };
 
 int main(int argc, char *argv[])
 {
-    if (argc != 2)
+    optional<loadConfig_t> optCfg = parseOptions(argc, argv);
+    if (!optCfg.has_value())
     {
-        cerr << "Usage: " << argv[0] << " <text>\n";
-        cerr << "Sends <text> to 127.0.0.1:4242\n";
+        printTesterUsage(argv[0]);
         return 1;
     }
 
-    cout << "Sending a package...\n";
-    UdpTxSocket txSock("127.0.0.1", 4242);
-    txSock.send(argv[1]);
-    return 0;
-}
\ No newline at end of file
+    try
+    {
+        LoadTester tester(*optCfg);
+        if (optCfg->generateOnly)
+        {
+            cout << "Configs written to " << optCfg->workDir << ", start peer i with: Peer -i <i> -p " << optCfg->basePort << "+<i> -c "
+                 << optCfg->workDir << "/peer<i>.cfg\n";
+            return 0;
+        }
+
+        if (!tester.startGroup())
+        {
+            return 1;
+        }
+
+        tester.run();
+        tester.settle();
+        tester.report();
+        return tester.isComplete() ? 0 : 2;
+    }
+    catch (std::exception const &e)
+    {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+}